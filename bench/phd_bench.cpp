@@ -0,0 +1,261 @@
+// Benchmarks of each stage of the Pompeiu-Hausdorff computation on the synthetic corpus of bench/synthetic_mesh_pairs.h, from 1k faces up to --max_faces:
+// - bvh_build: BVH (libigl's AABB tree or the wide BVH) and per-face data of B
+// - initial_queries: closest points on B to all vertices of A
+// - upper_bounds: the whole cascade on all faces of A
+// - kang_upper_bound: Kang's bound alone on all faces of A (one thread)
+// - refinement: the full computation at several tolerances (BVH excluded)
+//
+// Usage: phd_bench [--max_faces=N] [--batch_size=B] [--wide_bvh=0|1] [Google Benchmark flags]
+// --max_faces (default 1000000): largest mesh A, sizes are the powers of 10 from 1000 up to it
+// --batch_size (default 64): batch_size of the refinement benchmarks
+// --wide_bvh (default 0): use the wide BVH in the refinement benchmarks
+//
+// Results are written in a machine-readable format with Google Benchmark's own flags, e.g. --benchmark_out=phd.json --benchmark_out_format=json (or csv). The number of threads is read by libigl from IGL_NUM_THREADS and recorded in the context of the report (igl_num_threads), so thread scaling is measured by running the same benchmarks with several values:
+// for t in 1 2 4 8; do IGL_NUM_THREADS=$t ./phd_bench --benchmark_out=phd_$t.json --benchmark_out_format=json; done
+
+#include "../src/PompeiuHausdorff.h"
+#include "../src/PompeiuHausdorffTarget.h"
+#include "../src/upper_bounds.h"
+#include "../src/kang_upper_bound.h"
+#include "synthetic_mesh_pairs.h"
+
+#include <benchmark/benchmark.h>
+#include <igl/default_num_threads.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+    // Mesh pair of the corpus used by the benchmarks being run (pairs are
+    // generated on first use and only the last one is kept, benchmarks are run
+    // in the order they are registered)
+    struct Corpus
+    {
+        std::string name;
+        int faces;
+        Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> VA;
+        Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> FA;
+        Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> VB;
+        Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> FB;
+        double h;
+        // targets built from B with libigl's AABB tree and with the wide BVH
+        std::unique_ptr<PompeiuHausdorffTarget> targets[2];
+    };
+
+    Corpus & corpus(const std::string & name, const int faces)
+    {
+        static Corpus c;
+        if (c.name!=name || c.faces!=faces){
+            c.name = name;
+            c.faces = faces;
+            c.targets[0].reset();
+            c.targets[1].reset();
+            synthetic_mesh_pair(name,faces,c.VA,c.FA,c.VB,c.FB,c.h);
+        }
+        return c;
+    }
+
+    const PompeiuHausdorffTarget & target(Corpus & c, const bool wide_bvh)
+    {
+        if (!c.targets[wide_bvh]){
+            c.targets[wide_bvh].reset(new PompeiuHausdorffTarget(c.VB,c.FB,wide_bvh));
+        }
+        return *c.targets[wide_bvh];
+    }
+
+    void set_size_counters(benchmark::State & state, const Corpus & c)
+    {
+        state.counters["faces_A"] = c.FA.rows();
+        state.counters["faces_B"] = c.FB.rows();
+    }
+
+    void bvh_build(benchmark::State & state, const std::string & name, const int faces, const bool wide_bvh)
+    {
+        Corpus & c = corpus(name,faces);
+        for (auto _ : state){
+            PompeiuHausdorffTarget t(c.VB,c.FB,wide_bvh);
+            benchmark::DoNotOptimize(t.time_taken_bvh);
+        }
+        set_size_counters(state,c);
+        state.SetItemsProcessed(state.iterations()*c.FB.rows());
+    }
+
+    void initial_queries(benchmark::State & state, const std::string & name, const int faces, const bool wide_bvh)
+    {
+        Corpus & c = corpus(name,faces);
+        const PompeiuHausdorffTarget & t = target(c,wide_bvh);
+        Eigen::VectorXd sqrD;
+        Eigen::VectorXi I;
+        Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> C;
+        for (auto _ : state){
+            t.squared_distance(c.VA,sqrD,I,C);
+            benchmark::DoNotOptimize(sqrD.data());
+        }
+        set_size_counters(state,c);
+        state.SetItemsProcessed(state.iterations()*c.VA.rows());
+    }
+
+    // Distances, closest faces and closest points of the vertices of A, and
+    // lower bound, as after the initial queries
+    void initial_pass(Corpus & c, Eigen::VectorXd & DV, Eigen::VectorXi & I, Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & C, double & lower)
+    {
+        target(c,false).squared_distance(c.VA,DV,I,C);
+        DV = DV.cwiseSqrt();
+        lower = DV.maxCoeff();
+    }
+
+    void upper_bounds_stage(benchmark::State & state, const std::string & name, const int faces)
+    {
+        Corpus & c = corpus(name,faces);
+        Eigen::VectorXd DV;
+        Eigen::VectorXi I;
+        Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> C;
+        double lower;
+        initial_pass(c,DV,I,C,lower);
+        const KangFaceData & faces_B = target(c,false).faces_B;
+        Eigen::VectorXd u(c.FA.rows());
+        Eigen::VectorXi success_bound(c.FA.rows());
+        for (auto _ : state){
+            upper_bounds(c.VA,c.FA,faces_B,DV,I,C,lower,u,success_bound);
+            benchmark::DoNotOptimize(u.data());
+        }
+        // fraction of the faces that survive the whole cascade
+        state.counters["unrejected"] = double((success_bound.array()==5).count())/c.FA.rows();
+        set_size_counters(state,c);
+        state.SetItemsProcessed(state.iterations()*c.FA.rows());
+    }
+
+    void kang_upper_bound_stage(benchmark::State & state, const std::string & name, const int faces)
+    {
+        Corpus & c = corpus(name,faces);
+        Eigen::VectorXd DV;
+        Eigen::VectorXi I;
+        Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> C;
+        double lower;
+        initial_pass(c,DV,I,C,lower);
+        const KangFaceData & faces_B = target(c,false).faces_B;
+        Eigen::Matrix<double,3,3,Eigen::RowMajor> V;
+        Eigen::Vector3d D;
+        Eigen::Vector3i T_proj;
+        for (auto _ : state){
+            double u_max = 0;
+            for (int f=0; f<c.FA.rows(); f++){
+                for (int k=0; k<3; k++){
+                    V.row(k) = c.VA.row(c.FA(f,k));
+                    D(k) = DV(c.FA(f,k));
+                    T_proj(k) = I(c.FA(f,k));
+                }
+                double u;
+                kang_upper_bound(V,D,T_proj,faces_B,u);
+                u_max = std::max(u_max,u);
+            }
+            benchmark::DoNotOptimize(u_max);
+        }
+        set_size_counters(state,c);
+        state.SetItemsProcessed(state.iterations()*c.FA.rows());
+    }
+
+    void refinement(benchmark::State & state, const std::string & name, const int faces, const double tol, const int batch_size, const bool wide_bvh)
+    {
+        Corpus & c = corpus(name,faces);
+        const PompeiuHausdorffTarget & t = target(c,wide_bvh);
+        double lower = 0, upper = 0, dA = 0;
+        PompeiuHausdorffStats stats;
+        PompeiuHausdorffOptions options;
+        options.batch_size = batch_size;
+        for (auto _ : state){
+            PompeiuHausdorff phd(c.VA,c.FA,t,tol,1000000,true,options);
+            lower = phd.lower;
+            upper = phd.upper_max;
+            dA = phd.dA;
+            stats = phd.stats;
+        }
+        state.counters["lower"] = lower;
+        state.counters["upper"] = upper;
+        state.counters["gap"] = (upper-lower)/dA;
+        if (!std::isnan(c.h)){
+            // whether the exact distance lies between the bounds, and distance
+            // from it to the farthest bound (relative to dA)
+            state.counters["certified"] = lower<=c.h*(1+1e-12) && c.h<=upper*(1+1e-12);
+            state.counters["error"] = std::max(upper-c.h,c.h-lower)/dA;
+        }
+        state.counters["iterations"] = stats.iterations;
+        state.counters["closest_point_queries"] = stats.closest_point_queries;
+        state.counters["max_depth"] = stats.max_depth;
+        state.counters["peak_queue_size"] = stats.peak_queue_size;
+        state.counters["peak_allocated_bytes"] = stats.peak_allocated_bytes;
+        state.counters["upper_bound_time(ms)"] = stats.time_bounds;
+        state.counters["query_time(ms)"] = stats.time_queries;
+        set_size_counters(state,c);
+    }
+
+    // Value of the flag --name=value in argv (removed from argv), or default
+    // if it is not given
+    long flag(int & argc, char ** argv, const char * name, const long default_value)
+    {
+        const std::string prefix = std::string("--")+name+"=";
+        long value = default_value;
+        int kept = 1;
+        for (int a=1; a<argc; a++){
+            if (std::strncmp(argv[a],prefix.c_str(),prefix.size())==0){
+                value = std::atol(argv[a]+prefix.size());
+            } else {
+                argv[kept++] = argv[a];
+            }
+        }
+        argc = kept;
+        return value;
+    }
+}
+
+int main(int argc, char ** argv)
+{
+    const long max_faces = flag(argc,argv,"max_faces",1000000);
+    const int batch_size = flag(argc,argv,"batch_size",64);
+    const bool wide_bvh = flag(argc,argv,"wide_bvh",0);
+    benchmark::Initialize(&argc,argv);
+    if (benchmark::ReportUnrecognizedArguments(argc,argv)){
+        return 1;
+    }
+    benchmark::AddCustomContext("igl_num_threads",std::to_string(igl::default_num_threads()));
+    benchmark::AddCustomContext("batch_size",std::to_string(batch_size));
+    benchmark::AddCustomContext("wide_bvh",std::to_string(wide_bvh));
+
+    const std::vector<std::string> names = synthetic_mesh_pair_names();
+    const double tolerances[] = {1e-4,1e-6,1e-8};
+    // grouped by pair and size so that each pair is generated once
+    for (long faces=1000; faces<=max_faces; faces*=10){
+        for (size_t n=0; n<names.size(); n++){
+            const std::string & name = names[n];
+            std::ostringstream prefix;
+            prefix << name << "/faces:" << faces;
+            for (int w=0; w<2; w++){
+                benchmark::RegisterBenchmark(("bvh_build/"+prefix.str()+"/wide_bvh:"+std::to_string(w)).c_str(),bvh_build,name,int(faces),bool(w))
+                    ->Unit(benchmark::kMillisecond)->UseRealTime();
+                benchmark::RegisterBenchmark(("initial_queries/"+prefix.str()+"/wide_bvh:"+std::to_string(w)).c_str(),initial_queries,name,int(faces),bool(w))
+                    ->Unit(benchmark::kMillisecond)->UseRealTime();
+            }
+            benchmark::RegisterBenchmark(("upper_bounds/"+prefix.str()).c_str(),upper_bounds_stage,name,int(faces))
+                ->Unit(benchmark::kMillisecond)->UseRealTime();
+            benchmark::RegisterBenchmark(("kang_upper_bound/"+prefix.str()).c_str(),kang_upper_bound_stage,name,int(faces))
+                ->Unit(benchmark::kMillisecond)->UseRealTime();
+            for (int k=0; k<3; k++){
+                std::ostringstream tol;
+                tol << tolerances[k];
+                benchmark::RegisterBenchmark(("refinement/"+prefix.str()+"/tol:"+tol.str()).c_str(),refinement,name,int(faces),tolerances[k],batch_size,wide_bvh)
+                    ->Unit(benchmark::kMillisecond)->UseRealTime();
+            }
+        }
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
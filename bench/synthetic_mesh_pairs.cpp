@@ -0,0 +1,186 @@
+#include "synthetic_mesh_pairs.h"
+#include <Eigen/Geometry>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <unordered_map>
+
+// Distance between A and B in the analytic pairs, and offset of the noisy one
+#define SYNTHETIC_DISTANCE 0.01
+// Amplitude of the noise of the noisy pair
+#define SYNTHETIC_NOISE 0.005
+// Size of the clustering cells of the decimated pair, in average edge lengths
+#define SYNTHETIC_DECIMATION_CELL 4.0
+
+namespace
+{
+    // Grid of m by m cells on [0,1]^2 (z = 0), two triangles per cell
+    void square_grid(const int m, Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & V, Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> & F)
+    {
+        V.resize((m+1)*(m+1),3);
+        F.resize(2*m*m,3);
+        for (int j=0; j<=m; j++){
+            for (int i=0; i<=m; i++){
+                V.row(j*(m+1)+i) << double(i)/m, double(j)/m, 0;
+            }
+        }
+        for (int j=0; j<m; j++){
+            for (int i=0; i<m; i++){
+                const int v = j*(m+1)+i;
+                F.row(2*(j*m+i)) << v, v+1, v+m+2;
+                F.row(2*(j*m+i)+1) << v, v+m+2, v+m+1;
+            }
+        }
+    }
+
+    // Appends the rectangle [x0,x1] x [y0,y1] at height z as two triangles
+    void append_rectangle(const double x0, const double x1, const double y0, const double y1, const double z, Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & V, Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> & F)
+    {
+        const int v = V.rows();
+        const int f = F.rows();
+        V.conservativeResize(v+4,3);
+        F.conservativeResize(f+2,3);
+        V.row(v) << x0, y0, z;
+        V.row(v+1) << x1, y0, z;
+        V.row(v+2) << x1, y1, z;
+        V.row(v+3) << x0, y1, z;
+        F.row(f) << v, v+1, v+2;
+        F.row(f+1) << v, v+2, v+3;
+    }
+}
+
+void synthetic_torus(const int faces, Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & V, Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> & F)
+{
+    // v segments around the tube and u = 2v around the axis: 2uv = faces
+    const int v = std::max(3,int(std::lround(std::sqrt(faces/4.0))));
+    const int u = 2*v;
+    const double R = 1.0;
+    const double r = 0.3;
+    const double pi = 3.14159265358979323846;
+    V.resize(u*v,3);
+    F.resize(2*u*v,3);
+    for (int i=0; i<u; i++){
+        const double theta = 2*pi*i/u;
+        for (int j=0; j<v; j++){
+            const double phi = 2*pi*j/v;
+            V.row(i*v+j) << (R+r*std::cos(phi))*std::cos(theta), (R+r*std::cos(phi))*std::sin(theta), r*std::sin(phi);
+        }
+    }
+    for (int i=0; i<u; i++){
+        for (int j=0; j<v; j++){
+            const int a = i*v+j;
+            const int b = ((i+1)%u)*v+j;
+            const int c = ((i+1)%u)*v+(j+1)%v;
+            const int d = i*v+(j+1)%v;
+            F.row(2*a) << a, b, c;
+            F.row(2*a+1) << a, c, d;
+        }
+    }
+}
+
+void synthetic_noisy_offset(const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & VA, const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> & FA, const double offset, const double noise, const unsigned int seed, Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & VB)
+{
+    // area weighted vertex normals
+    Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> N = Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor>::Zero(VA.rows(),3);
+    for (int f=0; f<FA.rows(); f++){
+        const Eigen::RowVector3d n = (VA.row(FA(f,1))-VA.row(FA(f,0))).cross(VA.row(FA(f,2))-VA.row(FA(f,0)));
+        for (int c=0; c<3; c++){
+            N.row(FA(f,c)) += n;
+        }
+    }
+    std::mt19937 generator(seed);
+    std::uniform_real_distribution<double> uniform(-noise,noise);
+    VB.resize(VA.rows(),3);
+    for (int v=0; v<VA.rows(); v++){
+        const double norm = N.row(v).norm();
+        const double d = offset+uniform(generator);
+        VB.row(v) = norm>0 ? Eigen::RowVector3d(VA.row(v)+d/norm*N.row(v)) : Eigen::RowVector3d(VA.row(v));
+    }
+}
+
+void synthetic_decimated(const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & VA, const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> & FA, const double cell, Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & VB, Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> & FB)
+{
+    // cluster of each vertex, numbered in order of first appearance
+    const Eigen::RowVector3d corner = VA.colwise().minCoeff();
+    std::unordered_map<uint64_t,int> clusters;
+    std::vector<int> cluster_of(VA.rows());
+    Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> sums(VA.rows(),3);
+    std::vector<int> counts;
+    for (int v=0; v<VA.rows(); v++){
+        uint64_t key = 0;
+        for (int d=0; d<3; d++){
+            key = (key<<21)|(uint64_t(std::floor((VA(v,d)-corner(d))/cell))&((1<<21)-1));
+        }
+        const std::pair<std::unordered_map<uint64_t,int>::iterator,bool> inserted = clusters.insert(std::make_pair(key,int(counts.size())));
+        const int k = inserted.first->second;
+        if (inserted.second){
+            sums.row(k).setZero();
+            counts.push_back(0);
+        }
+        sums.row(k) += VA.row(v);
+        counts[k]++;
+        cluster_of[v] = k;
+    }
+    VB.resize(counts.size(),3);
+    for (int k=0; k<int(counts.size()); k++){
+        VB.row(k) = sums.row(k)/counts[k];
+    }
+    FB.resize(FA.rows(),3);
+    int number_of_faces = 0;
+    for (int f=0; f<FA.rows(); f++){
+        const int a = cluster_of[FA(f,0)];
+        const int b = cluster_of[FA(f,1)];
+        const int c = cluster_of[FA(f,2)];
+        if (a!=b && b!=c && c!=a){
+            FB.row(number_of_faces++) << a, b, c;
+        }
+    }
+    FB.conservativeResize(number_of_faces,3);
+}
+
+bool synthetic_mesh_pair(const std::string & name, const int faces, Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & VA, Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> & FA, Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & VB, Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> & FB, double & h)
+{
+    const double d = SYNTHETIC_DISTANCE;
+    h = std::numeric_limits<double>::quiet_NaN();
+    VB.resize(0,3);
+    FB.resize(0,3);
+    if (name=="offset_square"){
+        square_grid(std::max(1,int(std::lround(std::sqrt(faces/2.0)))),VA,FA);
+        append_rectangle(-0.5,1.5,-0.5,1.5,d,VB,FB);
+        h = d;
+    } else if (name=="split_square"){
+        // an odd number of cells keeps x = 0.5 off the vertices of A
+        square_grid(2*int(std::lround(std::sqrt(faces/8.0)))+1,VA,FA);
+        append_rectangle(-0.5,0.5-d,-0.5,1.5,0,VB,FB);
+        append_rectangle(0.5+d,1.5,-0.5,1.5,0,VB,FB);
+        h = d;
+    } else if (name=="noisy_torus"){
+        synthetic_torus(faces,VA,FA);
+        synthetic_noisy_offset(VA,FA,d,SYNTHETIC_NOISE,1,VB);
+        FB = FA;
+    } else if (name=="decimated_torus"){
+        synthetic_torus(faces,VA,FA);
+        double edges = 0;
+        for (int f=0; f<FA.rows(); f++){
+            for (int c=0; c<3; c++){
+                edges += (VA.row(FA(f,(c+1)%3))-VA.row(FA(f,c))).norm();
+            }
+        }
+        synthetic_decimated(VA,FA,SYNTHETIC_DECIMATION_CELL*edges/(3*FA.rows()),VB,FB);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+std::vector<std::string> synthetic_mesh_pair_names()
+{
+    std::vector<std::string> names;
+    names.push_back("offset_square");
+    names.push_back("split_square");
+    names.push_back("noisy_torus");
+    names.push_back("decimated_torus");
+    return names;
+}
@@ -0,0 +1,66 @@
+// Synthetic pairs of triangle soups (A,B) for benchmarking, generated at any size so that the cost of each stage can be followed from 1k to 10M faces. Every generator is deterministic (the noise comes from a seeded generator), so the same name and size always give the same pair.
+
+#include <Eigen/Core>
+#include <string>
+#include <vector>
+
+// Given a number of faces, this function builds a closed torus (major radius 1, minor radius 0.3) tessellated as a regular grid with approximately that many triangles.
+
+// Input:
+// faces: approximate number of faces
+
+// Output:
+// V: #V x 3 Eigen matrix containing x, y z coordinates of each vertex
+// F: #F x 3 Eigen matrix containing vertex indices of each face
+
+void synthetic_torus(const int faces, Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & V, Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> & F);
+
+// Given a triangle mesh, this function displaces each vertex along its (area weighted) normal by offset plus uniform noise in [-noise,noise].
+
+// Input:
+// VA: #VA x 3 Eigen matrix containing x, y z coordinates of each vertex
+// FA: #FA x 3 Eigen matrix containing vertex indices of each face
+// offset: displacement along the normals
+// noise: amplitude of the noise added to the displacement
+// seed: seed of the noise
+
+// Output:
+// VB: #VA x 3 Eigen matrix containing the displaced vertices (the faces are FA)
+
+void synthetic_noisy_offset(const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & VA, const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> & FA, const double offset, const double noise, const unsigned int seed, Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & VB);
+
+// Given a triangle mesh, this function decimates it by vertex clustering: vertices in the same cell of a regular grid are merged into their average, and faces whose corners fall in fewer than three cells are removed.
+
+// Input:
+// VA: #VA x 3 Eigen matrix containing x, y z coordinates of each vertex
+// FA: #FA x 3 Eigen matrix containing vertex indices of each face
+// cell: edge length of the grid cells
+
+// Output:
+// VB: #VB x 3 Eigen matrix containing x, y z coordinates of each vertex
+// FB: #FB x 3 Eigen matrix containing vertex indices of each face
+
+void synthetic_decimated(const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & VA, const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> & FA, const double cell, Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & VB, Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> & FB);
+
+// Given the name of a pair and a number of faces, this function builds a pair of meshes with approximately that many faces in A:
+// - offset_square: A is a grid on the unit square, B a larger square (2 faces) parallel to it at distance 0.01. h(A,B) = 0.01 and is attained at every point of A.
+// - split_square: A is a grid on the unit square with an odd number of cells per side, B is the same square (enlarged) without the strip |x-0.5| < 0.01 (4 faces). h(A,B) = 0.01 and is only attained on the line x = 0.5, which crosses the interior of a column of triangles of A.
+// - noisy_torus: A is a torus, B is A offset by 0.01 with noise of amplitude 0.005 (same connectivity).
+// - decimated_torus: A is a torus, B is A decimated by vertex clustering with cells of 4 times the average edge length of A.
+
+// Input:
+// name: name of the pair (see synthetic_mesh_pair_names)
+// faces: approximate number of faces of A
+
+// Output:
+// VA: #VA x 3 Eigen matrix containing x, y z coordinates of each vertex of A
+// FA: #FA x 3 Eigen matrix containing vertex indices of each face of A
+// VB: #VB x 3 Eigen matrix containing x, y z coordinates of each vertex of B
+// FB: #FB x 3 Eigen matrix containing vertex indices of each face of B
+// h: exact Pompeiu-Hausdorff distance h(A,B), or NaN if it is not known analytically
+// returns false if the name is unknown
+
+bool synthetic_mesh_pair(const std::string & name, const int faces, Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & VA, Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> & FA, Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & VB, Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> & FB, double & h);
+
+// Names of the pairs built by synthetic_mesh_pair
+std::vector<std::string> synthetic_mesh_pair_names();
@@ -0,0 +1,48 @@
+// Writes a pair of the synthetic corpus (bench/synthetic_mesh_pairs.h) to two
+// mesh files, e.g. to run pompeiu_hausdorff on them, and prints the exact
+// distance h(A,B) when it is known.
+//
+// Usage: phd_synthetic name faces A.phdm B.phdm
+
+#include "../src/read_triangle_mesh_fast.h"
+#include "synthetic_mesh_pairs.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+
+using namespace std;
+
+int main(int argc, char *argv[])
+{
+    if (argc!=5) {
+        cout << "Command line input should be the name of a synthetic pair (";
+        const vector<string> names = synthetic_mesh_pair_names();
+        for (size_t n=0; n<names.size(); n++){
+            cout << (n ? ", " : "") << names[n];
+        }
+        cout << "), the approximate number of faces of A and the paths of the .phdm files to write for A and B" << endl;
+        return 0;
+    }
+
+    Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> VA, VB;
+    Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> FA, FB;
+    double h;
+    if (!synthetic_mesh_pair(argv[1],atoi(argv[2]),VA,FA,VB,FB,h)){
+        cout << "Unknown synthetic pair " << argv[1] << endl;
+        return 0;
+    }
+    if (!write_triangle_mesh_binary(argv[3],VA,FA) || !write_triangle_mesh_binary(argv[4],VB,FB)){
+        cout << "Error writing the meshes" << endl;
+        return 0;
+    }
+    cout << fixed;
+    cout << setprecision(12);
+    cout << "faces_A=" << FA.rows() << endl;
+    cout << "faces_B=" << FB.rows() << endl;
+    if (!std::isnan(h)){
+        cout << "h=" << h << endl;
+    }
+    return 1;
+}
@@ -0,0 +1,48 @@
+// Eigen includes
+#include <Eigen/Core>
+
+#include "src/read_triangle_mesh_fast.h"
+#include "src/PompeiuHausdorffTarget.h"
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+
+using namespace std;
+
+int main(int argc, char *argv[])
+{
+    if (argc!=3) {
+        cout << "Command line input should be a triangle soup B in .obj, .ply, .stl or .phdm format and the path of the .phdt target file (vertices, faces and BVH of B) to write, or of a .phdm raw binary mesh file (vertices and faces only, fast to load for A or B);" << endl;
+        return 0;
+    }
+
+    Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> VB;
+    Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> FB;
+    if (!read_triangle_mesh_fast(argv[1],VB,FB)){
+        cout << "Error loading mesh B \n" << endl;
+        return 0;
+    }
+
+    const std::string path = argv[2];
+    if (path.size()>5 && path.substr(path.size()-5)==".phdm"){
+        if (!write_triangle_mesh_binary(path,VB,FB)){
+            cout << "Error writing " << path << endl;
+            return 0;
+        }
+        return 1;
+    }
+
+    try {
+        PompeiuHausdorffTarget target(VB,FB);
+        target.save(path);
+        cout << fixed;
+        cout << setprecision(12);
+        cout << "bvh_time(ms)=" << target.time_taken_bvh << endl;
+    } catch (const std::exception& e){
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 0;
+    }
+
+    return 1;
+}
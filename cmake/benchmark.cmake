@@ -0,0 +1,19 @@
+if(TARGET benchmark::benchmark)
+    return()
+endif()
+
+# use an installed Google Benchmark if there is one
+find_package(benchmark QUIET)
+if(benchmark_FOUND)
+    return()
+endif()
+
+include(FetchContent)
+set(BENCHMARK_ENABLE_TESTING OFF CACHE BOOL "" FORCE)
+set(BENCHMARK_ENABLE_INSTALL OFF CACHE BOOL "" FORCE)
+FetchContent_Declare(
+    benchmark
+    GIT_REPOSITORY https://github.com/google/benchmark.git
+    GIT_TAG v1.8.3
+)
+FetchContent_MakeAvailable(benchmark)
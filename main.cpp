@@ -2,10 +2,12 @@
 // Eigen includes
 #include <Eigen/Core>
 
-// libigl includes
-#include <igl/readOBJ.h>
-
+#include "src/read_triangle_mesh_fast.h"
 #include "src/pompeiu_hausdorff.h"
+#include "src/symmetric_pompeiu_hausdorff.h"
+#include "src/streaming_pompeiu_hausdorff.h"
+#include "src/sharded_pompeiu_hausdorff.h"
+#include "src/PompeiuHausdorffTarget.h"
 // time include
 #if ! _MSC_VER
 #include <sys/time.h>
@@ -14,62 +16,118 @@
 #endif
 
 #include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
 
 using namespace std;
 
 int main(int argc, char *argv[])
 {
-    if (argc!=6) {
-        cout << "Command line input should be two triangle soups A and B in .obj format; a tolerance value for the difference between upper and lower bounds; factor to define the maximum allowed number of faces and vertices in the subdivided mesh A with respect to the number of faces and vertices of the initial mesh A; 0 (false) or 1 (true) to normalize tolerance by the length of the diagonal of A's bounding box;" << endl;
+    if (argc<6 || argc>14) {
+        cout << "Command line input should be two triangle soups A and B in .obj, .ply, .stl or .phdm format (B can also be a .phdt target file written by pompeiu_hausdorff_target); a tolerance value for the difference between upper and lower bounds; factor to define the maximum allowed number of faces and vertices in the subdivided mesh A with respect to the number of faces and vertices of the initial mesh A; 0 (false) or 1 (true) to normalize tolerance by the length of the diagonal of A's bounding box; (optional) number of triangles refined in parallel per iteration; (optional) 0 (false) or 1 (true) to compute the symmetric distance max(h(A,B),h(B,A)); (optional) 0 (false) or 1 (true) to recycle the storage of triangles that left the queue (memory bounded by the queue); (optional) 0 (false) or 1 (true) to query B with the wide SAH BVH and vectorized distances instead of libigl's AABB tree; (optional) 0 (false) or 1 (true) to defer Kang's bound and u4 until a triangle reaches the top of the queue; (optional) 0 (false) or 1 (true) to order Kang's bound and u4 by their measured cost per rejected triangle and skip the one that does not pay off (not reproducible); (optional) number of faces of A per chunk to stream A from a .phdm file with memory bounded by B and one chunk (0 loads A whole); (optional) number of worker processes to split A into spatial shards refined in parallel with a shared lower bound (0 runs in this process; set IGL_NUM_THREADS to the number of cores divided by it);" << endl;
         return 0;
     }
 
 
     double t_start = 
       std::chrono::duration<double>(
-          std::chrono::system_clock::now().time_since_epoch()).count();
+          std::chrono::steady_clock::now().time_since_epoch()).count();
     // load meshes (vertices and faces)
-    // Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> VA, VB;
-    // Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> FA, FB;
-    Eigen::MatrixXd VA, VB;
-    Eigen::MatrixXi FA, FB;
-    if (!igl::readOBJ(argv[1],VA,FA)){
+    Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> VA, VB;
+    Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> FA, FB;
+    // options of the refinement (wide_bvh also applies to a target file of B)
+    PompeiuHausdorffOptions options;
+    options.batch_size = argc>6 ? atoi(argv[6]) : 1;
+    options.recycle = argc>8 && atoi(argv[8]);
+    options.wide_bvh = argc>9 && atoi(argv[9]);
+    options.lazy = argc>10 && atoi(argv[10]);
+    options.adaptive_cascade = argc>11 && atoi(argv[11]);
+    // a streamed mesh A is read chunk by chunk during the computation
+    const int chunk_faces = argc>12 ? atoi(argv[12]) : 0;
+    if (chunk_faces==0 && !read_triangle_mesh_fast(argv[1],VA,FA)){
         cout << "Error loading mesh A \n" << endl;
         return 0;
     }
-    if (!igl::readOBJ(argv[2],VB,FB)){
+    // mesh B can be a target file (vertices, faces and BVH) to skip the BVH build
+    const std::string path_B = argv[2];
+    std::unique_ptr<PompeiuHausdorffTarget> target;
+    if (path_B.size()>5 && path_B.substr(path_B.size()-5)==".phdt"){
+        try
+        {
+          target.reset(new PompeiuHausdorffTarget(path_B, options.wide_bvh));
+        }
+        catch (const std::exception& e)
+        {
+          cout << "Error loading mesh B: " << e.what() << endl;
+          return 0;
+        }
+    } else if (!read_triangle_mesh_fast(path_B,VB,FB)){
         cout << "Error loading mesh B \n" << endl;
         return 0;
     }
-    if (!(FA.cols()==3)){
-        cout << "Error: mesh A is not a triangle mesh \n" << endl;
-        return 0;
-    }
-    if (!(FB.cols()==3)){
-        cout << "Error: mesh B is not a triangle mesh \n" << endl;
-        return 0;
-    }
 
     double t_end = 
       std::chrono::duration<double>(
-          std::chrono::system_clock::now().time_since_epoch()).count();
-    double time_taken = t_end - t_start;
-    // cout << "Load meshes time: " << time_taken << " secs" << endl;
+          std::chrono::steady_clock::now().time_since_epoch()).count();
+    double time_taken_load = 1000*(t_end - t_start);
 
     // If normalized calculations are required, calculate the length of the diagonal of the bounding box
     int normalize = atoi(argv[5]);
     double max_factor = atof(argv[4]);
     double tol = atof(argv[3]);
+    int symmetric = argc>7 ? atoi(argv[7]) : 0;
+    int processes = argc>13 ? atoi(argv[13]) : 0;
     
     double dA;
     double lower;
     double upper_max;
     double time_taken_bvh;
     double time_taken_bounds;
+    PompeiuHausdorffStats stats;
     try
     {
-      std::tie(lower, upper_max, dA, time_taken_bvh, time_taken_bounds) = 
-        pompeiu_hausdorff(VA, FA, VB, FB, tol, max_factor, normalize);
+      if (symmetric && target){
+        VB = target->VB;
+        FB = target->FB;
+      }
+      if (chunk_faces && symmetric){
+        throw std::runtime_error("A cannot be streamed for the symmetric distance");
+      }
+      if (processes && (symmetric || chunk_faces)){
+        throw std::runtime_error("Worker processes only compute the distance from a mesh A in memory");
+      }
+      if (processes){
+        if (!target){
+          target.reset(new PompeiuHausdorffTarget(VB, FB, options.wide_bvh));
+        }
+        std::tie(lower, upper_max, dA, time_taken_bvh, time_taken_bounds) = 
+          sharded_pompeiu_hausdorff(VA, FA, *target, processes, 0, tol, max_factor, normalize, options, &stats);
+        time_taken_bvh = target->time_taken_bvh;
+        stats.time_bvh = time_taken_bvh;
+      } else if (chunk_faces){
+        if (!target){
+          target.reset(new PompeiuHausdorffTarget(VB, FB, options.wide_bvh));
+        }
+        std::tie(lower, upper_max, dA, time_taken_bvh, time_taken_bounds) = 
+          streaming_pompeiu_hausdorff(argv[1], *target, chunk_faces, tol, max_factor, normalize, options, &stats);
+        time_taken_bvh = target->time_taken_bvh;
+        stats.time_bvh = time_taken_bvh;
+      } else if (symmetric){
+        std::tie(lower, upper_max, dA, time_taken_bvh, time_taken_bounds) = 
+          symmetric_pompeiu_hausdorff(VA, FA, VB, FB, tol, max_factor, normalize, options, &stats);
+      } else if (target){
+        std::tie(lower, upper_max, dA, time_taken_bvh, time_taken_bounds) = 
+          target->distance_from(VA, FA, tol, max_factor, normalize, options, &stats);
+        // time to open the target file instead of building the BVH
+        time_taken_bvh = target->time_taken_bvh;
+        stats.time_bvh = time_taken_bvh;
+      } else {
+        std::tie(lower, upper_max, dA, time_taken_bvh, time_taken_bounds) = 
+          pompeiu_hausdorff(VA, FA, VB, FB, tol, max_factor, normalize, options, &stats);
+      }
     }
     catch (const std::exception& e)
     {
@@ -87,8 +145,11 @@ int main(int argc, char *argv[])
     cout << "upper_max=" << upper_max << endl;
     cout << "lower/dA=" << lower/dA << endl;
     cout << "upper_max/dA=" << upper_max/dA << endl;
+    cout << "load_time(ms)=" << time_taken_load << endl;
     cout << "bvh_time(ms)=" << time_taken_bvh << endl;
     cout << "bound_time(ms)=" << time_taken_bounds << endl;
+    cout << "----- Stats -----" << endl;
+    cout << stats;
     cout << "----------------------------------------" << endl;
 
     return 1;
@@ -1,11 +1,126 @@
 #include "PompeiuHausdorff.h"
+#include "PompeiuHausdorffTarget.h"
 
 // libigl includes
 #include <igl/AABB.h>
+#include <igl/parallel_for.h>
+#include <igl/point_simplex_squared_distance.h>
 
 // Pompeiu-Hausdorff distance includes
 #include "upper_bounds.h"
-#include <chrono>
+#include "mapped_file.h"
+#include "pompeiu_hausdorff_helpers.h"
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+// Number of vertices and of face centroids of A sampled by the pre-pass of a
+// threshold decision
+#define THRESHOLD_SAMPLES 4096
+// Hinted points are moved onto A by scanning all its faces when there are at
+// most this many of them, with a BVH of A otherwise
+#define HINT_SCAN_POINTS 16
+
+namespace
+{
+    // Layout of a checkpoint file: this header followed by the stats and the
+    // arrays of the refinement, each starting at a 64-byte aligned offset.
+    // Arrays only hold the rows in use (below number_of_vertices and
+    // number_of_faces); vertices and faces are stored column by column, like
+    // VA_aug and FA_aug.
+    struct CheckpointFileHeader
+    {
+        char magic[8];
+        // 0x01020304 as written by the host (detects byte order mismatches)
+        uint32_t byte_order;
+        // sizeof(PompeiuHausdorffStats) and of an entry of the midpoint cache as
+        // written by the host
+        uint32_t stats_size;
+        uint32_t midpoint_entry_size;
+        // options of the refinement: 1 recycle, 2 lazy, 4 adaptive_cascade
+        uint32_t options;
+        // hashes of the input meshes A and B
+        uint64_t hash_A;
+        uint64_t hash_B;
+        double lower;
+        double lower_point[3];
+        double upper_max;
+        // see PompeiuHausdorff::upper_floor
+        double upper_floor;
+        double dA;
+        double tol;
+        double time_taken_bounds;
+        int64_t max_vertices;
+        int64_t max_faces;
+        int64_t batch_size;
+        int64_t number_of_vertices;
+        int64_t number_of_faces;
+        // rows allocated for VA_aug and FA_aug (and their companions)
+        int64_t allocated_vertices;
+        int64_t allocated_faces;
+        int64_t num_free_vertices;
+        int64_t num_free_faces;
+        int64_t num_queued;
+        int64_t queue_prune_size;
+        int64_t num_midpoints;
+        int64_t stats_offset;
+        int64_t vertices_offset;
+        int64_t closest_points_offset;
+        int64_t distances_offset;
+        int64_t closest_faces_offset;
+        int64_t faces_offset;
+        int64_t upper_offset;
+        int64_t depth_offset;
+        int64_t deferred_offset;
+        int64_t subdivided_offset;
+        int64_t free_vertices_offset;
+        int64_t free_faces_offset;
+        int64_t vertex_refs_offset;
+        int64_t vertex_generation_offset;
+        int64_t queue_upper_offset;
+        int64_t queue_faces_offset;
+        int64_t midpoints_offset;
+    };
+    const char checkpoint_file_magic[8] = {'P','H','D','C','K','P','0','3'};
+
+    int64_t align_64(const int64_t offset)
+    {
+        return (offset+63)/64*64;
+    }
+
+    // FNV-1a hash of a block of memory (8 bytes at a time), continued from h
+    uint64_t hash_bytes(const void * data, const size_t bytes, uint64_t h)
+    {
+        const uint64_t prime = UINT64_C(0x100000001b3);
+        const unsigned char * p = static_cast<const unsigned char *>(data);
+        size_t i = 0;
+        for (; i+8<=bytes; i+=8){
+            uint64_t word;
+            std::memcpy(&word,p+i,8);
+            h = (h^word)*prime;
+        }
+        for (; i<bytes; i++){
+            h = (h^p[i])*prime;
+        }
+        return h;
+    }
+
+    // Hash of the sizes, coordinates and indices of a mesh, to tell whether a
+    // checkpoint was written for it
+    uint64_t hash_mesh(const double * V, const int64_t num_vertices, const int * F, const int64_t num_faces)
+    {
+        const int64_t sizes[2] = {num_vertices,num_faces};
+        uint64_t h = UINT64_C(0xcbf29ce484222325);
+        h = hash_bytes(sizes,sizeof(sizes),h);
+        h = hash_bytes(V,num_vertices*3*sizeof(double),h);
+        return hash_bytes(F,num_faces*3*sizeof(int),h);
+    }
+}
 
 PompeiuHausdorff::PompeiuHausdorff(
     const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & VA,
@@ -14,11 +129,224 @@ PompeiuHausdorff::PompeiuHausdorff(
     const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> & FB,
     const double tol,
     const double max_factor,
-    const bool   normalize)
+    const bool   normalize,
+    const PompeiuHausdorffOptions & options,
+    const PompeiuHausdorffBudget & budget)
+{
+    const double deadline = now()+budget.time_limit/1000;
+    // Put mesh B into a libigl::AABB (or the wide BVH), kept for refine()
+    target_storage = std::make_shared<PompeiuHausdorffTarget>(VB,FB,options.wide_bvh);
+    const bool refinable = initialize(VA,FA,*target_storage,tol,max_factor,normalize,options,budget);
+    time_taken_bvh = target_storage->time_taken_bvh;
+    stats.time_bvh = time_taken_bvh;
+    if (refinable){
+        refine_until(deadline,budget);
+    }
+}
+
+PompeiuHausdorff::PompeiuHausdorff(
+    const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & VA,
+    const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> & FA,
+    const PompeiuHausdorffTarget & target,
+    const double tol,
+    const double max_factor,
+    const bool   normalize,
+    const PompeiuHausdorffOptions & options,
+    const PompeiuHausdorffBudget & budget)
+{
+    const double deadline = now()+budget.time_limit/1000;
+    if (initialize(VA,FA,target,tol,max_factor,normalize,options,budget)){
+        refine_until(deadline,budget);
+    }
+}
+
+PompeiuHausdorff::PompeiuHausdorff(
+    const std::string & checkpoint,
+    const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & VA,
+    const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> & FA,
+    const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & VB,
+    const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> & FB,
+    const bool   wide_bvh,
+    const PompeiuHausdorffBudget & budget)
 {
-    // timing variables
-    double t_start, t_end;
-    double time_taken;
+    const double deadline = now()+budget.time_limit/1000;
+    target_storage = std::make_shared<PompeiuHausdorffTarget>(VB,FB,wide_bvh);
+    resume(checkpoint,VA,FA,*target_storage);
+    time_taken_bvh = target_storage->time_taken_bvh;
+    stats.time_bvh += time_taken_bvh;
+    refine_until(deadline,budget);
+}
+
+PompeiuHausdorff::PompeiuHausdorff(
+    const std::string & checkpoint,
+    const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & VA,
+    const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> & FA,
+    const PompeiuHausdorffTarget & target,
+    const PompeiuHausdorffBudget & budget)
+{
+    const double deadline = now()+budget.time_limit/1000;
+    resume(checkpoint,VA,FA,target);
+    refine_until(deadline,budget);
+}
+
+PompeiuHausdorffExit PompeiuHausdorff::refine(const PompeiuHausdorffBudget & budget)
+{
+    return refine_until(now()+budget.time_limit/1000,budget);
+}
+
+PompeiuHausdorffExit PompeiuHausdorff::refine(const double tol, const PompeiuHausdorffBudget & budget)
+{
+    this->tol = tol;
+    return refine(budget);
+}
+
+PompeiuHausdorffExit PompeiuHausdorff::next_frame(
+    const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & VB,
+    const PompeiuHausdorffBudget & budget)
+{
+    if (!target_storage || target!=target_storage.get()){
+        throw std::runtime_error("next_frame(VB) needs a mesh B built by the constructor, move the target with update_vertices instead");
+    }
+    if (target_storage.use_count()>1){
+        // a copy of this object queries the same target: build our own
+        const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> FB = target_storage->FB;
+        target_storage = std::make_shared<PompeiuHausdorffTarget>(VB,FB,!target_storage->wide_treeB.empty());
+        target = target_storage.get();
+    } else {
+        target_storage->update_vertices(VB);
+    }
+    const double bvh = target_storage->time_taken_bvh;
+    const PompeiuHausdorffExit exit = next_frame(budget);
+    time_taken_bvh = bvh;
+    stats.time_bvh = bvh;
+    return exit;
+}
+
+PompeiuHausdorffExit PompeiuHausdorff::next_frame(const PompeiuHausdorffBudget & budget)
+{
+    if (recycle){
+        throw std::runtime_error("next_frame needs the subdivision of A, which recycle does not keep");
+    }
+    const double deadline = now()+budget.time_limit/1000;
+    if (!m_initialized){
+        // the sampled pre-pass answered the previous frame before the initial
+        // pass: there is no subdivision to keep, start over from A
+        const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> VA = VA_aug;
+        const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> FA = FA_aug;
+        PompeiuHausdorffOptions options;
+        options.batch_size = batch_size;
+        options.recycle = recycle;
+        options.lazy = lazy;
+        options.adaptive_cascade = adaptive_cascade;
+        if (initialize(VA,FA,*target,tol,max_factor,normalize,options,budget)){
+            refine_until(deadline,budget);
+        }
+        return exit_reason;
+    }
+    const PompeiuHausdorffTarget & target = *this->target;
+    const double threshold = budget.threshold;
+    exit_reason = PompeiuHausdorffExit::tolerance;
+    time_taken_bvh = 0;
+    const double t_start = now();
+    stats = PompeiuHausdorffStats();
+    double t_lap = 1000*t_start;
+    const auto lap = [&t_lap]()
+    {
+        const double t = 1000*now();
+        const double elapsed = t-t_lap;
+        t_lap = t;
+        return elapsed;
+    };
+
+    // Closest points of all the vertices of the subdivided mesh. B moved, so
+    // the previous closest triangle only bounds the distance.
+    igl::parallel_for(number_of_vertices,[&](const int v)
+    {
+        const Eigen::RowVector3d p = VA_aug.row(v);
+        int i = I_aug(v);
+        Eigen::RowVector3d c;
+        const double sqr_d = target.squared_distance(p,target.squared_distance_to_face(p,i,c),i,c);
+        DV_aug(v) = sqrt(sqr_d);
+        I_aug(v) = i;
+        C_aug.row(v) = c;
+    },1000);
+    int v;
+    lower = number_of_vertices>0 ? DV_aug.head(number_of_vertices).maxCoeff(&v) : 0;
+    lower_point = number_of_vertices>0 ? Eigen::RowVector3d(VA_aug.row(v)) : Eigen::RowVector3d::Zero();
+    stats.closest_point_queries = number_of_vertices;
+    Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> V = VA_aug.topRows(number_of_vertices);
+    if (budget.hint_points.rows()>0 || budget.hint_faces.size()>0){
+        // the faces of A come first in FA_aug (their subdivisions are also
+        // on A)
+        const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> F = FA_aug.topRows(number_of_faces);
+        query_hints(V,F,budget);
+    }
+    stats.time_queries += lap();
+
+    // Bounds of the leaves, which cover A
+    std::vector<int> leaves;
+    for (int f=0; f<number_of_faces; f++){
+        if (!subdivided[f]){
+            leaves.push_back(f);
+        }
+    }
+    Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> F(leaves.size(),3);
+    for (size_t k=0; k<leaves.size(); k++){
+        F.row(k) = FA_aug.row(leaves[k]);
+    }
+    const double level = threshold>lower ? threshold : lower;
+    Eigen::VectorXi success_bound(F.rows());
+    Eigen::VectorXd upper(F.rows());
+    if (!upper_bounds(V,F,target.faces_B,DV_aug,I_aug,C_aug,level,upper,success_bound,lazy)){
+        throw std::runtime_error("error in upper bound function");
+    }
+    upper_max = F.rows()>0 ? upper.maxCoeff() : 0;
+    upper_floor = level>lower ? std::min(level,upper_max) : 0;
+    for (int k=0; k<F.rows(); k++){
+        count_bounds(success_bound[k],true);
+    }
+    stats.time_bounds += lap();
+
+    // Queue the leaves that may be farther than the lower bound
+    Q = RefinementQueue();
+    for (size_t k=0; k<leaves.size(); k++){
+        const int f = leaves[k];
+        upper_aug(f) = upper(k);
+        stats.max_depth = std::max<int>(depth_aug[f],stats.max_depth);
+        if (upper(k)>=level){
+            Q.emplace(upper(k),f);
+        }
+        if (lazy){
+            deferred[f] = success_bound[k]==-1;
+        }
+    }
+    stats.time_queue += lap();
+    stats.peak_queue_size = Q.size();
+    stats.peak_allocated_bytes = allocated_bytes();
+    time_taken_bounds = 1000*(now()-t_start);
+    return refine_until(deadline,budget);
+}
+
+bool PompeiuHausdorff::initialize(
+    const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & VA,
+    const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> & FA,
+    const PompeiuHausdorffTarget & target,
+    const double tol,
+    const double max_factor,
+    const bool   normalize,
+    const PompeiuHausdorffOptions & options,
+    const PompeiuHausdorffBudget & budget)
+{
+    this->target = &target;
+    this->tol = tol;
+    this->max_factor = max_factor;
+    this->normalize = normalize;
+    batch_size = options.batch_size;
+    recycle = options.recycle;
+    lazy = options.lazy;
+    adaptive_cascade = options.adaptive_cascade;
+    exit_reason = PompeiuHausdorffExit::tolerance;
+    hash_A = hash_mesh(VA.data(),VA.rows(),FA.data(),FA.rows());
 
     if (normalize==1){
         double x_min_A = VA.col(0).minCoeff();
@@ -32,51 +360,119 @@ PompeiuHausdorff::PompeiuHausdorff(
         dA = 1.0;
     }
 
+    // mesh B, its AABB tree and its per-face data are owned by the target
+    const KangFaceData & faces_B = target.faces_B;
+    time_taken_bvh = 0;
+
+    // Start timing for initializations
+    const double t_start = now();
 
-    // Put mesh B into a libigl::AABB
-    t_start = std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
-    igl::AABB<Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor>,3> treeB;
-    treeB.init(VB,FB);
-    t_end = std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
-    time_taken_bvh = 1000*(t_end - t_start);
-    // cout << "libigl::AABB build time: " << time_taken << " secs" << endl;
+    // Time of each stage: lap() returns the milliseconds since its last call
+    stats = PompeiuHausdorffStats();
+    double t_lap = 1000*t_start;
+    const auto lap = [&t_lap]()
+    {
+        const double t = 1000*now();
+        const double elapsed = t-t_lap;
+        t_lap = t;
+        return elapsed;
+    };
 
-    // Start timing for initializations and beginning of the loop
-    t_start = std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+    // Locations hinted by the caller raise the lower bound before anything
+    // else
+    lower = 0;
+    lower_point = VA.rows()>0 ? Eigen::RowVector3d(VA.row(0)) : Eigen::RowVector3d::Zero();
+    query_hints(VA,FA,budget);
+    stats.time_queries += lap();
+
+    // Decision: query a sample of the vertices and face centroids of A
+    // first, a single one farther than the threshold answers without the
+    // initial pass (the others still raise the lower bound)
+    const double threshold = budget.threshold;
+    upper_floor = 0;
+    if (!std::isnan(threshold)){
+        const int vertex_stride = std::max<int>(1,VA.rows()/THRESHOLD_SAMPLES);
+        const int face_stride = std::max<int>(1,FA.rows()/THRESHOLD_SAMPLES);
+        Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> P((VA.rows()+vertex_stride-1)/vertex_stride+(FA.rows()+face_stride-1)/face_stride,3);
+        int n = 0;
+        for (int v=0; v<VA.rows(); v+=vertex_stride){
+            P.row(n++) = VA.row(v);
+        }
+        for (int f=0; f<FA.rows(); f+=face_stride){
+            P.row(n++) = (VA.row(FA(f,0))+VA.row(FA(f,1))+VA.row(FA(f,2)))/3;
+        }
+        Eigen::VectorXd sqrD;
+        Eigen::VectorXi I;
+        Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> C;
+        target.squared_distance(P,sqrD,I,C);
+        int p;
+        if (P.rows()>0 && sqrt(sqrD.maxCoeff(&p))>lower){
+            lower = sqrt(sqrD(p));
+            lower_point = P.row(p);
+        }
+        stats.closest_point_queries += P.rows();
+        stats.time_queries += lap();
+        if (lower>threshold){
+            upper_max = std::numeric_limits<double>::infinity();
+            number_of_vertices = 0;
+            number_of_faces = 0;
+            exit_reason = PompeiuHausdorffExit::above_threshold;
+            time_taken_bounds = 1000*(now()-t_start);
+            // keep A for next_frame, which starts over from here
+            VA_aug = VA;
+            FA_aug = FA;
+            m_initialized = false;
+            return false;
+        }
+    }
 
     // Initial distance queries
     Eigen::VectorXd DV(VA.rows());
     Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> C(VA.rows(),3);
     Eigen::VectorXi I(VA.rows());
-    treeB.squared_distance(VB,FB,VA,DV,I,C);
+    target.squared_distance(VA,DV,I,C);
     DV = DV.cwiseSqrt();
-    lower = DV.maxCoeff();
+    int v;
+    if (VA.rows()>0 && DV.maxCoeff(&v)>lower){
+        lower = DV(v);
+        lower_point = VA.row(v);
+    }
+    stats.closest_point_queries += VA.rows();
+    stats.time_queries += lap();
 
-    // initial upper bounds calculation
+    // initial upper bounds calculation (only the cheap ones if lazy). A
+    // decision only needs the triangles that may be farther than the
+    // threshold.
+    const double level = threshold>lower ? threshold : lower;
     Eigen::VectorXi success_bound(FA.rows());
     Eigen::VectorXd upper(FA.rows());
-    if (!upper_bounds(VA,FA,VB,FB,DV,I,C,lower,upper,success_bound)){
+    if (!upper_bounds(VA,FA,faces_B,DV,I,C,level,upper,success_bound,lazy)){
         throw std::runtime_error("error in upper bound function");
     }
     upper_max = upper.maxCoeff();
+    if (level>lower){
+        upper_floor = std::min(level,upper_max);
+    }
+    for (int k=0 ; k<FA.rows(); k++){
+        count_bounds(success_bound[k],true);
+    }
+    stats.time_bounds += lap();
 
     // Enqueue triangles with upper bound greater than global lower bound
-    // Clear the queque https://stackoverflow.com/a/2852183/148668
-    Q = decltype(Q)();
+    Q = RefinementQueue();
     for (int k=0 ; k<FA.rows(); k++){
-        if (upper[k]>=lower){
+        if (upper[k]>=level){
             Q.emplace(upper[k],k);
         }
     }
+    stats.time_queue += lap();
 
-    // Variables needed for the main loop
-    int max_vertices;
+    // Limits of the subdivided mesh
     if (max_factor*VA.rows()<INT_MAX){
         max_vertices = max_factor*VA.rows();
     } else {
         max_vertices = INT_MAX;
     }
-    int max_faces = max_factor*FA.rows();
     if (max_factor*FA.rows()<INT_MAX){
         max_faces = max_factor*FA.rows();
     } else {
@@ -91,10 +487,11 @@ PompeiuHausdorff::PompeiuHausdorff(
     //   I_aug
     // FA_aug.rows() → current number of faces allocated
     //   upper_aug
-    VA_aug.resize(std::min(16*(number_of_vertices+1),max_vertices),3);
-    if(VA_aug.rows() < number_of_vertices)
-    {
-      throw std::runtime_error("Exceeded maximum number of vertices");
+    // (recycled storage only needs to hold the queue, so start smaller)
+    const int initial_factor = recycle ? 2 : 16;
+    VA_aug.resize(std::min(initial_factor*(number_of_vertices+1),max_vertices),3);
+    if (VA_aug.rows() < number_of_vertices){
+        throw std::runtime_error("Exceeded maximum number of vertices");
     }
     VA_aug.topRows(VA.rows()) = VA;
     C_aug.resize(VA_aug.rows(),3);
@@ -104,131 +501,973 @@ PompeiuHausdorff::PompeiuHausdorff(
     DV_aug.head(VA.rows()) = DV;
     I_aug.head(VA.rows()) = I;
 
-    FA_aug.resize(std::min(16*(number_of_faces+1),max_faces),3);
-    if(FA_aug.rows() < number_of_faces)
-    {
-      throw std::runtime_error("Exceeded maximum number of faces");
+    FA_aug.resize(std::min(initial_factor*(number_of_faces+1),max_faces),3);
+    if (FA_aug.rows() < number_of_faces){
+        throw std::runtime_error("Exceeded maximum number of faces");
     }
     FA_aug.topRows(FA.rows()) = FA;
     upper_aug.resize(FA_aug.rows());
     upper_aug.head(FA.rows()) = upper;
+    depth_aug.assign(FA_aug.rows(),0);
+    subdivided.clear();
+    if (!recycle){
+        subdivided.assign(FA_aug.rows(),0);
+    }
+
+    // With recycle, a face row is alive while the face is queued and a vertex
+    // row while a queued face uses it. Dead rows go to free lists and are
+    // handed out again before the storage grows.
+    free_vertices.clear();
+    free_faces.clear();
+    vertex_refs.clear();
+    vertex_generation.assign(VA_aug.rows(),0);
+    midpoints.clear();
+    cascade_order = CascadeOrder(adaptive_cascade);
+    deferred.clear();
+    if (lazy){
+        deferred.assign(FA_aug.rows(),0);
+        for (int k=0; k<FA.rows(); k++){
+            deferred[k] = success_bound[k]==-1;
+        }
+    }
+    if (recycle){
+        vertex_refs.assign(VA_aug.rows(),0);
+        for (int k=0; k<FA.rows(); k++){
+            if (upper[k]>=level){
+                for (int c=0; c<3; c++){
+                    vertex_refs[FA(k,c)]++;
+                }
+            } else {
+                free_faces.push_back(k);
+            }
+        }
+        for (int v=0; v<number_of_vertices; v++){
+            if (vertex_refs[v]==0){
+                free_vertices.push_back(v);
+            }
+        }
+    }
+    stats.peak_queue_size = Q.size();
+    stats.peak_allocated_bytes = allocated_bytes();
+    stats.time_allocation += lap();
+    time_taken_bounds = 1000*(now()-t_start);
+    m_initialized = true;
+    return true;
+}
+
+PompeiuHausdorffExit PompeiuHausdorff::refine_until(
+    const double deadline,
+    const PompeiuHausdorffBudget & budget)
+{
+    if (!m_initialized){
+        throw std::runtime_error("nothing to refine");
+    }
+    const PompeiuHausdorffTarget & target = *this->target;
+    const KangFaceData & faces_B = target.faces_B;
+    const double t_start = now();
+    double t_lap = 1000*t_start;
+    const auto lap = [&t_lap]()
+    {
+        const double t = 1000*now();
+        const double elapsed = t-t_lap;
+        t_lap = t;
+        return elapsed;
+    };
+    const std::function<void(int)> on_pruned = recycle ? std::function<void(int)>([this](const int f){ release_face(f); }) : nullptr;
+
+    // Level below which triangles leave the queue: the lower bound, or the
+    // threshold of a decision above it (the triangles dropped in between are
+    // closer to B than the threshold, which upper_floor then keeps in
+    // upper_max)
+    const double threshold = budget.threshold;
+    // An earlier decision with a higher threshold dropped triangles that may
+    // be farther than this level: queue the leaves of the subdivision again
+    // from their stored bounds (recycle does not keep them)
+    if (upper_floor>(threshold>lower ? threshold : lower)){
+        if (recycle){
+            throw std::runtime_error("a decision released the triangles below its threshold, which recycle does not keep");
+        }
+        Q = RefinementQueue();
+        for (int f=0; f<number_of_faces; f++){
+            if (!subdivided[f] && upper_aug(f)>=lower){
+                Q.emplace(upper_aug(f),f);
+            }
+        }
+        upper_floor = 0;
+        if (!Q.empty()){
+            upper_max = Q.top().first;
+        }
+    }
+    const auto prune_level = [&]()
+    {
+        if (!(threshold>lower)){
+            return lower;
+        }
+        upper_floor = fmax(upper_floor,fmin(threshold,upper_max));
+        return threshold;
+    };
 
-    Eigen::VectorXd upper_new(4);
-    Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> FA_new(4,3);
-    Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> VA_new(3,3);
-    Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> VA_new_2(6,3), C_new_2(6,3);
-    Eigen::VectorXd DV_new_2(6);
-    Eigen::VectorXi I_new_2(6);
-    int f = Q.top().second;
+    // Scratch space for refining one popped triangle. Batched refinement keeps
+    // one slot per triangle in the batch so that workers never share
+    // temporaries. Everything is fixed-size, so that refining a triangle does
+    // not allocate any memory.
+    struct RefinementSlot
+    {
+        int f;
+        // rows of the three edge midpoints and of the four children
+        int v[3];
+        int children[4];
+        bool success;
+        Eigen::Vector4d upper_new;
+        Eigen::Vector4i success_bound_new;
+        // corners (rows 0-2) and edge midpoints (rows 3-5) of the triangle
+        Eigen::Matrix<double,6,3,Eigen::RowMajor> VA_new_2, C_new_2;
+        Eigen::Matrix<double,6,1> DV_new_2;
+        Eigen::Matrix<int,6,1> I_new_2;
+        // tallies of the expensive bounds (adaptive cascade)
+        CascadeCounters counters;
+        RefinementSlot(): f(-1), success(true) {}
+    };
+    // triangles popped in the current iteration
+    std::vector<int> popped;
+    // lazy: popped triangles whose cascade is finished in this iteration
+    std::vector<int> pending;
+    std::vector<char> pending_success;
+    // faces of the four children indexing into the rows of VA_new_2
+    Eigen::Matrix<int,4,3,Eigen::RowMajor> FA_new;
+    FA_new << 0, 3, 5,
+              3, 1, 4,
+              4, 2, 5,
+              3, 4, 5;
+    const int max_batch = std::max(batch_size,1);
+    std::vector<RefinementSlot,Eigen::aligned_allocator<RefinementSlot> > slots(max_batch);
+    // Midpoints created by the current batch: vertex row and edge endpoints
+    struct NewMidpoint
+    {
+        int v, a, b;
+    };
+    std::vector<NewMidpoint> new_midpoints;
+    new_midpoints.reserve(3*max_batch);
+    popped.reserve(max_batch);
+    pending.reserve(max_batch);
     int iter = 0;
-    Eigen::VectorXi success_bound_new(4);
+    double t_progress = t_start;
+    double t_checkpoint = t_start;
+    if (budget.progress){
+        budget.progress(lower,upper_max);
+    }
+    stats.time_allocation += lap();
+
+    // Add the time of this call and the tallies of Kang's bound and u4 on the
+    // refined triangles (any order) to time_taken_bounds and stats, so that
+    // they are up to date in checkpoints
+    double t_accounted = t_start;
+    const auto account = [&]()
+    {
+        const double t = now();
+        time_taken_bounds += 1000*(t-t_accounted);
+        t_accounted = t;
+        for (int b=0; b<max_batch; b++){
+            for (int k=0; k<2; k++){
+                stats.bound_attempts[3+k] += slots[b].counters.attempts[k];
+                stats.bound_successes[3+k] += slots[b].counters.successes[k];
+                slots[b].counters.attempts[k] = 0;
+                slots[b].counters.successes[k] = 0;
+            }
+        }
+    };
+
+    // Position and closest point on B of a new edge midpoint. The query is
+    // warm-started from the closest triangles of the two endpoints: the
+    // closer one bounds the distance, so the tree only has to be searched
+    // for closer triangles.
+    const auto query_midpoint = [&](const NewMidpoint & n)
+    {
+        VA_aug.row(n.v) = VA_aug.row(n.a)/2+VA_aug.row(n.b)/2;
+        const Eigen::RowVector3d p = VA_aug.row(n.v);
+        int i = I_aug(n.a);
+        Eigen::RowVector3d q;
+        double sqr_d = target.squared_distance_to_face(p,i,q);
+        if (I_aug(n.b)!=i){
+            Eigen::RowVector3d q_b;
+            const double sqr_d_b = target.squared_distance_to_face(p,I_aug(n.b),q_b);
+            if (sqr_d_b<sqr_d){
+                sqr_d = sqr_d_b;
+                i = I_aug(n.b);
+                q = q_b;
+            }
+        }
+        DV_aug(n.v) = sqrt(target.squared_distance(p,sqr_d,i,q));
+        I_aug(n.v) = i;
+        C_aug.row(n.v) = q;
+    };
+
+    // Subdivide the b-th triangle of the current batch into four children
+    // stored at face rows s.children, using the midpoints at vertex rows s.v
+    // (already queried), and compute their upper bounds. lower_batch is the
+    // global lower bound at the start of the batch (bounds computed with a
+    // smaller lower bound are still valid, the cascade just stops less
+    // often).
+    const auto refine_slot = [&](const int b, const double lower_batch)
+    {
+        RefinementSlot & s = slots[b];
+        const int f = s.f;
+        const int * v = s.v;
+
+        // new faces
+        const int * children = s.children;
+        FA_aug.row(children[0]) << FA_aug(f,0), v[0], v[2];
+        FA_aug.row(children[1]) << FA_aug(f,1), v[1], v[0];
+        FA_aug.row(children[2]) << FA_aug(f,2), v[2], v[1];
+        FA_aug.row(children[3]) << v[0], v[1], v[2];
+
+        // gather the corners and the midpoints of the triangle
+        for (int c=0; c<6; c++){
+            const int w = c<3 ? FA_aug(f,c) : v[c-3];
+            s.VA_new_2.row(c) = VA_aug.row(w);
+            s.C_new_2.row(c) = C_aug.row(w);
+            s.DV_new_2(c) = DV_aug(w);
+            s.I_new_2(c) = I_aug(w);
+        }
+        const double lower_slot = fmax(s.DV_new_2.tail<3>().maxCoeff(),lower_batch);
+
+        // calculate new upper bounds
+        s.success = upper_bounds(s.VA_new_2,FA_new,faces_B,s.DV_new_2,s.I_new_2,s.C_new_2,lower_slot,s.upper_new,s.success_bound_new,lazy,cascade_order,&s.counters);
+        // the children lie inside the triangle, so its (complete) bound also
+        // bounds them: lazy children only have their cheap bounds, which can
+        // be much looser
+        if (lazy){
+            s.upper_new = s.upper_new.cwiseMin(upper_aug(f));
+        }
+        for (int k=0; k<4; k++){
+            upper_aug(s.children[k]) = s.upper_new(k);
+        }
+    };
+
+    // Finish the cascade of a popped triangle whose expensive bounds were
+    // deferred (lazy), tightening its entry of upper_aug. counters belong to
+    // the worker.
+    const auto finish_bounds = [&](const int f, const double lower_batch, CascadeCounters & counters)
+    {
+        Eigen::Matrix<double,3,3,Eigen::RowMajor> V, CV;
+        Eigen::Vector3d D;
+        Eigen::Vector3i IV;
+        for (int c=0; c<3; c++){
+            V.row(c) = VA_aug.row(FA_aug(f,c));
+            CV.row(c) = C_aug.row(FA_aug(f,c));
+            D(c) = DV_aug(FA_aug(f,c));
+            IV(c) = I_aug(FA_aug(f,c));
+        }
+        int success_bound_f;
+        return expensive_upper_bound(V,D,IV,CV,faces_B,lower_batch,upper_aug(f),success_bound_f,cascade_order,&counters);
+    };
 
     // Loop while tolerance is not reached
-    while(upper_max-lower>tol*dA){
+    PompeiuHausdorffExit exit = PompeiuHausdorffExit::tolerance;
+    while (upper_max-lower>tol*dA){
+
+        // a decision ends as soon as either bound settles it
+        if (lower>threshold){
+            exit = PompeiuHausdorffExit::above_threshold;
+            break;
+        }
+        if (upper_max<=threshold){
+            exit = PompeiuHausdorffExit::below_threshold;
+            break;
+        }
+        // let the caller end the refinement early (bounds stay certified)
+        if (budget.stop && budget.stop(lower,upper_max)){
+            exit = PompeiuHausdorffExit::stopped;
+            break;
+        }
+        if (budget.cancel && budget.cancel->load()){
+            exit = PompeiuHausdorffExit::cancelled;
+            break;
+        }
+        if (budget.max_iterations>=0 && iter>=budget.max_iterations){
+            exit = PompeiuHausdorffExit::iteration_limit;
+            break;
+        }
+        if (now()>=deadline){
+            exit = PompeiuHausdorffExit::time_limit;
+            break;
+        }
 
         // throw error if the queue is empty
         if (Q.size()==0){
             cout << endl << endl << endl << "ERROR: queue got empty without reaching the given tolerance" << endl << endl << endl;
+            exit = PompeiuHausdorffExit::queue_empty;
             break;
         }
 
-        // next triangle is the one on the top of the queue
-        f = Q.top().second;
-        // pop triangle from the top of the queue
-        Q.pop();
+        // stop if there is no room for even one more subdivision
+        if (number_of_vertices+3 > max_vertices || number_of_faces+4 > max_faces){
+            exit = PompeiuHausdorffExit::memory_limit;
+            break;
+        }
 
-        // new vertices (midpoint subdivision)
-        if(number_of_vertices+3 > max_vertices)
-        {
-          throw std::runtime_error("Exceeded maximum number of vertices");
+        // number of triangles refined in this iteration
+        lap();
+        int batch = std::min<int>(max_batch,Q.size());
+        batch = std::min(batch,(max_vertices-number_of_vertices)/3);
+        batch = std::min(batch,(max_faces-number_of_faces)/4);
+
+        // make room for the new vertices and faces (at most max_vertices and
+        // max_faces rows, which the batch fits in)
+        while (number_of_vertices+3*batch > VA_aug.rows()){
+            VA_aug.conservativeResize(std::min<int64_t>(VA_aug.rows()*2,max_vertices),Eigen::NoChange);
+            C_aug.conservativeResize(VA_aug.rows(),Eigen::NoChange);
+            DV_aug.conservativeResize(VA_aug.rows());
+            I_aug.conservativeResize(VA_aug.rows());
+            vertex_generation.resize(VA_aug.rows(),0);
+            if (recycle){
+                vertex_refs.resize(VA_aug.rows(),0);
+            }
         }
-        if( (number_of_vertices+3) > VA_aug.rows())
-        {
-          VA_aug.conservativeResize(VA_aug.rows()*2,Eigen::NoChange);
-          C_aug.conservativeResize(VA_aug.rows(),Eigen::NoChange);
-          DV_aug.conservativeResize(VA_aug.rows());
-          I_aug.conservativeResize(VA_aug.rows());
+        while (number_of_faces+4*batch > FA_aug.rows()){
+            FA_aug.conservativeResize(std::min<int64_t>(FA_aug.rows()*2,max_faces),Eigen::NoChange);
+            upper_aug.conservativeResize(FA_aug.rows());
+            depth_aug.resize(FA_aug.rows(),0);
+            if (!recycle){
+                subdivided.resize(FA_aug.rows(),0);
+            }
+            if (lazy){
+                deferred.resize(FA_aug.rows(),0);
+            }
         }
-        VA_aug.row(number_of_vertices) = VA_aug.row(FA_aug(f,0))/2+VA_aug.row(FA_aug(f,1))/2;
-        VA_aug.row(number_of_vertices+1) = VA_aug.row(FA_aug(f,1))/2+VA_aug.row(FA_aug(f,2))/2;
-        VA_aug.row(number_of_vertices+2) = VA_aug.row(FA_aug(f,2))/2+VA_aug.row(FA_aug(f,0))/2;
+        stats.time_allocation += lap();
 
-        // new faces
-        if(number_of_faces+4 > max_faces)
-        {
-          throw std::runtime_error("Exceeded maximum number of faces");
+        // pop the batch of triangles from the top of the queue (the bounds
+        // of the batch only need to tell triangles above the prune level)
+        const double lower_batch = prune_level();
+        double upper_batch = 0;
+        popped.clear();
+        while ((int)popped.size()<batch && !Q.empty()){
+            const int first = popped.size();
+            while ((int)popped.size()<batch && !Q.empty()){
+                popped.push_back(Q.top().second);
+                Q.pop();
+            }
+            if (!lazy){
+                break;
+            }
+
+            // lazy: finish the cascade of the popped triangles that only have
+            // their cheap bounds (in parallel). A tightened triangle is
+            // refined now if its bound is still the largest, requeued if it
+            // is not (and replaced by the next one), and dropped if the lower
+            // bound rejects it.
+            pending.clear();
+            for (int b=first; b<(int)popped.size(); b++){
+                if (deferred[popped[b]]){
+                    pending.push_back(popped[b]);
+                }
+            }
+            pending_success.assign(pending.size(),1);
+            stats.time_queue += lap();
+            igl::parallel_for((int)pending.size(),[&](const int j)
+            {
+                pending_success[j] = finish_bounds(pending[j],lower_batch,slots[j].counters);
+            },2);
+            stats.time_bounds += lap();
+            for (size_t j=0; j<pending.size(); j++){
+                if (!pending_success[j]){
+                    throw std::runtime_error("error in upper bound function");
+                }
+            }
+            int kept = first;
+            for (int b=first; b<(int)popped.size(); b++){
+                const int f = popped[b];
+                if (!deferred[f]){
+                    popped[kept++] = f;
+                    continue;
+                }
+                deferred[f] = 0;
+                if (upper_aug(f)<lower_batch){
+                    upper_batch = fmax(upper_aug(f),upper_batch);
+                    if (recycle){
+                        release_face(f);
+                    }
+                } else if (Q.empty() || upper_aug(f)>=Q.top().first){
+                    popped[kept++] = f;
+                } else {
+                    Q.emplace(upper_aug(f),f);
+                }
+            }
+            popped.resize(kept);
         }
-        if( (number_of_faces+4) > FA_aug.rows())
-        {
-          FA_aug.conservativeResize(FA_aug.rows()*2,Eigen::NoChange);
-          upper_aug.conservativeResize(FA_aug.rows());
+        batch = popped.size();
+        stats.time_queue += lap();
+
+        // give each triangle to refine rows for its midpoints and children
+        // (free rows first, then rows past the ones in use). A midpoint
+        // already created by the triangle on the other side of the edge is
+        // reused, with its closest point.
+        new_midpoints.clear();
+        for (int b=0; b<batch; b++){
+            RefinementSlot & s = slots[b];
+            s.f = popped[b];
+            for (int k=0; k<3; k++){
+                const int a = FA_aug(s.f,k);
+                const int e = FA_aug(s.f,(k+1)%3);
+                if (midpoints.take(a,e,vertex_generation,s.v[k])){
+                    continue;
+                }
+                if (free_vertices.empty()){
+                    s.v[k] = number_of_vertices++;
+                } else {
+                    s.v[k] = free_vertices.back();
+                    free_vertices.pop_back();
+                }
+                midpoints.insert(a,e,s.v[k],vertex_generation);
+                NewMidpoint n = {s.v[k],a,e};
+                new_midpoints.push_back(n);
+            }
+            for (int k=0; k<4; k++){
+                if (free_faces.empty()){
+                    s.children[k] = number_of_faces++;
+                } else {
+                    s.children[k] = free_faces.back();
+                    free_faces.pop_back();
+                }
+            }
         }
 
-        FA_aug.block(number_of_faces,0,4,3) << FA_aug(f,0), number_of_vertices, number_of_vertices+2, FA_aug(f,1), number_of_vertices+1, number_of_vertices, FA_aug(f,2), number_of_vertices+2, number_of_vertices+1, number_of_vertices, number_of_vertices+1, number_of_vertices+2;
+        // query the new midpoints, then refine the batch (both in parallel if
+        // there is more than one)
+        lap();
+        igl::parallel_for((int)new_midpoints.size(),[&](const int i)
+        {
+            query_midpoint(new_midpoints[i]);
+        },2);
+        stats.closest_point_queries += new_midpoints.size();
+        stats.time_queries += lap();
+        igl::parallel_for(batch,[&](const int b)
+        {
+            refine_slot(b,lower_batch);
+        },2);
+        stats.time_bounds += lap();
 
-        // update lower bound
-        VA_new = VA_aug.block(number_of_vertices,0,3,3);
-        treeB.squared_distance(VB,FB,VA_new,DV,I,C);
-        DV = DV.cwiseSqrt();
-        DV_aug.segment(number_of_vertices,3) = DV;
-        I_aug.segment(number_of_vertices,3) = I;
-        C_aug.block(number_of_vertices,0,3,3) = C;
-        lower = fmax(DV.maxCoeff(),lower);
+        // Merge in pop order so that the result does not depend on the number
+        // of threads. First update the lower bound with all new vertices.
+        for (int b=0; b<batch; b++){
+            if (!slots[b].success){
+                throw std::runtime_error("error in upper bound function");
+            }
+            int c;
+            if (slots[b].DV_new_2.tail<3>().maxCoeff(&c)>lower){
+                lower = slots[b].DV_new_2(3+c);
+                lower_point = slots[b].VA_new_2.row(3+c);
+            }
+            upper_batch = fmax(slots[b].upper_new.maxCoeff(),upper_batch);
+        }
+        upper_max = Q.empty() ? upper_batch : fmax(upper_batch,Q.top().first);
+        upper_max = fmax(upper_max,upper_floor);
 
-        // calculate new upper bounds
-        FA_new = FA_aug.block(number_of_faces,0,4,3);
-        VA_new_2.row(0) = VA_aug.row(FA_aug(f,0));
-        VA_new_2.row(1) = VA_aug.row(FA_aug(f,1));
-        VA_new_2.row(2) = VA_aug.row(FA_aug(f,2));
-        VA_new_2.row(3) = VA_aug.row(number_of_vertices);
-        VA_new_2.row(4) = VA_aug.row(number_of_vertices+1);
-        VA_new_2.row(5) = VA_aug.row(number_of_vertices+2);
-        C_new_2.row(0) = C_aug.row(FA_aug(f,0));
-        C_new_2.row(1) = C_aug.row(FA_aug(f,1));
-        C_new_2.row(2) = C_aug.row(FA_aug(f,2));
-        C_new_2.row(3) = C_aug.row(number_of_vertices);
-        C_new_2.row(4) = C_aug.row(number_of_vertices+1);
-        C_new_2.row(5) = C_aug.row(number_of_vertices+2);
-        FA_new(0,0) = 0; FA_new(0,1) = 3; FA_new(0,2) = 5;
-        FA_new(1,0) = 3; FA_new(1,1) = 1; FA_new(1,2) = 4;
-        FA_new(2,0) = 4; FA_new(2,1) = 2; FA_new(2,2) = 5;
-        FA_new(3,0) = 3; FA_new(3,1) = 4; FA_new(3,2) = 5;
-        DV_new_2(0) = DV_aug(FA_aug(f,0));
-        DV_new_2(1) = DV_aug(FA_aug(f,1));
-        DV_new_2(2) = DV_aug(FA_aug(f,2));
-        DV_new_2.segment(3,3) = DV;
-        I_new_2(0) = I_aug(FA_aug(f,0));
-        I_new_2(1) = I_aug(FA_aug(f,1));
-        I_new_2(2) = I_aug(FA_aug(f,2));
-        I_new_2.segment(3,3) = I;
-
-        if (!upper_bounds(VA_new_2,FA_new,VB,FB,DV_new_2,I_new_2,C_new_2,lower,upper_new,success_bound_new)){
-          throw std::runtime_error("error in upper bound function");
-        }
-        upper_aug.segment(number_of_faces,4) = upper_new;
-        upper_max = fmax(upper_new.maxCoeff(),Q.top().first);
+        // re-plan the cascade from the tallies of every worker
+        if (adaptive_cascade){
+            for (int b=0; b<max_batch; b++){
+                cascade_order.update(slots[b].counters);
+            }
+        }
 
         // enqueue triangles with upper bound greater than current lower bound
-        for (int k=0; k<4; k++){
-            if (upper_new[k]>=lower){
-                Q.emplace(upper_new[k],number_of_faces+k);
+        lap();
+        const double level = prune_level();
+        for (int b=0; b<batch; b++){
+            const RefinementSlot & s = slots[b];
+            if (!recycle){
+                subdivided[s.f] = 1;
+            }
+            for (int k=0; k<4; k++){
+                count_bounds(s.success_bound_new[k],false);
+                depth_aug[s.children[k]] = depth_aug[s.f]+1;
+                stats.max_depth = std::max<int>(depth_aug[s.children[k]],stats.max_depth);
+                if (s.upper_new[k]>=level){
+                    Q.emplace(s.upper_new[k],s.children[k]);
+                    if (lazy){
+                        deferred[s.children[k]] = s.success_bound_new[k]==-1;
+                    }
+                    if (recycle){
+                        for (int c=0; c<3; c++){
+                            vertex_refs[FA_aug(s.children[k],c)]++;
+                        }
+                    }
+                } else if (recycle){
+                    free_faces.push_back(s.children[k]);
+                }
+            }
+        }
+        // the subdivided triangles are dead, and so are the new midpoints that
+        // no queued child uses (only once all children hold their references,
+        // since vertices can be shared within a batch)
+        if (recycle){
+            for (int b=0; b<batch; b++){
+                release_face(slots[b].f);
+            }
+            for (size_t i=0; i<new_midpoints.size(); i++){
+                if (vertex_refs[new_midpoints[i].v]==0){
+                    release_vertex(new_midpoints[i].v);
+                }
             }
         }
 
-        // Update total number of vertices and faces (even if these faces don't get into the queue)
-        number_of_vertices = number_of_vertices + 3;
-        number_of_faces = number_of_faces + 4;
+        stats.peak_queue_size = std::max(Q.size(),stats.peak_queue_size);
+        stats.peak_allocated_bytes = std::max(allocated_bytes(),stats.peak_allocated_bytes);
 
-        // throw error if number of faces or vertices exceeds the maximum
-        if (number_of_faces>max_faces-4 || number_of_vertices>max_vertices-3){
-            throw std::runtime_error("Exceeded maximum number of faces or vertices");
-        }
+        // drop queued triangles that the raised lower bound rejects
+        Q.lazy_prune(level,on_pruned);
+        stats.time_queue += lap();
 
         // update number of itrations
         iter++;
+        stats.iterations++;
+
+        if (budget.progress && 1000*(now()-t_progress)>=budget.progress_interval){
+            t_progress = now();
+            budget.progress(lower,upper_max);
+        }
+        if (!budget.checkpoint.empty() && 1000*(now()-t_checkpoint)>=budget.checkpoint_interval){
+            account();
+            save_checkpoint(budget.checkpoint);
+            t_checkpoint = now();
+        }
+    }
+
+    lap();
+    Q.prune(prune_level(),on_pruned);
+    stats.time_queue += lap();
+
+    // a decision settled along with the tolerance
+    if (exit==PompeiuHausdorffExit::tolerance && lower>threshold){
+        exit = PompeiuHausdorffExit::above_threshold;
+    } else if (exit==PompeiuHausdorffExit::tolerance && upper_max<=threshold){
+        exit = PompeiuHausdorffExit::below_threshold;
+    }
+
+    account();
+    exit_reason = exit;
+    if (!budget.checkpoint.empty()){
+        save_checkpoint(budget.checkpoint);
+    }
+    if (budget.progress){
+        budget.progress(lower,upper_max);
+    }
+    return exit;
+}
+
+void PompeiuHausdorff::save_checkpoint(const std::string & path) const
+{
+    if (!m_initialized){
+        throw std::runtime_error("nothing to checkpoint");
+    }
+    const int64_t nv = number_of_vertices;
+    const int64_t nf = number_of_faces;
+    CheckpointFileHeader header;
+    std::memset(&header,0,sizeof(header));
+    std::memcpy(header.magic,checkpoint_file_magic,sizeof(header.magic));
+    header.byte_order = 0x01020304;
+    header.stats_size = sizeof(PompeiuHausdorffStats);
+    header.midpoint_entry_size = EdgeMidpointCache::entry_size();
+    header.options = (recycle ? 1 : 0) | (lazy ? 2 : 0) | (adaptive_cascade ? 4 : 0);
+    header.hash_A = hash_A;
+    header.hash_B = hash_mesh(target->VB.data(),target->VB.rows(),target->FB.data(),target->FB.rows());
+    header.lower = lower;
+    for (int d=0; d<3; d++){
+        header.lower_point[d] = lower_point(d);
+    }
+    header.upper_max = upper_max;
+    header.upper_floor = upper_floor;
+    header.dA = dA;
+    header.tol = tol;
+    header.time_taken_bounds = time_taken_bounds;
+    header.max_vertices = max_vertices;
+    header.max_faces = max_faces;
+    header.batch_size = batch_size;
+    header.number_of_vertices = nv;
+    header.number_of_faces = nf;
+    header.allocated_vertices = VA_aug.rows();
+    header.allocated_faces = FA_aug.rows();
+    header.num_free_vertices = free_vertices.size();
+    header.num_free_faces = free_faces.size();
+    header.num_queued = Q.size();
+    header.queue_prune_size = Q.prune_size();
+    header.num_midpoints = midpoints.capacity();
+    header.stats_offset = align_64(sizeof(header));
+    header.vertices_offset = align_64(header.stats_offset+sizeof(PompeiuHausdorffStats));
+    header.closest_points_offset = align_64(header.vertices_offset+nv*3*sizeof(double));
+    header.distances_offset = align_64(header.closest_points_offset+nv*3*sizeof(double));
+    header.closest_faces_offset = align_64(header.distances_offset+nv*sizeof(double));
+    header.faces_offset = align_64(header.closest_faces_offset+nv*sizeof(int));
+    header.upper_offset = align_64(header.faces_offset+nf*3*sizeof(int));
+    header.depth_offset = align_64(header.upper_offset+nf*sizeof(double));
+    header.deferred_offset = align_64(header.depth_offset+nf);
+    header.subdivided_offset = align_64(header.deferred_offset+(lazy ? nf : 0));
+    header.free_vertices_offset = align_64(header.subdivided_offset+(recycle ? 0 : nf));
+    header.free_faces_offset = align_64(header.free_vertices_offset+header.num_free_vertices*sizeof(int));
+    header.vertex_refs_offset = align_64(header.free_faces_offset+header.num_free_faces*sizeof(int));
+    header.vertex_generation_offset = align_64(header.vertex_refs_offset+(recycle ? nv : 0)*sizeof(int));
+    header.queue_upper_offset = align_64(header.vertex_generation_offset+nv*sizeof(uint32_t));
+    header.queue_faces_offset = align_64(header.queue_upper_offset+header.num_queued*sizeof(double));
+    header.midpoints_offset = align_64(header.queue_faces_offset+header.num_queued*sizeof(int));
+
+    // queue entries in heap order
+    std::vector<double> queue_upper(Q.size());
+    std::vector<int> queue_faces(Q.size());
+    for (size_t i=0; i<Q.size(); i++){
+        queue_upper[i] = Q[i].first;
+        queue_faces[i] = Q[i].second;
+    }
+
+    // write next to the checkpoint, which is replaced once the file is
+    // complete
+    const std::string tmp_path = path + ".tmp";
+    {
+        std::ofstream out(tmp_path.c_str(),std::ios::binary);
+        if (!out){
+            throw std::runtime_error("Could not open " + tmp_path + " for writing");
+        }
+        const char padding[64] = {0};
+        const auto write_at = [&](const int64_t offset, const void * data, const int64_t bytes)
+        {
+            out.write(padding,offset-out.tellp());
+            out.write(static_cast<const char *>(data),bytes);
+        };
+        out.write(reinterpret_cast<const char *>(&header),sizeof(header));
+        write_at(header.stats_offset,&stats,sizeof(PompeiuHausdorffStats));
+        for (int c=0; c<3; c++){
+            write_at(header.vertices_offset+c*nv*sizeof(double),VA_aug.col(c).data(),nv*sizeof(double));
+        }
+        write_at(header.closest_points_offset,C_aug.data(),nv*3*sizeof(double));
+        write_at(header.distances_offset,DV_aug.data(),nv*sizeof(double));
+        write_at(header.closest_faces_offset,I_aug.data(),nv*sizeof(int));
+        for (int c=0; c<3; c++){
+            write_at(header.faces_offset+c*nf*sizeof(int),FA_aug.col(c).data(),nf*sizeof(int));
+        }
+        write_at(header.upper_offset,upper_aug.data(),nf*sizeof(double));
+        write_at(header.depth_offset,depth_aug.data(),nf);
+        write_at(header.deferred_offset,deferred.data(),lazy ? nf : 0);
+        write_at(header.subdivided_offset,subdivided.data(),recycle ? 0 : nf);
+        write_at(header.free_vertices_offset,free_vertices.data(),header.num_free_vertices*sizeof(int));
+        write_at(header.free_faces_offset,free_faces.data(),header.num_free_faces*sizeof(int));
+        write_at(header.vertex_refs_offset,vertex_refs.data(),(recycle ? nv : 0)*sizeof(int));
+        write_at(header.vertex_generation_offset,vertex_generation.data(),nv*sizeof(uint32_t));
+        write_at(header.queue_upper_offset,queue_upper.data(),header.num_queued*sizeof(double));
+        write_at(header.queue_faces_offset,queue_faces.data(),header.num_queued*sizeof(int));
+        write_at(header.midpoints_offset,midpoints.data(),header.num_midpoints*EdgeMidpointCache::entry_size());
+        out.close();
+        if (!out){
+            throw std::runtime_error("Could not write " + tmp_path);
+        }
+    }
+    if (std::rename(tmp_path.c_str(),path.c_str())!=0){
+        // (Windows does not rename over an existing file)
+        std::remove(path.c_str());
+        if (std::rename(tmp_path.c_str(),path.c_str())!=0){
+            throw std::runtime_error("Could not write " + path);
+        }
+    }
+}
+
+void PompeiuHausdorff::resume(
+    const std::string & checkpoint,
+    const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & VA,
+    const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> & FA,
+    const PompeiuHausdorffTarget & target)
+{
+    const double t_start = now();
+    const MappedFile file(checkpoint);
+
+    // Validate the header and the extent of every array
+    CheckpointFileHeader header;
+    if (file.size()<sizeof(header)){
+        throw std::runtime_error(checkpoint + " is not a checkpoint file");
+    }
+    std::memcpy(&header,file.data(),sizeof(header));
+    if (std::memcmp(header.magic,checkpoint_file_magic,sizeof(header.magic))!=0){
+        throw std::runtime_error(checkpoint + " is not a checkpoint file");
+    }
+    if (header.byte_order!=0x01020304 || header.stats_size!=sizeof(PompeiuHausdorffStats) ||
+        header.midpoint_entry_size!=EdgeMidpointCache::entry_size()){
+        throw std::runtime_error(checkpoint + " was written on an incompatible platform");
+    }
+    const bool recycle = header.options & 1;
+    const bool lazy = header.options & 2;
+    const int64_t nv = header.number_of_vertices;
+    const int64_t nf = header.number_of_faces;
+    const int64_t size = file.size();
+    const auto fits = [size](const int64_t offset, const int64_t count, const int64_t item_size)
+    {
+        return offset>=0 && offset<=size && count>=0 && count<=(size-offset)/item_size;
+    };
+    if (nv<0 || nf<0 ||
+        header.max_vertices>std::numeric_limits<int>::max() ||
+        header.max_faces>std::numeric_limits<int>::max() ||
+        header.batch_size>std::numeric_limits<int>::max() ||
+        header.allocated_vertices<nv || header.allocated_vertices>header.max_vertices ||
+        header.allocated_faces<nf || header.allocated_faces>header.max_faces ||
+        header.num_free_vertices>nv || header.num_free_faces>nf || header.num_queued>nf ||
+        header.num_midpoints<4 || header.num_midpoints>std::numeric_limits<int>::max() ||
+        (header.num_midpoints&(header.num_midpoints-1))!=0 ||
+        !fits(header.stats_offset,1,sizeof(PompeiuHausdorffStats)) ||
+        !fits(header.vertices_offset,nv*3,sizeof(double)) ||
+        !fits(header.closest_points_offset,nv*3,sizeof(double)) ||
+        !fits(header.distances_offset,nv,sizeof(double)) ||
+        !fits(header.closest_faces_offset,nv,sizeof(int)) ||
+        !fits(header.faces_offset,nf*3,sizeof(int)) ||
+        !fits(header.upper_offset,nf,sizeof(double)) ||
+        !fits(header.depth_offset,nf,1) ||
+        !fits(header.deferred_offset,lazy ? nf : 0,1) ||
+        !fits(header.subdivided_offset,recycle ? 0 : nf,1) ||
+        !fits(header.free_vertices_offset,header.num_free_vertices,sizeof(int)) ||
+        !fits(header.free_faces_offset,header.num_free_faces,sizeof(int)) ||
+        !fits(header.vertex_refs_offset,recycle ? nv : 0,sizeof(int)) ||
+        !fits(header.vertex_generation_offset,nv,sizeof(uint32_t)) ||
+        !fits(header.queue_upper_offset,header.num_queued,sizeof(double)) ||
+        !fits(header.queue_faces_offset,header.num_queued,sizeof(int)) ||
+        !fits(header.midpoints_offset,header.num_midpoints,EdgeMidpointCache::entry_size())){
+        throw std::runtime_error(checkpoint + " is truncated or corrupted");
+    }
+    hash_A = hash_mesh(VA.data(),VA.rows(),FA.data(),FA.rows());
+    if (hash_A!=header.hash_A){
+        throw std::runtime_error(checkpoint + " was written for another mesh A");
+    }
+    if (hash_mesh(target.VB.data(),target.VB.rows(),target.FB.data(),target.FB.rows())!=header.hash_B){
+        throw std::runtime_error(checkpoint + " was written for another mesh B");
+    }
+
+    // The refinement follows the stored indices without checking them, so
+    // check them once here: faces name vertices of A_aug, vertices name
+    // their closest triangle of B, and the free lists and the queue name
+    // rows of A_aug
+    const char * data = file.data();
+    const auto in_range = [data](const int64_t offset, const int64_t count, const int64_t end)
+    {
+        const int * values = reinterpret_cast<const int *>(data+offset);
+        for (int64_t i=0; i<count; i++){
+            if (values[i]<0 || values[i]>=end){
+                return false;
+            }
+        }
+        return true;
+    };
+    if (!in_range(header.faces_offset,nf*3,nv) ||
+        !in_range(header.closest_faces_offset,nv,target.FB.rows()) ||
+        !in_range(header.free_vertices_offset,header.num_free_vertices,nv) ||
+        !in_range(header.free_faces_offset,header.num_free_faces,nf) ||
+        !in_range(header.queue_faces_offset,header.num_queued,nf)){
+        throw std::runtime_error(checkpoint + " is truncated or corrupted");
+    }
+
+    // Copy the state out of the mapping into storage that can grow
+    this->target = &target;
+    this->tol = header.tol;
+    this->batch_size = header.batch_size;
+    this->recycle = recycle;
+    this->lazy = lazy;
+    this->adaptive_cascade = header.options & 4;
+    m_initialized = true;
+    exit_reason = PompeiuHausdorffExit::tolerance;
+    lower = header.lower;
+    lower_point = Eigen::RowVector3d(header.lower_point[0],header.lower_point[1],header.lower_point[2]);
+    upper_max = header.upper_max;
+    upper_floor = header.upper_floor;
+    dA = header.dA;
+    time_taken_bvh = 0;
+    time_taken_bounds = header.time_taken_bounds;
+    std::memcpy(&stats,data+header.stats_offset,sizeof(PompeiuHausdorffStats));
+    max_vertices = header.max_vertices;
+    max_faces = header.max_faces;
+    number_of_vertices = nv;
+    number_of_faces = nf;
+
+    VA_aug.resize(header.allocated_vertices,3);
+    C_aug.resize(VA_aug.rows(),3);
+    DV_aug.resize(VA_aug.rows());
+    I_aug.resize(VA_aug.rows());
+    for (int c=0; c<3; c++){
+        std::memcpy(VA_aug.col(c).data(),data+header.vertices_offset+c*nv*sizeof(double),nv*sizeof(double));
+    }
+    std::memcpy(C_aug.data(),data+header.closest_points_offset,nv*3*sizeof(double));
+    std::memcpy(DV_aug.data(),data+header.distances_offset,nv*sizeof(double));
+    std::memcpy(I_aug.data(),data+header.closest_faces_offset,nv*sizeof(int));
+
+    FA_aug.resize(header.allocated_faces,3);
+    upper_aug.resize(FA_aug.rows());
+    for (int c=0; c<3; c++){
+        std::memcpy(FA_aug.col(c).data(),data+header.faces_offset+c*nf*sizeof(int),nf*sizeof(int));
+    }
+    std::memcpy(upper_aug.data(),data+header.upper_offset,nf*sizeof(double));
+    depth_aug.assign(FA_aug.rows(),0);
+    std::memcpy(depth_aug.data(),data+header.depth_offset,nf);
+    deferred.clear();
+    if (lazy){
+        deferred.assign(FA_aug.rows(),0);
+        std::memcpy(deferred.data(),data+header.deferred_offset,nf);
+    }
+    subdivided.clear();
+    if (!recycle){
+        subdivided.assign(FA_aug.rows(),0);
+        std::memcpy(subdivided.data(),data+header.subdivided_offset,nf);
+    }
+
+    const int * free_vertices_data = reinterpret_cast<const int *>(data+header.free_vertices_offset);
+    free_vertices.assign(free_vertices_data,free_vertices_data+header.num_free_vertices);
+    const int * free_faces_data = reinterpret_cast<const int *>(data+header.free_faces_offset);
+    free_faces.assign(free_faces_data,free_faces_data+header.num_free_faces);
+    vertex_refs.clear();
+    if (recycle){
+        vertex_refs.assign(VA_aug.rows(),0);
+        std::memcpy(vertex_refs.data(),data+header.vertex_refs_offset,nv*sizeof(int));
+    }
+    vertex_generation.assign(VA_aug.rows(),0);
+    std::memcpy(vertex_generation.data(),data+header.vertex_generation_offset,nv*sizeof(uint32_t));
 
+    std::vector<RefinementQueue::value_type> heap(header.num_queued);
+    const double * queue_upper = reinterpret_cast<const double *>(data+header.queue_upper_offset);
+    const int * queue_faces = reinterpret_cast<const int *>(data+header.queue_faces_offset);
+    for (int64_t i=0; i<header.num_queued; i++){
+        heap[i] = RefinementQueue::value_type(queue_upper[i],queue_faces[i]);
+    }
+    if (header.queue_prune_size<0 ||
+        !Q.assign(std::move(heap),header.queue_prune_size) ||
+        !midpoints.assign(data+header.midpoints_offset,header.num_midpoints,nv)){
+        throw std::runtime_error(checkpoint + " is truncated or corrupted");
     }
+    // the measurements of the adaptive cascade start over
+    cascade_order = CascadeOrder(adaptive_cascade);
 
-    t_end = std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
-    time_taken_bounds = 1000*(t_end - t_start);
+    const double elapsed = 1000*(now()-t_start);
+    stats.time_allocation += elapsed;
+    time_taken_bounds += elapsed;
+}
+
+void PompeiuHausdorff::query_hints(
+    const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & VA,
+    const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> & FA,
+    const PompeiuHausdorffBudget & budget)
+{
+    const int num_points = FA.rows()>0 ? budget.hint_points.rows() : 0;
+    const int num_faces = budget.hint_faces.size();
+    if (budget.hint_barycentric.rows()!=num_faces){
+        throw std::runtime_error("hint_faces and hint_barycentric have different sizes");
+    }
+    if (num_points+num_faces==0){
+        return;
+    }
+    Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> P(num_points+num_faces,3);
+    Eigen::VectorXd sqrD;
+    Eigen::VectorXi I;
+    Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> C;
+    if (num_points>HINT_SCAN_POINTS){
+        // closest points of A to the hinted points
+        igl::AABB<Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor>,3> treeA;
+        treeA.init(VA,FA);
+        treeA.squared_distance(VA,FA,budget.hint_points,sqrD,I,C);
+        P.topRows(num_points) = C;
+    } else if (num_points>0){
+        // closest points of each block of faces of A, then of all of them
+        const int block_size = 4096;
+        const int number_of_blocks = (FA.rows()+block_size-1)/block_size;
+        std::vector<double> block_sqr_d(number_of_blocks*num_points);
+        Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> block_c(number_of_blocks*num_points,3);
+        igl::parallel_for(number_of_blocks,[&](const int block)
+        {
+            const int last = std::min<int>((block+1)*block_size,FA.rows());
+            for (int h=0; h<num_points; h++){
+                const Eigen::RowVector3d p = budget.hint_points.row(h);
+                double best = std::numeric_limits<double>::infinity();
+                Eigen::RowVector3d best_c = p;
+                for (int f=block*block_size; f<last; f++){
+                    double sqr_d;
+                    Eigen::RowVector3d c;
+                    igl::point_simplex_squared_distance<3>(p,VA,FA,f,sqr_d,c);
+                    if (sqr_d<best){
+                        best = sqr_d;
+                        best_c = c;
+                    }
+                }
+                block_sqr_d[block*num_points+h] = best;
+                block_c.row(block*num_points+h) = best_c;
+            }
+        },1);
+        for (int h=0; h<num_points; h++){
+            double best = std::numeric_limits<double>::infinity();
+            for (int block=0; block<number_of_blocks; block++){
+                if (block_sqr_d[block*num_points+h]<best){
+                    best = block_sqr_d[block*num_points+h];
+                    P.row(h) = block_c.row(block*num_points+h);
+                }
+            }
+        }
+    }
+    for (int h=0; h<num_faces; h++){
+        const int f = budget.hint_faces(h);
+        if (f<0 || f>=FA.rows()){
+            throw std::runtime_error("hint face out of range");
+        }
+        Eigen::RowVector3d b = budget.hint_barycentric.row(h).cwiseMax(0.0);
+        b = b.sum()>0 ? Eigen::RowVector3d(b/b.sum()) : Eigen::RowVector3d::Constant(1.0/3);
+        P.row(num_points+h) = b(0)*VA.row(FA(f,0))+b(1)*VA.row(FA(f,1))+b(2)*VA.row(FA(f,2));
+    }
+    target->squared_distance(P,sqrD,I,C);
+    int p;
+    if (sqrt(sqrD.maxCoeff(&p))>lower){
+        lower = sqrt(sqrD(p));
+        lower_point = P.row(p);
+    }
+    stats.closest_point_queries += P.rows();
+}
+
+void PompeiuHausdorff::release_vertex(const int v)
+{
+    free_vertices.push_back(v);
+    vertex_generation[v]++;
+}
+
+void PompeiuHausdorff::release_face(const int f)
+{
+    free_faces.push_back(f);
+    for (int c=0; c<3; c++){
+        if (--vertex_refs[FA_aug(f,c)]==0){
+            release_vertex(FA_aug(f,c));
+        }
+    }
+}
+
+size_t PompeiuHausdorff::allocated_bytes() const
+{
+    return (VA_aug.size()+C_aug.size()+DV_aug.size()+upper_aug.size())*sizeof(double)
+      + (I_aug.size()+FA_aug.size())*sizeof(int)
+      + (free_vertices.capacity()+free_faces.capacity()+vertex_refs.capacity())*sizeof(int)
+      + vertex_generation.capacity()*sizeof(uint32_t)
+      + deferred.capacity()+depth_aug.capacity()+subdivided.capacity()
+      + Q.capacity()*sizeof(RefinementQueue::value_type)
+      + midpoints.allocated_bytes();
+}
+
+void PompeiuHausdorff::count_bounds(const int success, const bool fixed_order)
+{
+    stats.bound_attempts[0]++;
+    stats.bound_successes[0] += success==0;
+    if (success==0){
+        return;
+    }
+    stats.bound_attempts[1]++;
+    stats.bound_successes[1] += success==1;
+    if (success==1){
+        return;
+    }
+    stats.bound_attempts[2]++;
+    stats.bound_successes[2] += success==2;
+    if (success==2 || success==-1 || !fixed_order){
+        return;
+    }
+    stats.bound_attempts[3]++;
+    stats.bound_successes[3] += success==3;
+    if (success==3){
+        return;
+    }
+    stats.bound_attempts[4]++;
+    stats.bound_successes[4] += success==4;
 }
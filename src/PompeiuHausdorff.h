@@ -1,5 +1,16 @@
 #include <Eigen/Core>
-#include <queue>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "refinement_queue.h"
+#include "edge_midpoint_cache.h"
+#include "cascade_order.h"
+#include "pompeiu_hausdorff_stats.h"
+#include "pompeiu_hausdorff_budget.h"
+#include "pompeiu_hausdorff_options.h"
+class PompeiuHausdorffTarget;
 class PompeiuHausdorff
 {
   public: 
@@ -8,9 +19,16 @@ class PompeiuHausdorff
     ///
     double lower;
     double upper_max;
+    /// Point of A at distance lower from B (e.g. to pass as a hint to the
+    /// next run, see PompeiuHausdorffBudget::hint_points)
+    Eigen::RowVector3d lower_point;
     double dA;
     double time_taken_bvh;
     double time_taken_bounds;
+    /// Counters and per-stage timings of the run
+    PompeiuHausdorffStats stats;
+    /// Why the last refinement ended
+    PompeiuHausdorffExit exit_reason;
     int number_of_vertices;
     int number_of_faces;
     /// Current memory allocation for vertices (top number_of_vertices rows of
@@ -24,12 +42,35 @@ class PompeiuHausdorff
     Eigen::MatrixXi FA_aug;
     /// #FA_aug list of per-triangle upper bounds
     Eigen::VectorXd upper_aug;
+    /// #FA_aug list, nonzero for queued triangles whose upper bound only went
+    /// through the cheap bounds u0-u2 so far (only with lazy)
+    std::vector<char> deferred;
+    /// #FA_aug list of the number of subdivisions that produced each face
+    std::vector<unsigned char> depth_aug;
+    /// #FA_aug list, nonzero for faces that were subdivided, so that the
+    /// others (the leaves) cover A (not kept with recycle)
+    std::vector<char> subdivided;
+    /// Order in which Kang's bound and u4 are tried when refining (re-planned
+    /// every iteration with adaptive_cascade)
+    CascadeOrder cascade_order;
+    /// Rows of VA_aug/FA_aug below number_of_vertices/number_of_faces that are
+    /// free for reuse (only with recycle)
+    std::vector<int> free_vertices;
+    std::vector<int> free_faces;
+    /// #VA_aug list of the number of queued triangles using each vertex (only
+    /// with recycle)
+    std::vector<int> vertex_refs;
+    /// #VA_aug list of the number of times each vertex row was freed
+    std::vector<uint32_t> vertex_generation;
+    /// Recently created midpoints of subdivided edges, reused when the
+    /// triangle on the other side of the edge is subdivided
+    EdgeMidpointCache midpoints;
     /// Queue of triangles with upper bound greater than global lower bound
-    std::priority_queue< std::pair< double, int > , std::vector< std::pair< double, int >  >,
-    std::less< std::pair< double, int > > > Q;
+    /// (entries that fall below lower are pruned as the queue grows)
+    RefinementQueue Q;
 
   // Should this be deleted?
-  PompeiuHausdorff(){}
+  PompeiuHausdorff(): exit_reason(PompeiuHausdorffExit::tolerance), target(nullptr), m_initialized(false) {}
   /// @brief Class to compute the Pompeiu-Hausdorff distance between two meshes A
   /// and B
   ///
@@ -40,6 +81,8 @@ class PompeiuHausdorff
   /// @param[in] tol  tolerance value for the difference between upper and lower bounds
   /// @param[in] max_factor  factor to define the maximum allowed number of faces and vertices in the subdivided mesh A with respect to the number of faces and vertices of the initial mesh A
   /// @param[in] normalize  0 (false) or 1 (true) to normalize tolerance by the length of the diagonal of A's bounding box
+  /// @param[in] options  batch size, storage recycling, BVH of B, lazy and adaptive cascade of the refinement (see PompeiuHausdorffOptions)
+  /// @param[in] budget  limits of the refinement (time, iterations, cancellation, stop function) and progress callback. The bounds are certified whenever the constructor returns; exit_reason tells whether the tolerance was reached. Reaching max_factor also ends the refinement (with exit_reason memory_limit) instead of throwing.
   PompeiuHausdorff(
     const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & VA,
     const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> & FA,
@@ -47,6 +90,186 @@ class PompeiuHausdorff
     const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> & FB,
     const double tol = 1e-8,
     const double max_factor = 1000000,
-    const bool   normalize = true);
+    const bool   normalize = true,
+    const PompeiuHausdorffOptions & options = PompeiuHausdorffOptions(),
+    const PompeiuHausdorffBudget & budget = PompeiuHausdorffBudget());
+  /// @brief Compute the Pompeiu-Hausdorff distance from a mesh A to a
+  /// prebuilt target mesh B (whose AABB tree is reused, time_taken_bvh is 0)
+  ///
+  /// @param[in] VA  #VA by 3 list of vertex positions of mesh A 
+  /// @param[in] FA  #FA by 3 list of triangle indices into VA
+  /// @param[in] target  mesh B and its AABB tree
+  ///
+  /// See above for the remaining parameters (the target chooses the BVH, so
+  /// options.wide_bvh is ignored).
+  /// The target must outlive this object if refine() is called later.
+  PompeiuHausdorff(
+    const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & VA,
+    const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> & FA,
+    const PompeiuHausdorffTarget & target,
+    const double tol = 1e-8,
+    const double max_factor = 1000000,
+    const bool   normalize = true,
+    const PompeiuHausdorffOptions & options = PompeiuHausdorffOptions(),
+    const PompeiuHausdorffBudget & budget = PompeiuHausdorffBudget());
+  /// @brief Resume a refinement from a checkpoint written by
+  /// save_checkpoint() (possibly by another process), then continue it
+  /// within the budget. Results are the same as those of the uninterrupted
+  /// run (except with adaptive_cascade, whose measurements start over).
+  /// Throws std::runtime_error if the file is not a valid checkpoint or was
+  /// written for other meshes.
+  ///
+  /// @param[in] checkpoint  path to the checkpoint file
+  /// @param[in] VA  #VA by 3 list of vertex positions of mesh A (as given to the checkpointed run)
+  /// @param[in] FA  #FA by 3 list of triangle indices into VA
+  /// @param[in] VB  #VB by 3 list of vertex positions of mesh B
+  /// @param[in] FB  #FB by 3 list of triangle indices into VB
+  /// @param[in] wide_bvh  see PompeiuHausdorffOptions::wide_bvh
+  /// @param[in] budget  see above
+  ///
+  /// The tolerance and the other options are those of the checkpointed run.
+  PompeiuHausdorff(
+    const std::string & checkpoint,
+    const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & VA,
+    const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> & FA,
+    const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & VB,
+    const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> & FB,
+    const bool   wide_bvh = false,
+    const PompeiuHausdorffBudget & budget = PompeiuHausdorffBudget());
+  /// @brief Resume a refinement from a checkpoint, querying a prebuilt
+  /// target mesh B (see above; the target must outlive this object if
+  /// refine() is called later)
+  PompeiuHausdorff(
+    const std::string & checkpoint,
+    const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & VA,
+    const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> & FA,
+    const PompeiuHausdorffTarget & target,
+    const PompeiuHausdorffBudget & budget = PompeiuHausdorffBudget());
+  /// @brief Continue the refinement towards the tolerance given to the
+  /// constructor, within a budget. Can be called repeatedly, e.g. to spend
+  /// spare time on tightening the bounds; the bounds are certified whenever
+  /// it returns. After a decision, a call without its threshold (or with a
+  /// lower one) first queues again the triangles that the decision dropped
+  /// below it; with recycle they are gone and it throws std::runtime_error.
+  ///
+  /// @param[in] budget  limits of the call (including its stop function)
+  ///   and progress callback
+  /// @return why the refinement ended (also stored in exit_reason)
+  PompeiuHausdorffExit refine(const PompeiuHausdorffBudget & budget = PompeiuHausdorffBudget());
+  /// @brief Continue the refinement towards a new tolerance, from the current
+  /// queue and subdivided mesh. A coarse-to-fine sweep of tolerances then
+  /// costs about as much as the finest one alone, and (without
+  /// adaptive_cascade) gives the same bounds as a single run at the final
+  /// tolerance.
+  ///
+  /// @param[in] tol  tolerance value for the difference between upper and lower bounds (normalized like the tolerance of the constructor); later calls to refine(budget) keep it
+  /// @param[in] budget  limits of the call and progress callback
+  /// @return why the refinement ended (also stored in exit_reason)
+  PompeiuHausdorffExit refine(const double tol, const PompeiuHausdorffBudget & budget = PompeiuHausdorffBudget());
+  /// @brief Start over for the next frame of a sequence in which B deforms
+  /// (same faces, moved vertices) and A is fixed, after the target given to
+  /// the constructor was moved with PompeiuHausdorffTarget::update_vertices.
+  /// The subdivision of A from the previous frames is kept: the closest
+  /// points of all its vertices are queried again (warm-started from the
+  /// previous closest triangles), the bounds of its leaves are recomputed,
+  /// and the refinement continues from there towards the tolerance. Frames
+  /// in which B moves little then only refine where the distance changed.
+  /// If the sampled pre-pass of a decision answered the previous frame
+  /// (before the initial pass), there is no subdivision yet and the frame
+  /// starts with the initial pass of A. Throws std::runtime_error with
+  /// recycle (which does not keep the subdivision).
+  ///
+  /// @param[in] budget  limits of the frame and progress callback (and
+  ///   threshold of a decision)
+  /// @return why the refinement ended (also stored in exit_reason)
+  PompeiuHausdorffExit next_frame(const PompeiuHausdorffBudget & budget = PompeiuHausdorffBudget());
+  /// @brief Move the vertices of B to the next frame and start over (see
+  /// above). Only for objects that built B themselves (from VB and FB); the
+  /// tree is refitted instead of rebuilt, in time_taken_bvh.
+  ///
+  /// @param[in] VB  #VB by 3 list of new vertex positions of mesh B
+  /// @param[in] budget  see above
+  /// @return why the refinement ended (also stored in exit_reason)
+  PompeiuHausdorffExit next_frame(
+    const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & VB,
+    const PompeiuHausdorffBudget & budget = PompeiuHausdorffBudget());
+  /// Current tolerance (as given to the constructor or to refine)
+  double tolerance() const { return tol; }
+  /// False if the sampled pre-pass of a decision answered above_threshold
+  /// before the initial pass: A is not subdivided, refine() throws and
+  /// next_frame() starts with the initial pass
+  bool initialized() const { return m_initialized; }
+  /// @brief Write the state of the refinement (subdivided mesh, queue,
+  /// bounds, options and stats) to a compact binary file, from which a
+  /// later process can resume it. The file is written next to path and
+  /// renamed over it, so an interrupted write keeps the previous checkpoint.
+  ///
+  /// @param[in] path  path to the checkpoint file
+  void save_checkpoint(const std::string & path) const;
   // It seems this probably isn't needed after C++17
+  private:
+  // Initial pass shared by the constructors (distances from the vertices of
+  // A and from the hints of the budget, bounds of its triangles, queue and
+  // augmented mesh). Returns false if the sampled pre-pass of a decision
+  // already answered above_threshold (nothing is initialized then: A is
+  // kept in VA_aug/FA_aug, refine() throws and next_frame() starts over).
+  bool initialize(
+    const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & VA,
+    const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> & FA,
+    const PompeiuHausdorffTarget & target,
+    const double tol,
+    const double max_factor,
+    const bool   normalize,
+    const PompeiuHausdorffOptions & options,
+    const PompeiuHausdorffBudget & budget);
+  // Raise the lower bound with the locations of A hinted by the budget
+  // (queried in bulk), with stats of the queries
+  void query_hints(
+    const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & VA,
+    const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> & FA,
+    const PompeiuHausdorffBudget & budget);
+  // Restore the state saved by save_checkpoint (the inputs must hash to the
+  // saved hashes)
+  void resume(
+    const std::string & checkpoint,
+    const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & VA,
+    const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> & FA,
+    const PompeiuHausdorffTarget & target);
+  // Refinement loop until the tolerance, the deadline (steady clock, in
+  // seconds) or a limit of the budget
+  PompeiuHausdorffExit refine_until(
+    const double deadline,
+    const PompeiuHausdorffBudget & budget);
+  // Free a vertex row (cached midpoints that use it become invalid)
+  void release_vertex(const int v);
+  // Free the row of a face that leaves the queue and of its unused vertices
+  // (only with recycle)
+  void release_face(const int f);
+  // Memory held by the refinement, in bytes
+  size_t allocated_bytes() const;
+  // Tally the cascade of a face in stats from its success_bound (the
+  // expensive bounds only if they were tried in the fixed order)
+  void count_bounds(const int success, const bool fixed_order);
+  // Mesh B and its BVH (owned by target_storage when built by the
+  // constructor, by the caller otherwise)
+  const PompeiuHausdorffTarget * target;
+  std::shared_ptr<PompeiuHausdorffTarget> target_storage;
+  // Options of the refinement (max_factor and normalize only to start over
+  // in next_frame)
+  double tol;
+  double max_factor;
+  bool normalize;
+  int max_vertices;
+  int max_faces;
+  int batch_size;
+  bool recycle;
+  bool lazy;
+  bool adaptive_cascade;
+  // False after the sampled pre-pass of a decision answered above_threshold
+  bool m_initialized;
+  // Upper bound on the triangles that left the queue above the lower bound
+  // (below the threshold of a decision), kept in upper_max
+  double upper_floor;
+  // Hash of the input mesh A, saved in checkpoints
+  uint64_t hash_A;
 };
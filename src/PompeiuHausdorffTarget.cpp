@@ -0,0 +1,328 @@
+#include "PompeiuHausdorffTarget.h"
+#include "PompeiuHausdorff.h"
+#include <igl/parallel_for.h>
+#include <igl/point_simplex_squared_distance.h>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <cstdint>
+#include <cstring>
+
+namespace
+{
+    // Layout of a target file: this header followed by the vertices (double),
+    // the faces (int) and the flattened tree, each starting at a 64-byte
+    // aligned offset.
+    struct TargetFileHeader
+    {
+        char magic[8];
+        // 0x01020304 as written by the host (detects byte order mismatches)
+        uint32_t byte_order;
+        // sizeof(FlatAABBNode) as written by the host
+        uint32_t node_size;
+        int64_t num_vertices;
+        int64_t num_faces;
+        int64_t num_nodes;
+        int64_t vertices_offset;
+        int64_t faces_offset;
+        int64_t nodes_offset;
+    };
+    const char target_file_magic[8] = {'P','H','D','T','G','T','0','1'};
+
+    int64_t align_64(const int64_t offset)
+    {
+        return (offset+63)/64*64;
+    }
+
+    // Refit the boxes of a libigl tree to moved vertices, children first
+    void refit_aabb(
+        igl::AABB<Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor>,3> & tree,
+        const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & V,
+        const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> & F)
+    {
+        tree.m_box.setEmpty();
+        if (tree.is_leaf()){
+            for (int c=0; c<3; c++){
+                tree.m_box.extend(V.row(F(tree.m_primitive,c)).transpose());
+            }
+            return;
+        }
+        if (tree.m_left){
+            refit_aabb(*tree.m_left,V,F);
+            tree.m_box.extend(tree.m_left->m_box);
+        }
+        if (tree.m_right){
+            refit_aabb(*tree.m_right,V,F);
+            tree.m_box.extend(tree.m_right->m_box);
+        }
+    }
+}
+
+PompeiuHausdorffTarget::PompeiuHausdorffTarget():
+    VB(nullptr,0,3), FB(nullptr,0,3), time_taken_bvh(0), nodes(nullptr), num_nodes(0)
+{
+}
+
+PompeiuHausdorffTarget::PompeiuHausdorffTarget(
+    const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & VB,
+    const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> & FB,
+    const bool wide_bvh):
+    VB(nullptr,0,3), FB(nullptr,0,3), VB_storage(VB), FB_storage(FB), nodes(nullptr), num_nodes(0)
+{
+    new (&this->VB) Eigen::Map<const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> >(VB_storage.data(),VB_storage.rows(),3);
+    new (&this->FB) Eigen::Map<const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> >(FB_storage.data(),FB_storage.rows(),3);
+
+    // Put mesh B into a libigl::AABB (or the wide BVH)
+    double t_start = std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    if (wide_bvh){
+        wide_treeB.init(this->VB,this->FB);
+    } else {
+        treeB.init(VB_storage,FB_storage);
+    }
+    faces_B = KangFaceData(this->VB,this->FB);
+    double t_end = std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    time_taken_bvh = 1000*(t_end - t_start);
+}
+
+PompeiuHausdorffTarget::PompeiuHausdorffTarget(const std::string & path, const bool wide_bvh):
+    VB(nullptr,0,3), FB(nullptr,0,3), nodes(nullptr), num_nodes(0)
+{
+    double t_start = std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    mapped.reset(new MappedFile(path));
+
+    // Validate the header and the extent of every array
+    TargetFileHeader header;
+    if (mapped->size()<sizeof(header)){
+        throw std::runtime_error(path + " is not a target file");
+    }
+    std::memcpy(&header,mapped->data(),sizeof(header));
+    if (std::memcmp(header.magic,target_file_magic,sizeof(header.magic))!=0){
+        throw std::runtime_error(path + " is not a target file");
+    }
+    if (header.byte_order!=0x01020304 || header.node_size!=sizeof(FlatAABBNode)){
+        throw std::runtime_error(path + " was written on an incompatible platform");
+    }
+    const int64_t size = mapped->size();
+    // every array starts after the header at a 64-byte aligned offset and
+    // ends inside the file (counts are bounded first so that the products
+    // cannot overflow)
+    const auto fits = [size](const int64_t offset, const int64_t count, const int64_t item_size)
+    {
+        return offset>=(int64_t)sizeof(TargetFileHeader) && offset%64==0 && offset<=size &&
+            count<=(size-offset)/item_size;
+    };
+    if (header.num_vertices<0 || header.num_faces<0 || header.num_nodes<0 ||
+        header.num_vertices>std::numeric_limits<int>::max() ||
+        header.num_faces>std::numeric_limits<int>::max() ||
+        header.num_nodes>std::numeric_limits<int>::max() ||
+        (header.num_nodes==0)!=(header.num_faces==0) ||
+        !fits(header.vertices_offset,header.num_vertices*3,sizeof(double)) ||
+        !fits(header.faces_offset,header.num_faces*3,sizeof(int)) ||
+        !fits(header.nodes_offset,header.num_nodes,sizeof(FlatAABBNode))){
+        throw std::runtime_error(path + " is truncated or corrupted");
+    }
+    // Queries follow the stored indices without checking them, so check
+    // them once here: children come after their parent in pre-order (which
+    // also rules out cycles), leaves name a triangle of B and triangles name
+    // vertices of B
+    const FlatAABBNode * file_nodes = reinterpret_cast<const FlatAABBNode *>(mapped->data()+header.nodes_offset);
+    for (int64_t n=0; n<header.num_nodes; n++){
+        const FlatAABBNode & node = file_nodes[n];
+        const bool valid = node.primitive<0 ?
+            node.primitive==-1 && node.right>n+1 && node.right<header.num_nodes :
+            node.primitive<header.num_faces && node.right==-1;
+        if (!valid){
+            throw std::runtime_error(path + " is truncated or corrupted");
+        }
+    }
+    const int * file_faces = reinterpret_cast<const int *>(mapped->data()+header.faces_offset);
+    for (int64_t i=0; i<header.num_faces*3; i++){
+        if (file_faces[i]<0 || file_faces[i]>=header.num_vertices){
+            throw std::runtime_error(path + " is truncated or corrupted");
+        }
+    }
+
+    // Point directly into the mapping (no copy, no rebuild)
+    new (&VB) Eigen::Map<const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> >(
+        reinterpret_cast<const double *>(mapped->data()+header.vertices_offset),header.num_vertices,3);
+    new (&FB) Eigen::Map<const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> >(
+        reinterpret_cast<const int *>(mapped->data()+header.faces_offset),header.num_faces,3);
+    nodes = reinterpret_cast<const FlatAABBNode *>(mapped->data()+header.nodes_offset);
+    num_nodes = header.num_nodes;
+    if (wide_bvh){
+        wide_treeB.init(VB,FB);
+    }
+    faces_B = KangFaceData(VB,FB);
+
+    double t_end = std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    time_taken_bvh = 1000*(t_end - t_start);
+}
+
+void PompeiuHausdorffTarget::save(const std::string & path) const
+{
+    // Flatten the libigl tree (or reuse the mapped one). The file format
+    // stores a binary tree, so a target using the wide BVH builds one.
+    std::vector<FlatAABBNode> flattened;
+    const FlatAABBNode * save_nodes = nodes;
+    int64_t save_num_nodes = num_nodes;
+    if (!mapped && !wide_treeB.empty()){
+        igl::AABB<Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor>,3> tree;
+        tree.init(VB_storage,FB_storage);
+        flatten_aabb(tree,flattened);
+        save_nodes = flattened.data();
+        save_num_nodes = flattened.size();
+    } else if (!mapped){
+        flatten_aabb(treeB,flattened);
+        save_nodes = flattened.data();
+        save_num_nodes = flattened.size();
+    }
+
+    TargetFileHeader header;
+    std::memcpy(header.magic,target_file_magic,sizeof(header.magic));
+    header.byte_order = 0x01020304;
+    header.node_size = sizeof(FlatAABBNode);
+    header.num_vertices = VB.rows();
+    header.num_faces = FB.rows();
+    header.num_nodes = save_num_nodes;
+    header.vertices_offset = align_64(sizeof(header));
+    header.faces_offset = align_64(header.vertices_offset+header.num_vertices*3*sizeof(double));
+    header.nodes_offset = align_64(header.faces_offset+header.num_faces*3*sizeof(int));
+
+    std::ofstream out(path.c_str(),std::ios::binary);
+    if (!out){
+        throw std::runtime_error("Could not open " + path + " for writing");
+    }
+    const char padding[64] = {0};
+    const auto write_at = [&](const int64_t offset, const void * data, const int64_t bytes)
+    {
+        out.write(padding,offset-out.tellp());
+        out.write(static_cast<const char *>(data),bytes);
+    };
+    out.write(reinterpret_cast<const char *>(&header),sizeof(header));
+    write_at(header.vertices_offset,VB.data(),header.num_vertices*3*sizeof(double));
+    write_at(header.faces_offset,FB.data(),header.num_faces*3*sizeof(int));
+    write_at(header.nodes_offset,save_nodes,save_num_nodes*sizeof(FlatAABBNode));
+    if (!out){
+        throw std::runtime_error("Could not write " + path);
+    }
+}
+
+void PompeiuHausdorffTarget::update_vertices(
+    const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & VB)
+{
+    if (mapped){
+        throw std::runtime_error("Cannot move the vertices of a target opened from a file");
+    }
+    if (VB.rows()!=VB_storage.rows()){
+        throw std::runtime_error("Cannot change the number of vertices of a target");
+    }
+    double t_start = std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    // same size, so this->VB still points into the storage
+    VB_storage = VB;
+    if (!wide_treeB.empty()){
+        wide_treeB.refit(this->VB,this->FB);
+    } else if (FB_storage.rows()>0){
+        refit_aabb(treeB,VB_storage,FB_storage);
+    }
+    faces_B.update_vertices(this->VB);
+    double t_end = std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    time_taken_bvh = 1000*(t_end - t_start);
+}
+
+void PompeiuHausdorffTarget::squared_distance(
+    const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & P,
+    Eigen::VectorXd & sqrD,
+    Eigen::VectorXi & I,
+    Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & C) const
+{
+    // number of consecutive points queried by one thread (the first point of
+    // a block is not warm-started)
+    const int block_size = 64;
+    sqrD.resize(P.rows());
+    I.resize(P.rows());
+    C.resize(P.rows(),3);
+    const int number_of_blocks = (P.rows()+block_size-1)/block_size;
+    igl::parallel_for(number_of_blocks,[&](const int block)
+    {
+        const int first = block*block_size;
+        const int last = std::min<int>(first+block_size,P.rows());
+        for (int p=first; p<last; p++){
+            const Eigen::RowVector3d q = P.row(p);
+            int i = -1;
+            Eigen::RowVector3d c;
+            if (p>first && I(p-1)>=0){
+                i = I(p-1);
+                sqrD(p) = squared_distance(q,squared_distance_to_face(q,i,c),i,c);
+            } else {
+                sqrD(p) = squared_distance(q,i,c);
+            }
+            I(p) = i;
+            C.row(p) = c;
+        }
+    },10000/block_size);
+}
+
+double PompeiuHausdorffTarget::squared_distance(
+    const Eigen::RowVector3d & p,
+    int & i,
+    Eigen::RowVector3d & c) const
+{
+    return squared_distance(p,std::numeric_limits<double>::infinity(),i,c);
+}
+
+double PompeiuHausdorffTarget::squared_distance(
+    const Eigen::RowVector3d & p,
+    const double up_sqr_d,
+    int & i,
+    Eigen::RowVector3d & c) const
+{
+    if (!wide_treeB.empty()){
+        return wide_treeB.squared_distance(p,up_sqr_d,i,c);
+    }
+    if (!mapped){
+        return treeB.squared_distance(VB_storage,FB_storage,p,up_sqr_d,i,c);
+    }
+    return flat_aabb_squared_distance(nodes,num_nodes,VB,FB,p,up_sqr_d,i,c);
+}
+
+double PompeiuHausdorffTarget::squared_distance_to_face(
+    const Eigen::RowVector3d & p,
+    const int f,
+    Eigen::RowVector3d & c) const
+{
+    double sqr_d;
+    igl::point_simplex_squared_distance<3>(p,VB,FB,f,sqr_d,c);
+    return sqr_d;
+}
+
+std::tuple<
+    double /* lower */,
+    double /* upper */,
+    double /* dA */,
+    double /* time_taken_bvh */,
+    double /* time_taken_bounds */>
+PompeiuHausdorffTarget::distance_from(
+    const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & VA,
+    const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> & FA,
+    const double tol,
+    const double max_factor,
+    const bool normalize,
+    const PompeiuHausdorffOptions & options,
+    PompeiuHausdorffStats * stats) const
+{
+    PompeiuHausdorff ph(VA, FA, *this, tol, max_factor, normalize, options);
+    if (ph.exit_reason==PompeiuHausdorffExit::memory_limit){
+        throw std::runtime_error("Exceeded maximum number of faces or vertices");
+    }
+    if (stats){
+        *stats = ph.stats;
+    }
+    return std::make_tuple(
+        ph.lower,
+        ph.upper_max,
+        ph.dA,
+        ph.time_taken_bvh,
+        ph.time_taken_bounds);
+}
@@ -0,0 +1,155 @@
+#include <Eigen/Core>
+#include <igl/AABB.h>
+#include <tuple>
+#include <string>
+#include <vector>
+#include <memory>
+#include "flat_aabb.h"
+#include "wide_bvh.h"
+#include "kang_face_data.h"
+#include "mapped_file.h"
+#include "pompeiu_hausdorff_stats.h"
+#include "pompeiu_hausdorff_options.h"
+/// Target mesh B of one-sided Pompeiu-Hausdorff distance computations h(A,B).
+/// Owns B's vertices, faces and AABB tree so that they are built once and
+/// reused for many meshes A. All queries are const, so a single target can be
+/// shared by several threads computing distances at the same time.
+///
+/// A target can be saved to a compact binary file (vertices, faces and the
+/// flattened AABB tree) and reopened by memory mapping it, in which case
+/// nothing is rebuilt or copied and queries run directly on the mapped data.
+class PompeiuHausdorffTarget
+{
+  public:
+    /// #VB by 3 list of vertex positions of mesh B (view into owned or mapped
+    /// memory)
+    Eigen::Map<const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> > VB;
+    /// #FB by 3 list of triangle indices into VB (view into owned or mapped
+    /// memory)
+    Eigen::Map<const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> > FB;
+    /// AABB tree of mesh B (empty if the target was loaded from a file or
+    /// uses the wide BVH)
+    igl::AABB<Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor>,3> treeB;
+    /// 4-wide SAH BVH of mesh B with vectorized point-triangle distances
+    /// (empty unless requested); used instead of the other trees when built
+    WideBVH wide_treeB;
+    /// Planes and adjacency of the faces of B used by Kang's bound
+    KangFaceData faces_B;
+    /// Time taken to build treeB and faces_B, to open the file or to refit
+    /// them in update_vertices (ms)
+    double time_taken_bvh;
+
+  PompeiuHausdorffTarget();
+  /// @param[in] VB  #VB by 3 list of vertex positions of mesh B
+  /// @param[in] FB  #FB by 3 list of triangle indices into VB
+  /// @param[in] wide_bvh  build the wide BVH instead of libigl's AABB tree
+  PompeiuHausdorffTarget(
+    const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & VB,
+    const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> & FB,
+    const bool wide_bvh = false);
+  /// Open a target written by save() (throws std::runtime_error if the file
+  /// is not a valid target file)
+  ///
+  /// @param[in] path  path to the target file
+  /// @param[in] wide_bvh  build the wide BVH over the mapped mesh instead of
+  ///   querying the stored tree
+  PompeiuHausdorffTarget(const std::string & path, const bool wide_bvh = false);
+  // VB and FB may point into this object's own storage
+  PompeiuHausdorffTarget(const PompeiuHausdorffTarget &) = delete;
+  PompeiuHausdorffTarget & operator=(const PompeiuHausdorffTarget &) = delete;
+
+  /// Write vertices, faces and the flattened AABB tree of B to a file that
+  /// can be opened with PompeiuHausdorffTarget(path)
+  ///
+  /// @param[in] path  path to the target file
+  void save(const std::string & path) const;
+
+  /// Move the vertices of B (same faces), e.g. to the next frame of an
+  /// animation. The tree is refitted in time linear in the size of B
+  /// instead of being rebuilt, and keeps the structure built for the first
+  /// positions. Throws std::runtime_error if the target was opened from a
+  /// file or the number of vertices differs. Must not be called while other
+  /// threads query the target.
+  ///
+  /// @param[in] VB  #VB by 3 list of new vertex positions of mesh B
+  void update_vertices(
+    const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & VB);
+
+  /// Closest points on B. Consecutive points are usually close to each
+  /// other, so each query is warm-started from the closest triangle of the
+  /// previous point (in blocks of consecutive points run in parallel).
+  ///
+  /// @param[in] P  #P by 3 list of query points
+  /// @param[out] sqrD  #P list of squared distances to B
+  /// @param[out] I  #P list of indices into FB of the closest triangles
+  /// @param[out] C  #P by 3 list of closest points
+  void squared_distance(
+    const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & P,
+    Eigen::VectorXd & sqrD,
+    Eigen::VectorXi & I,
+    Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & C) const;
+  /// Closest point on B to a single point (does not allocate)
+  ///
+  /// @param[in] p  query point
+  /// @param[out] i  index into FB of the closest triangle
+  /// @param[out] c  closest point
+  /// @return squared distance to B
+  double squared_distance(
+    const Eigen::RowVector3d & p,
+    int & i,
+    Eigen::RowVector3d & c) const;
+  /// Closest point on B to a single point, only looking for points closer
+  /// than a known bound (e.g. the distance to a triangle close to a nearby
+  /// point), so that most of the tree is pruned
+  ///
+  /// @param[in] p  query point
+  /// @param[in] up_sqr_d  upper bound on the squared distance to B
+  /// @param[in,out] i  index into FB of the closest triangle (unchanged if
+  ///   no point of B is closer than up_sqr_d)
+  /// @param[in,out] c  closest point (unchanged if no point of B is closer
+  ///   than up_sqr_d)
+  /// @return squared distance to B (up_sqr_d if no point is closer)
+  double squared_distance(
+    const Eigen::RowVector3d & p,
+    const double up_sqr_d,
+    int & i,
+    Eigen::RowVector3d & c) const;
+  /// Closest point on one triangle of B
+  ///
+  /// @param[in] p  query point
+  /// @param[in] f  index into FB of the triangle
+  /// @param[out] c  closest point on the triangle
+  /// @return squared distance to the triangle
+  double squared_distance_to_face(
+    const Eigen::RowVector3d & p,
+    const int f,
+    Eigen::RowVector3d & c) const;
+
+  /// Compute lower and upper bounds on the Pompeiu-Hausdorff distance from a
+  /// mesh A to this target (see pompeiu_hausdorff for the parameters;
+  /// options.wide_bvh is ignored since the target chooses its BVH). The
+  /// returned time_taken_bvh is 0 since the tree is reused.
+  std::tuple<
+    double /* lower */,
+    double /* upper */,
+    double /* dA */,
+    double /* time_taken_bvh */,
+    double /* time_taken_bounds */>
+  distance_from(
+    const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & VA,
+    const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> & FA,
+    const double tol = 1e-8,
+    const double max_factor = 1000000,
+    const bool normalize = true,
+    const PompeiuHausdorffOptions & options = PompeiuHausdorffOptions(),
+    PompeiuHausdorffStats * stats = nullptr) const;
+
+  private:
+    // Storage behind VB and FB when the target was built from matrices
+    Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> VB_storage;
+    Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> FB_storage;
+    // Mapped target file and flattened tree inside it (null otherwise)
+    std::unique_ptr<MappedFile> mapped;
+    const FlatAABBNode * nodes;
+    int num_nodes;
+};
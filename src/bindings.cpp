@@ -1,41 +1,318 @@
 #include "PompeiuHausdorff.h"
+#include "PompeiuHausdorffTarget.h"
 #include "pompeiu_hausdorff.h"
+#include "symmetric_pompeiu_hausdorff.h"
+#include "streaming_pompeiu_hausdorff.h"
+#include "sharded_pompeiu_hausdorff.h"
+#include "read_triangle_mesh_fast.h"
 #include <nanobind/nanobind.h>
 #include <nanobind/eigen/dense.h>
 #include <nanobind/stl/tuple.h>
 #include <nanobind/stl/pair.h>
+#include <nanobind/stl/string.h>
+#include <nanobind/stl/vector.h>
+#include <nanobind/stl/optional.h>
+#include <atomic>
+#include <limits>
+#include <stdexcept>
 
 
 namespace nb = nanobind;
 using namespace nb::literals;
 
+namespace
+{
+  // Counters and per-stage timings of a run as a dict
+  nb::dict stats_to_dict(const PompeiuHausdorffStats & stats)
+  {
+    const char * const names[5] = {"u0","u1","u2","kang","u4"};
+    nb::dict attempts, successes;
+    for(int b = 0;b<5;b++)
+    {
+      attempts[names[b]] = stats.bound_attempts[b];
+      successes[names[b]] = stats.bound_successes[b];
+    }
+    nb::dict d;
+    d["iterations"] = stats.iterations;
+    d["closest_point_queries"] = stats.closest_point_queries;
+    d["bound_attempts"] = attempts;
+    d["bound_successes"] = successes;
+    d["time_bvh"] = stats.time_bvh;
+    d["time_queries"] = stats.time_queries;
+    d["time_bounds"] = stats.time_bounds;
+    d["time_queue"] = stats.time_queue;
+    d["time_allocation"] = stats.time_allocation;
+    d["max_depth"] = stats.max_depth;
+    d["peak_queue_size"] = stats.peak_queue_size;
+    d["peak_allocated_bytes"] = stats.peak_allocated_bytes;
+    return d;
+  }
+
+  // Flag set from Python to cancel a refinement running in another thread
+  struct CancelFlag
+  {
+    std::atomic<bool> flag;
+    CancelFlag(): flag(false) {}
+  };
+
+  // Options of a refinement from the keyword arguments of the bindings
+  PompeiuHausdorffOptions make_options(
+    const int batch_size,
+    const bool recycle,
+    const bool wide_bvh,
+    const bool lazy,
+    const bool adaptive_cascade)
+  {
+    PompeiuHausdorffOptions options;
+    options.batch_size = batch_size;
+    options.recycle = recycle;
+    options.wide_bvh = wide_bvh;
+    options.lazy = lazy;
+    options.adaptive_cascade = adaptive_cascade;
+    return options;
+  }
+
+  // Budget of a refinement from the keyword arguments of the bindings. The
+  // progress callback takes the GIL, which the refinement releases; the
+  // budget must be destroyed with the GIL held.
+  PompeiuHausdorffBudget make_budget(
+    const double time_limit,
+    const long max_iterations,
+    const nb::object & progress,
+    const double progress_interval,
+    const CancelFlag * cancel,
+    const std::string & checkpoint,
+    const double checkpoint_interval,
+    const std::optional<double> & threshold)
+  {
+    PompeiuHausdorffBudget budget;
+    budget.time_limit = time_limit;
+    budget.max_iterations = max_iterations;
+    if(!progress.is_none())
+    {
+      budget.progress = [progress](const double lower, const double upper_max)
+      {
+        nb::gil_scoped_acquire acquire;
+        progress(lower,upper_max);
+      };
+    }
+    budget.progress_interval = progress_interval;
+    budget.cancel = cancel ? &cancel->flag : nullptr;
+    budget.checkpoint = checkpoint;
+    budget.checkpoint_interval = checkpoint_interval;
+    if(threshold)
+    {
+      budget.threshold = *threshold;
+    }
+    return budget;
+  }
+
+  // Hinted locations of A (see PompeiuHausdorffBudget::hint_points) from the
+  // keyword arguments of the bindings
+  void set_hints(
+    PompeiuHausdorffBudget & budget,
+    const std::optional<Eigen::Matrix<double, Eigen::Dynamic, 3, Eigen::RowMajor> > & hint_points,
+    const std::optional<Eigen::VectorXi> & hint_faces,
+    const std::optional<Eigen::Matrix<double, Eigen::Dynamic, 3, Eigen::RowMajor> > & hint_barycentric)
+  {
+    if(hint_points)
+    {
+      budget.hint_points = *hint_points;
+    }
+    if(hint_faces)
+    {
+      budget.hint_faces = *hint_faces;
+    }
+    if(hint_barycentric)
+    {
+      budget.hint_barycentric = *hint_barycentric;
+    }
+  }
+
+  const double inf = std::numeric_limits<double>::infinity();
+}
+
 NB_MODULE(cascading_upper_bounds_ext, m) {
-  typedef 
-    std::priority_queue< std::pair< double, int > , std::vector< std::pair< double, int >  >,
-    std::less< std::pair< double, int > > >
-      PQ;
+  typedef RefinementQueue PQ;
     nb::class_<PQ >(m, "PriorityQueue")
       .def(nb::init<>())
       .def("pop",  &PQ::pop)
       .def("top",  &PQ::top)
       .def("empty",&PQ::empty)
       .def("size", &PQ::size)
+      .def("capacity", &PQ::capacity)
+      .def("prune", [](PQ & q, const double lower){ return q.prune(lower); }, "lower"_a,
+           "Remove entries with upper bound below lower; returns how many were removed")
           ;
 
-  nb::class_<PompeiuHausdorff>(m, "PompeiuHausdorff")
-      .def(nb::init<>())
+  nb::class_<PompeiuHausdorffTarget>(m, "PompeiuHausdorffTarget")
       .def(nb::init<
           const Eigen::Matrix<double, Eigen::Dynamic, 3, Eigen::RowMajor>&,
           const Eigen::Matrix<int, Eigen::Dynamic, 3, Eigen::RowMajor>&,
-          const Eigen::Matrix<double, Eigen::Dynamic, 3, Eigen::RowMajor>&,
-          const Eigen::Matrix<int, Eigen::Dynamic, 3, Eigen::RowMajor>&,
-          double, double, bool>(),
-           "VA"_a, "FA"_a, "VB"_a, "FB"_a, "tol"_a=1e-8, "max_factor"_a=1000000, "normalize"_a=true)
+          bool>(),
+           "VB"_a, "FB"_a, "wide_bvh"_a=false,
+           nb::call_guard<nb::gil_scoped_release>())
+      .def(nb::init<const std::string &, bool>(), "path"_a, "wide_bvh"_a=false,
+           "Open a target file written by save() by memory mapping it (no BVH rebuild, no copy unless wide_bvh builds the wide BVH)")
+      .def("save", &PompeiuHausdorffTarget::save, "path"_a,
+           "Write vertices, faces and the flattened BVH of mesh B to a target file")
+      .def_prop_ro("VB", [](const PompeiuHausdorffTarget & t)
+           { return Eigen::Matrix<double, Eigen::Dynamic, 3, Eigen::RowMajor>(t.VB); },
+           "#VB by 3 list of vertex positions of mesh B")
+      .def_prop_ro("FB", [](const PompeiuHausdorffTarget & t)
+           { return Eigen::Matrix<int, Eigen::Dynamic, 3, Eigen::RowMajor>(t.FB); },
+           "#FB by 3 list of triangle indices into VB")
+      .def("update_vertices", &PompeiuHausdorffTarget::update_vertices, "VB"_a,
+           nb::call_guard<nb::gil_scoped_release>(),
+           "Move the vertices of mesh B (same faces), refitting the BVH in linear time instead of rebuilding it (not for targets opened from a file, nor while another thread queries the target)")
+      .def_ro("time_taken_bvh", &PompeiuHausdorffTarget::time_taken_bvh,"Time taken to build the BVH for mesh B (or to open the target file, or to refit it in update_vertices)")
+      // Releasing the GIL lets several Python threads query the same target
+      .def("distance_from", [](const PompeiuHausdorffTarget & t, const Eigen::Matrix<double, Eigen::Dynamic, 3, Eigen::RowMajor> & VA, const Eigen::Matrix<int, Eigen::Dynamic, 3, Eigen::RowMajor> & FA, double tol, double max_factor, bool normalize, int batch_size, bool recycle, bool lazy, bool adaptive_cascade)
+           { return t.distance_from(VA, FA, tol, max_factor, normalize, make_options(batch_size, recycle, false, lazy, adaptive_cascade)); },
+           "VA"_a, "FA"_a, "tol"_a=1e-8, "max_factor"_a=1000000, "normalize"_a=false, "batch_size"_a=1, "recycle"_a=false, "lazy"_a=false, "adaptive_cascade"_a=false,
+           nb::call_guard<nb::gil_scoped_release>(),
+           R"(Compute lower and upper bounds on the Pompeiu-Hausdorff distance from a
+mesh A to this target, reusing its BVH (time_taken_bvh is 0)
+
+@param[in] VA  #VA by 3 list of vertex positions of mesh A 
+@param[in] FA  #FA by 3 list of triangle indices into VA
+@param[in] tol  tolerance value for the difference between upper and lower bounds
+@param[in] max_factor  factor to define the maximum allowed number of faces and vertices in the subdivided mesh A with respect to the number of faces and vertices of the initial mesh A
+@param[in] normalize  0 (false) or 1 (true) to normalize tolerance by the length of the diagonal of A's bounding box
+@param[in] batch_size  number of triangles refined in parallel per iteration (1 is sequential)
+@param[in] recycle  reuse the storage of triangles that left the queue so that memory is bounded by the queue instead of the refinement history (same bounds)
+@param[in] lazy  queue new triangles with the cheap bounds only and evaluate Kang's bound and u4 once a triangle reaches the top of the queue (certified bounds, different refinement order)
+@param[in] adaptive_cascade  try the cheaper of Kang's bound and u4 per rejected triangle first (measured while refining) and skip the other while it rejects almost nothing on its own (certified bounds, not reproducible)
+)")
+      ;
+
+  nb::class_<CancelFlag>(m, "CancelFlag",
+      "Flag to cancel a refinement (PompeiuHausdorff or its refine method) running in another thread")
+      .def(nb::init<>())
+      .def("set", [](CancelFlag & c){ c.flag.store(true); }, "Ask the refinement to stop after its current iteration")
+      .def("clear", [](CancelFlag & c){ c.flag.store(false); })
+      .def("is_set", [](const CancelFlag & c){ return c.flag.load(); })
+      ;
+
+  // The refinement releases the GIL: other Python threads keep running and
+  // can cancel it through a CancelFlag
+  nb::class_<PompeiuHausdorff>(m, "PompeiuHausdorff")
+      .def(nb::init<>())
+      .def("__init__", [](PompeiuHausdorff * ph, const Eigen::Matrix<double, Eigen::Dynamic, 3, Eigen::RowMajor> & VA, const Eigen::Matrix<int, Eigen::Dynamic, 3, Eigen::RowMajor> & FA, const Eigen::Matrix<double, Eigen::Dynamic, 3, Eigen::RowMajor> & VB, const Eigen::Matrix<int, Eigen::Dynamic, 3, Eigen::RowMajor> & FB, double tol, double max_factor, bool normalize, int batch_size, bool recycle, bool wide_bvh, bool lazy, bool adaptive_cascade, double time_limit, long max_iterations, nb::object progress, double progress_interval, const CancelFlag * cancel, const std::string & checkpoint, double checkpoint_interval, std::optional<double> threshold, std::optional<Eigen::Matrix<double, Eigen::Dynamic, 3, Eigen::RowMajor> > hint_points, std::optional<Eigen::VectorXi> hint_faces, std::optional<Eigen::Matrix<double, Eigen::Dynamic, 3, Eigen::RowMajor> > hint_barycentric)
+           {
+             PompeiuHausdorffBudget budget = make_budget(time_limit, max_iterations, progress, progress_interval, cancel, checkpoint, checkpoint_interval, threshold);
+             set_hints(budget, hint_points, hint_faces, hint_barycentric);
+             nb::gil_scoped_release release;
+             new (ph) PompeiuHausdorff(VA, FA, VB, FB, tol, max_factor, normalize, make_options(batch_size, recycle, wide_bvh, lazy, adaptive_cascade), budget);
+           },
+           "VA"_a, "FA"_a, "VB"_a, "FB"_a, "tol"_a=1e-8, "max_factor"_a=1000000, "normalize"_a=true, "batch_size"_a=1, "recycle"_a=false, "wide_bvh"_a=false, "lazy"_a=false, "adaptive_cascade"_a=false,
+           "time_limit"_a=inf, "max_iterations"_a=-1, "progress"_a=nb::none(), "progress_interval"_a=100, "cancel"_a.none()=nb::none(), "checkpoint"_a="", "checkpoint_interval"_a=60000, "threshold"_a.none()=nb::none(), "hint_points"_a.none()=nb::none(), "hint_faces"_a.none()=nb::none(), "hint_barycentric"_a.none()=nb::none())
+      .def("__init__", [](PompeiuHausdorff * ph, const Eigen::Matrix<double, Eigen::Dynamic, 3, Eigen::RowMajor> & VA, const Eigen::Matrix<int, Eigen::Dynamic, 3, Eigen::RowMajor> & FA, const PompeiuHausdorffTarget & target, double tol, double max_factor, bool normalize, int batch_size, bool recycle, bool lazy, bool adaptive_cascade, double time_limit, long max_iterations, nb::object progress, double progress_interval, const CancelFlag * cancel, const std::string & checkpoint, double checkpoint_interval, std::optional<double> threshold, std::optional<Eigen::Matrix<double, Eigen::Dynamic, 3, Eigen::RowMajor> > hint_points, std::optional<Eigen::VectorXi> hint_faces, std::optional<Eigen::Matrix<double, Eigen::Dynamic, 3, Eigen::RowMajor> > hint_barycentric)
+           {
+             PompeiuHausdorffBudget budget = make_budget(time_limit, max_iterations, progress, progress_interval, cancel, checkpoint, checkpoint_interval, threshold);
+             set_hints(budget, hint_points, hint_faces, hint_barycentric);
+             nb::gil_scoped_release release;
+             new (ph) PompeiuHausdorff(VA, FA, target, tol, max_factor, normalize, make_options(batch_size, recycle, false, lazy, adaptive_cascade), budget);
+           },
+           "VA"_a, "FA"_a, "target"_a, "tol"_a=1e-8, "max_factor"_a=1000000, "normalize"_a=true, "batch_size"_a=1, "recycle"_a=false, "lazy"_a=false, "adaptive_cascade"_a=false,
+           "time_limit"_a=inf, "max_iterations"_a=-1, "progress"_a=nb::none(), "progress_interval"_a=100, "cancel"_a.none()=nb::none(), "checkpoint"_a="", "checkpoint_interval"_a=60000, "threshold"_a.none()=nb::none(), "hint_points"_a.none()=nb::none(), "hint_faces"_a.none()=nb::none(), "hint_barycentric"_a.none()=nb::none(),
+           // refine() keeps querying the target
+           nb::keep_alive<1, 4>())
+      .def("__init__", [](PompeiuHausdorff * ph, const std::string & resume, const Eigen::Matrix<double, Eigen::Dynamic, 3, Eigen::RowMajor> & VA, const Eigen::Matrix<int, Eigen::Dynamic, 3, Eigen::RowMajor> & FA, const Eigen::Matrix<double, Eigen::Dynamic, 3, Eigen::RowMajor> & VB, const Eigen::Matrix<int, Eigen::Dynamic, 3, Eigen::RowMajor> & FB, bool wide_bvh, double time_limit, long max_iterations, nb::object progress, double progress_interval, const CancelFlag * cancel, const std::string & checkpoint, double checkpoint_interval, std::optional<double> threshold)
+           {
+             const PompeiuHausdorffBudget budget = make_budget(time_limit, max_iterations, progress, progress_interval, cancel, checkpoint, checkpoint_interval, threshold);
+             nb::gil_scoped_release release;
+             new (ph) PompeiuHausdorff(resume, VA, FA, VB, FB, wide_bvh, budget);
+           },
+           "resume"_a, "VA"_a, "FA"_a, "VB"_a, "FB"_a, "wide_bvh"_a=false,
+           "time_limit"_a=inf, "max_iterations"_a=-1, "progress"_a=nb::none(), "progress_interval"_a=100, "cancel"_a.none()=nb::none(), "checkpoint"_a="", "checkpoint_interval"_a=60000, "threshold"_a.none()=nb::none(),
+           R"(Resume a refinement from a checkpoint file (see save_checkpoint), given the
+same meshes, and continue it within the budget. The tolerance and options
+are those of the checkpointed run, and the bounds are the same as those of
+the uninterrupted run. Raises RuntimeError if the file is not a valid
+checkpoint or was written for other meshes.)")
+      .def("__init__", [](PompeiuHausdorff * ph, const std::string & resume, const Eigen::Matrix<double, Eigen::Dynamic, 3, Eigen::RowMajor> & VA, const Eigen::Matrix<int, Eigen::Dynamic, 3, Eigen::RowMajor> & FA, const PompeiuHausdorffTarget & target, double time_limit, long max_iterations, nb::object progress, double progress_interval, const CancelFlag * cancel, const std::string & checkpoint, double checkpoint_interval, std::optional<double> threshold)
+           {
+             const PompeiuHausdorffBudget budget = make_budget(time_limit, max_iterations, progress, progress_interval, cancel, checkpoint, checkpoint_interval, threshold);
+             nb::gil_scoped_release release;
+             new (ph) PompeiuHausdorff(resume, VA, FA, target, budget);
+           },
+           "resume"_a, "VA"_a, "FA"_a, "target"_a,
+           "time_limit"_a=inf, "max_iterations"_a=-1, "progress"_a=nb::none(), "progress_interval"_a=100, "cancel"_a.none()=nb::none(), "checkpoint"_a="", "checkpoint_interval"_a=60000, "threshold"_a.none()=nb::none(),
+           nb::keep_alive<1, 5>())
+      .def("refine", [](PompeiuHausdorff & ph, std::optional<double> tol, double time_limit, long max_iterations, nb::object progress, double progress_interval, const CancelFlag * cancel, const std::string & checkpoint, double checkpoint_interval, std::optional<double> threshold)
+           {
+             const PompeiuHausdorffBudget budget = make_budget(time_limit, max_iterations, progress, progress_interval, cancel, checkpoint, checkpoint_interval, threshold);
+             nb::gil_scoped_release release;
+             return std::string(pompeiu_hausdorff_exit_name(tol ? ph.refine(*tol, budget) : ph.refine(budget)));
+           },
+           "tol"_a.none()=nb::none(), "time_limit"_a=inf, "max_iterations"_a=-1, "progress"_a=nb::none(), "progress_interval"_a=100, "cancel"_a.none()=nb::none(), "checkpoint"_a="", "checkpoint_interval"_a=60000, "threshold"_a.none()=nb::none(),
+           R"(Continue the refinement towards the tolerance given to the constructor,
+or towards a new one, within a budget; can be called repeatedly. The
+refinement resumes from the current queue and subdivided mesh, so a
+coarse-to-fine sweep of tolerances costs about as much as the finest one
+alone. The bounds are certified whenever it returns. The constructors take
+the same keyword arguments except tol (with an iteration limit of 0 they
+only run the initial pass).
+
+@param[in] tol  new tolerance (normalized like the tolerance of the constructor), None to keep the current one
+@param[in] time_limit  wall-clock time allowed, in milliseconds (checked between iterations)
+@param[in] max_iterations  maximum number of iterations (-1 for no limit)
+@param[in] progress  optional function called with (lower, upper_max) at the start, every progress_interval milliseconds and at the end
+@param[in] progress_interval  minimum time between two calls to progress, in milliseconds
+@param[in] cancel  optional CancelFlag, set from another thread to stop the refinement
+@param[in] checkpoint  optional path of a checkpoint written every checkpoint_interval milliseconds and when the refinement ends, from which a killed run can be resumed
+@param[in] checkpoint_interval  minimum time between two checkpoints, in milliseconds
+@param[in] threshold  optional threshold of a pass/fail decision: the refinement stops as soon as the bounds tell whether h(A,B) <= threshold, and drops the triangles that cannot change the answer (upper_max then stays at or above the threshold). The constructors first query a sample of points of A and stop at once if one is farther than the threshold.
+@return why the refinement ended: "tolerance", "queue_empty", "time_limit", "iteration_limit", "cancelled", "memory_limit", "below_threshold" or "above_threshold"
+
+The constructors (except when resuming) and next_frame also take hints of
+where the distance is likely to be the largest, queried before the initial
+bounds so that the lower bound rejects more triangles at once:
+hint_points (#P by 3 points, moved to the closest point of A), and
+hint_faces with hint_barycentric (#H faces of A and #H by 3 barycentric
+coordinates). lower_point of a previous run on a similar mesh or frame is
+a good hint.
+)")
+      .def("next_frame", [](PompeiuHausdorff & ph, std::optional<Eigen::Matrix<double, Eigen::Dynamic, 3, Eigen::RowMajor> > VB, double time_limit, long max_iterations, nb::object progress, double progress_interval, const CancelFlag * cancel, const std::string & checkpoint, double checkpoint_interval, std::optional<double> threshold, std::optional<Eigen::Matrix<double, Eigen::Dynamic, 3, Eigen::RowMajor> > hint_points, std::optional<Eigen::VectorXi> hint_faces, std::optional<Eigen::Matrix<double, Eigen::Dynamic, 3, Eigen::RowMajor> > hint_barycentric)
+           {
+             PompeiuHausdorffBudget budget = make_budget(time_limit, max_iterations, progress, progress_interval, cancel, checkpoint, checkpoint_interval, threshold);
+             set_hints(budget, hint_points, hint_faces, hint_barycentric);
+             nb::gil_scoped_release release;
+             return std::string(pompeiu_hausdorff_exit_name(VB ? ph.next_frame(*VB, budget) : ph.next_frame(budget)));
+           },
+           "VB"_a.none()=nb::none(), "time_limit"_a=inf, "max_iterations"_a=-1, "progress"_a=nb::none(), "progress_interval"_a=100, "cancel"_a.none()=nb::none(), "checkpoint"_a="", "checkpoint_interval"_a=60000, "threshold"_a.none()=nb::none(), "hint_points"_a.none()=nb::none(), "hint_faces"_a.none()=nb::none(), "hint_barycentric"_a.none()=nb::none(),
+           R"(Start over for the next frame of a sequence in which mesh B deforms (same
+faces, moved vertices) and A is fixed. The subdivision of A from the
+previous frames is kept: its vertices are queried again, the bounds of its
+triangles recomputed, and the refinement continues towards the tolerance
+(see refine for the keyword arguments). If the previous frame was a
+decision answered before the initial pass, this frame starts with it. Not
+available with recycle.
+
+@param[in] VB  new vertex positions of mesh B, which the object built itself (its BVH is refitted); None if the target given to the constructor was moved with its update_vertices method
+@param[in] hint_points, hint_faces, hint_barycentric  optional locations of A where the distance is likely to be the largest (as for the constructors)
+@return why the refinement ended (see refine)
+)")
+      .def("save_checkpoint", [](const PompeiuHausdorff & ph, const std::string & path)
+           {
+             nb::gil_scoped_release release;
+             ph.save_checkpoint(path);
+           },
+           "path"_a,
+           "Write the state of the refinement to a checkpoint file, from which PompeiuHausdorff(resume=path, ...) continues it in another process")
+      .def_prop_ro("tol", &PompeiuHausdorff::tolerance, "Current tolerance (as given to the constructor or to refine)")
+      .def_prop_ro("initialized", &PompeiuHausdorff::initialized, "False if the sampled pre-pass of a decision answered above_threshold before the initial pass (A is not subdivided: refine raises and next_frame starts with the initial pass)")
+      .def_prop_ro("exit_reason", [](const PompeiuHausdorff & ph){ return std::string(pompeiu_hausdorff_exit_name(ph.exit_reason)); },
+           "Why the last refinement ended (see refine)")
       .def_ro("lower", &PompeiuHausdorff::lower,"Computed lower bound of the Pompeiu-Hausdorff distance")
       .def_ro("upper_max", &PompeiuHausdorff::upper_max,"Computed upper bound of the Pompeiu-Hausdorff distance")
+      .def_ro("lower_point", &PompeiuHausdorff::lower_point,"Point of A at distance lower from B (e.g. to pass as hint_points to the next run)")
       .def_ro("dA", &PompeiuHausdorff::dA,"Length of the diagonal of mesh A's bounding box")
       .def_ro("time_taken_bvh", &PompeiuHausdorff::time_taken_bvh,"Time taken to build the BVH for mesh B")
       .def_ro("time_taken_bounds", &PompeiuHausdorff::time_taken_bounds,"Time taken to compute the bounds")
+      .def_prop_ro("stats", [](const PompeiuHausdorff & ph){ return stats_to_dict(ph.stats); },
+           "Counters and per-stage timings of the run (times in milliseconds on a monotonic clock): iterations, closest_point_queries, bound_attempts and bound_successes (per bound u0, u1, u2, kang, u4), time_bvh, time_queries, time_bounds, time_queue, time_allocation, max_depth, peak_queue_size and peak_allocated_bytes")
       .def_ro("number_of_vertices", &PompeiuHausdorff::number_of_vertices,"Current number of vertices in the subdivided mesh A")
       .def_ro("number_of_faces", &PompeiuHausdorff::number_of_faces,"Current number of faces in the subdivided mesh A")
       .def_ro("VA_aug", &PompeiuHausdorff::VA_aug,"Current memory allocation for vertices (top number_of_vertices rows of VA_aug are active)")
@@ -44,13 +321,16 @@ NB_MODULE(cascading_upper_bounds_ext, m) {
       .def_ro("I_aug", &PompeiuHausdorff::I_aug,"Current memory allocation for indices in the subdivided mesh A")
       .def_ro("FA_aug", &PompeiuHausdorff::FA_aug,"Current memory allocation for faces (top number_of_faces rows of FA_aug are active)")
       .def_ro("upper_aug", &PompeiuHausdorff::upper_aug,"#FA_aug list of per-triangle upper bounds")
+      .def_ro("free_vertices", &PompeiuHausdorff::free_vertices,"Rows of VA_aug below number_of_vertices that are free for reuse (only with recycle)")
+      .def_ro("free_faces", &PompeiuHausdorff::free_faces,"Rows of FA_aug below number_of_faces that are free for reuse (only with recycle)")
       // Even though this is read only the pop method above seems to modify it
       .def_ro("Q", &PompeiuHausdorff::Q,"Queue of triangles with upper bound greater than global lower bound")
       ;
 
 
-  m.def("pompeiu_hausdorff", &pompeiu_hausdorff,
-      "VA"_a, "FA"_a, "VB"_a, "FB"_a, "tol"_a=1e-8, "max_factor"_a=1000000, "normalize"_a=false,
+  m.def("pompeiu_hausdorff", [](const Eigen::Matrix<double, Eigen::Dynamic, 3, Eigen::RowMajor> & VA, const Eigen::Matrix<int, Eigen::Dynamic, 3, Eigen::RowMajor> & FA, const Eigen::Matrix<double, Eigen::Dynamic, 3, Eigen::RowMajor> & VB, const Eigen::Matrix<int, Eigen::Dynamic, 3, Eigen::RowMajor> & FB, double tol, double max_factor, bool normalize, int batch_size, bool recycle, bool wide_bvh, bool lazy, bool adaptive_cascade)
+      { return pompeiu_hausdorff(VA, FA, VB, FB, tol, max_factor, normalize, make_options(batch_size, recycle, wide_bvh, lazy, adaptive_cascade)); },
+      "VA"_a, "FA"_a, "VB"_a, "FB"_a, "tol"_a=1e-8, "max_factor"_a=1000000, "normalize"_a=false, "batch_size"_a=1, "recycle"_a=false, "wide_bvh"_a=false, "lazy"_a=false, "adaptive_cascade"_a=false,
       R"(Compute lower and upper bounds on the Pompeiu-Hausdorff distance between two
 meshes A and B
 
@@ -61,5 +341,86 @@ meshes A and B
 @param[in] tol  tolerance value for the difference between upper and lower bounds
 @param[in] max_factor  factor to define the maximum allowed number of faces and vertices in the subdivided mesh A with respect to the number of faces and vertices of the initial mesh A
 @param[in] normalize  0 (false) or 1 (true) to normalize tolerance by the length of the diagonal of A's bounding box
+@param[in] batch_size  number of triangles refined in parallel per iteration (1 is sequential)
+@param[in] recycle  reuse the storage of triangles that left the queue so that memory is bounded by the queue instead of the refinement history (same bounds)
+@param[in] wide_bvh  query mesh B with a 4-wide SAH BVH and vectorized point-triangle distances instead of libigl's AABB tree (same distances up to rounding)
+@param[in] lazy  queue new triangles with the cheap bounds only and evaluate Kang's bound and u4 once a triangle reaches the top of the queue (certified bounds, different refinement order)
+@param[in] adaptive_cascade  try the cheaper of Kang's bound and u4 per rejected triangle first (measured while refining) and skip the other while it rejects almost nothing on its own (certified bounds, not reproducible)
+)");
+
+  m.def("symmetric_pompeiu_hausdorff", [](const Eigen::Matrix<double, Eigen::Dynamic, 3, Eigen::RowMajor> & VA, const Eigen::Matrix<int, Eigen::Dynamic, 3, Eigen::RowMajor> & FA, const Eigen::Matrix<double, Eigen::Dynamic, 3, Eigen::RowMajor> & VB, const Eigen::Matrix<int, Eigen::Dynamic, 3, Eigen::RowMajor> & FB, double tol, double max_factor, bool normalize, int batch_size, bool recycle, bool wide_bvh, bool lazy, bool adaptive_cascade)
+      { return symmetric_pompeiu_hausdorff(VA, FA, VB, FB, tol, max_factor, normalize, make_options(batch_size, recycle, wide_bvh, lazy, adaptive_cascade)); },
+      "VA"_a, "FA"_a, "VB"_a, "FB"_a, "tol"_a=1e-8, "max_factor"_a=1000000, "normalize"_a=false, "batch_size"_a=1, "recycle"_a=false, "wide_bvh"_a=false, "lazy"_a=false, "adaptive_cascade"_a=false,
+      R"(Compute lower and upper bounds on the symmetric Pompeiu-Hausdorff distance
+max(h(A,B),h(B,A)) between two meshes A and B, refining both directions
+concurrently
+
+@param[in] VA  #VA by 3 list of vertex positions of mesh A 
+@param[in] FA  #FA by 3 list of triangle indices into VA
+@param[in] VB  #VB by 3 list of vertex positions of mesh B
+@param[in] FB  #FB by 3 list of triangle indices into VB
+@param[in] tol  tolerance value for the difference between upper and lower bounds
+@param[in] max_factor  factor to define the maximum allowed number of faces and vertices in the subdivided mesh with respect to the number of faces and vertices of the initial mesh (for each direction)
+@param[in] normalize  0 (false) or 1 (true) to normalize tolerance by the length of the diagonal of A's bounding box
+@param[in] batch_size  number of triangles refined in parallel per iteration in each direction (1 is sequential)
+@param[in] recycle  reuse the storage of triangles that left the queue so that memory is bounded by the queue instead of the refinement history (same bounds)
+@param[in] wide_bvh  query mesh B with a 4-wide SAH BVH and vectorized point-triangle distances instead of libigl's AABB tree (same distances up to rounding)
+@param[in] lazy  queue new triangles with the cheap bounds only and evaluate Kang's bound and u4 once a triangle reaches the top of the queue (certified bounds, different refinement order)
+@param[in] adaptive_cascade  try the cheaper of Kang's bound and u4 per rejected triangle first (measured while refining) and skip the other while it rejects almost nothing on its own (certified bounds, not reproducible)
+)");
+
+  m.def("streaming_pompeiu_hausdorff", [](const std::string & path_A, const PompeiuHausdorffTarget & target, int chunk_faces, double tol, double max_factor, bool normalize, int batch_size, bool recycle, bool lazy, bool adaptive_cascade)
+      { return streaming_pompeiu_hausdorff(path_A, target, chunk_faces, tol, max_factor, normalize, make_options(batch_size, recycle, false, lazy, adaptive_cascade)); },
+      "path_A"_a, "target"_a, "chunk_faces"_a=1000000, "tol"_a=1e-8, "max_factor"_a=1000000, "normalize"_a=false, "batch_size"_a=1, "recycle"_a=false, "lazy"_a=false, "adaptive_cascade"_a=false,
+      nb::call_guard<nb::gil_scoped_release>(),
+      R"(Compute lower and upper bounds on the Pompeiu-Hausdorff distance from a
+mesh A too large for the memory to a target mesh B, streaming A from a .phdm
+file in chunks of consecutive faces (memory is bounded by B and one chunk).
+Each chunk is refined against the best lower bound found so far, and only to
+the tolerance if it can raise it.
+
+@param[in] path_A  path to the .phdm file of mesh A (see write_triangle_mesh_binary)
+@param[in] target  mesh B and its BVH
+@param[in] chunk_faces  number of faces of A per chunk
+@param[in] tol  tolerance value for the difference between upper and lower bounds
+@param[in] max_factor  factor to define the maximum allowed number of faces and vertices in the subdivided chunk with respect to the number of faces and vertices of the chunk
+@param[in] normalize  0 (false) or 1 (true) to normalize tolerance by the length of the diagonal of A's bounding box
+@param[in] batch_size  number of triangles refined in parallel per iteration (1 is sequential)
+@param[in] recycle  reuse the storage of triangles that left the queue so that memory is bounded by the queue instead of the refinement history (same bounds)
+@param[in] lazy  queue new triangles with the cheap bounds only and evaluate Kang's bound and u4 once a triangle reaches the top of the queue (certified bounds, different refinement order)
+@param[in] adaptive_cascade  try the cheaper of Kang's bound and u4 per rejected triangle first (measured while refining) and skip the other while it rejects almost nothing on its own (certified bounds, not reproducible)
+)");
+
+  m.def("sharded_pompeiu_hausdorff", [](const Eigen::Matrix<double, Eigen::Dynamic, 3, Eigen::RowMajor> & VA, const Eigen::Matrix<int, Eigen::Dynamic, 3, Eigen::RowMajor> & FA, const PompeiuHausdorffTarget & target, int processes, int shards, double tol, double max_factor, bool normalize, int batch_size, bool recycle, bool lazy, bool adaptive_cascade)
+      { return sharded_pompeiu_hausdorff(VA, FA, target, processes, shards, tol, max_factor, normalize, make_options(batch_size, recycle, false, lazy, adaptive_cascade)); },
+      "VA"_a, "FA"_a, "target"_a, "processes"_a=0, "shards"_a=0, "tol"_a=1e-8, "max_factor"_a=1000000, "normalize"_a=false, "batch_size"_a=1, "recycle"_a=false, "lazy"_a=false, "adaptive_cascade"_a=false,
+      nb::call_guard<nb::gil_scoped_release>(),
+      R"(Compute lower and upper bounds on the Pompeiu-Hausdorff distance from a
+mesh A to a target mesh B with forked worker processes (POSIX only). A is
+split into spatially coherent shards refined against the shared target, with
+the best lower bound of all workers in shared memory; crashed workers are
+replaced. Set IGL_NUM_THREADS to the number of cores divided by processes.
+
+@param[in] VA  #VA by 3 list of vertex positions of mesh A 
+@param[in] FA  #FA by 3 list of triangle indices into VA
+@param[in] target  mesh B and its BVH
+@param[in] processes  number of worker processes (0 for the number of cores)
+@param[in] shards  number of shards of A (0 for 4 per process)
+@param[in] tol  tolerance value for the difference between upper and lower bounds
+@param[in] max_factor  factor to define the maximum allowed number of faces and vertices in the subdivided shard with respect to the number of faces and vertices of the shard
+@param[in] normalize  0 (false) or 1 (true) to normalize tolerance by the length of the diagonal of A's bounding box
+@param[in] batch_size  number of triangles refined in parallel per iteration by each worker (1 is sequential)
+@param[in] recycle  reuse the storage of triangles that left the queue so that memory is bounded by the queue instead of the refinement history (same bounds)
+@param[in] lazy  queue new triangles with the cheap bounds only and evaluate Kang's bound and u4 once a triangle reaches the top of the queue (certified bounds, different refinement order)
+@param[in] adaptive_cascade  try the cheaper of Kang's bound and u4 per rejected triangle first (measured while refining) and skip the other while it rejects almost nothing on its own (certified bounds, not reproducible)
 )");
+
+  m.def("write_triangle_mesh_binary", [](const std::string & path, const Eigen::Matrix<double, Eigen::Dynamic, 3, Eigen::RowMajor> & V, const Eigen::Matrix<int, Eigen::Dynamic, 3, Eigen::RowMajor> & F)
+      {
+        if (!write_triangle_mesh_binary(path, V, F)){
+          throw std::runtime_error("Could not write " + path);
+        }
+      },
+      "path"_a, "V"_a, "F"_a,
+      "Write a triangle mesh to the raw binary .phdm format, which streaming_pompeiu_hausdorff reads in chunks");
 }
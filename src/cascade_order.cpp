@@ -0,0 +1,83 @@
+#include "cascade_order.h"
+
+// One face in this many that reach the expensive bounds is a probe
+#define CASCADE_ORDER_PROBE_PERIOD 16
+// Keep the fixed order until there are this many probes
+#define CASCADE_ORDER_MIN_PROBES 64
+// Halve the tallies once they hold this many probes
+#define CASCADE_ORDER_WINDOW 4096
+// Skip the second bound if it rejects fewer than this fraction of the probes
+// that the first one does not reject
+#define CASCADE_ORDER_SKIP_FRACTION 0.01
+
+CascadeCounters::CascadeCounters(): evaluations(0), probes(0)
+{
+    for (int b = 0;b<2;b++){
+        attempts[b] = 0;
+        successes[b] = 0;
+        rejected[b] = 0;
+        rejected_alone[b] = 0;
+        seconds[b] = 0;
+    }
+}
+
+CascadeOrder::CascadeOrder(const bool adaptive): m_adaptive(adaptive), m_probes(0)
+{
+    for (int b = 0;b<2;b++){
+        m_rejected[b] = 0;
+        m_rejected_alone[b] = 0;
+        m_seconds[b] = 0;
+    }
+    plan();
+}
+
+bool CascadeOrder::probe(CascadeCounters & counters) const
+{
+    const bool is_probe = m_adaptive && counters.evaluations%CASCADE_ORDER_PROBE_PERIOD==0;
+    counters.evaluations++;
+    return is_probe;
+}
+
+void CascadeOrder::update(CascadeCounters & counters)
+{
+    m_probes += counters.probes;
+    counters.probes = 0;
+    for (int b = 0;b<2;b++){
+        m_rejected[b] += counters.rejected[b];
+        m_rejected_alone[b] += counters.rejected_alone[b];
+        m_seconds[b] += counters.seconds[b];
+        counters.rejected[b] = 0;
+        counters.rejected_alone[b] = 0;
+        counters.seconds[b] = 0;
+    }
+    if (m_probes>CASCADE_ORDER_WINDOW){
+        m_probes /= 2;
+        for (int b = 0;b<2;b++){
+            m_rejected[b] /= 2;
+            m_rejected_alone[b] /= 2;
+            m_seconds[b] /= 2;
+        }
+    }
+    plan();
+}
+
+void CascadeOrder::plan()
+{
+    // fixed order: Kang's bound, then u4
+    m_size = 2;
+    m_bound[0] = 3;
+    m_bound[1] = 4;
+    if (!m_adaptive || m_probes<CASCADE_ORDER_MIN_PROBES){
+        return;
+    }
+    // the bound with the lower cost per rejected face goes first
+    const double cost_kang = m_seconds[0]/(m_rejected[0]+1);
+    const double cost_u4 = m_seconds[1]/(m_rejected[1]+1);
+    const int first = cost_u4<cost_kang ? 1 : 0;
+    m_bound[0] = 3+first;
+    m_bound[1] = 4-first;
+    // and the second one is only tried if it still rejects faces on its own
+    if (m_rejected_alone[1-first]<CASCADE_ORDER_SKIP_FRACTION*m_probes){
+        m_size = 1;
+    }
+}
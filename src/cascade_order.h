@@ -0,0 +1,71 @@
+#ifndef CASCADE_ORDER_H
+#define CASCADE_ORDER_H
+
+/// Tallies of the expensive part of the cascade (Kang's bound and u4) kept by
+/// one refinement slot, so that workers never share them. Bound 0 is Kang's
+/// bound and bound 1 is u4.
+struct CascadeCounters
+{
+  CascadeCounters();
+  /// Number of faces that reached the expensive bounds (never reset, it
+  /// decides which faces are probes)
+  long evaluations;
+  /// Per bound, number of faces it was evaluated on and number of faces it
+  /// rejected (moved to the stats of the run by the refinement)
+  long attempts[2];
+  long successes[2];
+  /// Number of probes: faces evaluated with both bounds, in full, to measure
+  /// them independently of the current order
+  long probes;
+  /// Per bound, number of probes it rejects on its own
+  long rejected[2];
+  /// Per bound, number of probes it rejects and the other bound does not
+  long rejected_alone[2];
+  /// Per bound, seconds spent evaluating it on the probes
+  double seconds[2];
+};
+
+/// Order in which the expensive bounds of the cascade are tried once the
+/// cheap ones (u0, u1, u2) fail to reject a face.
+///
+/// The fixed order is Kang's bound, then u4, so results only depend on the
+/// input. The adaptive order is re-planned during refinement from the
+/// success rate and cost of each bound, measured on a sample of the faces
+/// (the probes):
+///
+///  - the bound that costs less per face it rejects goes first,
+///  - the second bound is skipped while it rejects almost no face that the
+///    first one does not.
+///
+/// Skipping a bound only loosens the (still valid) upper bounds of faces that
+/// are not rejected. Timings vary from run to run, so adaptive results are
+/// certified but not reproducible.
+class CascadeOrder
+{
+  public:
+  /// @param[in] adaptive  re-plan the order from the counters passed to
+  ///   update() (fixed order otherwise)
+  CascadeOrder(const bool adaptive = false);
+  bool adaptive() const { return m_adaptive; }
+  /// Number of expensive bounds tried (1 if the second one is skipped)
+  int size() const { return m_size; }
+  /// k-th bound tried, numbered like success_bound (3: Kang's bound, 4: u4)
+  int bound(const int k) const { return m_bound[k]; }
+  /// Count a face that reached the expensive bounds and tell whether to
+  /// evaluate it as a probe (only with the adaptive order)
+  bool probe(CascadeCounters & counters) const;
+  /// Add the probe tallies of a slot (and reset them) and re-plan the order
+  void update(CascadeCounters & counters);
+  private:
+  void plan();
+  bool m_adaptive;
+  int m_size;
+  int m_bound[2];
+  // tallies of all slots, halved once there are enough probes so that the
+  // order follows the current stage of the refinement
+  double m_probes;
+  double m_rejected[2];
+  double m_rejected_alone[2];
+  double m_seconds[2];
+};
+#endif
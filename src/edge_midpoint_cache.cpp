@@ -0,0 +1,105 @@
+#include "edge_midpoint_cache.h"
+#include <algorithm>
+#include <cstring>
+
+// Marks empty entries (no edge has both endpoints equal to INT_MAX)
+#define EDGE_MIDPOINT_CACHE_EMPTY UINT64_MAX
+// Number of entries per set
+#define EDGE_MIDPOINT_CACHE_WAYS 4
+
+EdgeMidpointCache::EdgeMidpointCache(const size_t capacity)
+{
+    size_t n = EDGE_MIDPOINT_CACHE_WAYS;
+    while (n < capacity){
+        n *= 2;
+    }
+    Entry empty;
+    empty.key = EDGE_MIDPOINT_CACHE_EMPTY;
+    empty.m = -1;
+    empty.generation_a = empty.generation_b = empty.generation_m = 0;
+    m_table.assign(n,empty);
+}
+
+uint64_t EdgeMidpointCache::edge_key(const int a, const int b)
+{
+    return (uint64_t(uint32_t(std::min(a,b)))<<32) | uint64_t(uint32_t(std::max(a,b)));
+}
+
+EdgeMidpointCache::Entry * EdgeMidpointCache::set(const uint64_t key)
+{
+    // Fibonacci hashing of the 64-bit key
+    uint64_t h = key*UINT64_C(0x9E3779B97F4A7C15);
+    h ^= h>>32;
+    const size_t number_of_sets = m_table.size()/EDGE_MIDPOINT_CACHE_WAYS;
+    return &m_table[(size_t(h) & (number_of_sets-1))*EDGE_MIDPOINT_CACHE_WAYS];
+}
+
+bool EdgeMidpointCache::take(
+    const int a,
+    const int b,
+    const std::vector<uint32_t> & generation,
+    int & m)
+{
+    const uint64_t key = edge_key(a,b);
+    Entry * entries = set(key);
+    for (int w = 0;w<EDGE_MIDPOINT_CACHE_WAYS;w++){
+        Entry & entry = entries[w];
+        if (entry.key == key){
+            entry.key = EDGE_MIDPOINT_CACHE_EMPTY;
+            m = entry.m;
+            return
+                generation[a] == (a<b ? entry.generation_a : entry.generation_b) &&
+                generation[b] == (a<b ? entry.generation_b : entry.generation_a) &&
+                generation[m] == entry.generation_m;
+        }
+    }
+    return false;
+}
+
+void EdgeMidpointCache::insert(
+    const int a,
+    const int b,
+    const int m,
+    const std::vector<uint32_t> & generation)
+{
+    const uint64_t key = edge_key(a,b);
+    Entry * entries = set(key);
+    // the set is kept oldest first: use an empty way or evict the oldest, and
+    // append the new entry at the end
+    int w = 0;
+    while (w < EDGE_MIDPOINT_CACHE_WAYS && entries[w].key != EDGE_MIDPOINT_CACHE_EMPTY){
+        w++;
+    }
+    if (w == EDGE_MIDPOINT_CACHE_WAYS){
+        w = 0;
+    }
+    for (;w<EDGE_MIDPOINT_CACHE_WAYS-1;w++){
+        entries[w] = entries[w+1];
+    }
+    Entry & entry = entries[EDGE_MIDPOINT_CACHE_WAYS-1];
+    entry.key = key;
+    entry.m = m;
+    entry.generation_a = generation[std::min(a,b)];
+    entry.generation_b = generation[std::max(a,b)];
+    entry.generation_m = generation[m];
+}
+
+void EdgeMidpointCache::clear()
+{
+    for (size_t i = 0;i<m_table.size();i++){
+        m_table[i].key = EDGE_MIDPOINT_CACHE_EMPTY;
+    }
+}
+
+bool EdgeMidpointCache::assign(const void * data, const size_t capacity, const int num_vertices)
+{
+    std::vector<Entry> table(capacity);
+    std::memcpy(table.data(),data,capacity*sizeof(Entry));
+    for (size_t i = 0;i<capacity;i++){
+        if (table[i].key != EDGE_MIDPOINT_CACHE_EMPTY && (table[i].m < 0 || table[i].m >= num_vertices)){
+            return false;
+        }
+    }
+    m_table.swap(table);
+    return true;
+}
@@ -0,0 +1,73 @@
+#ifndef EDGE_MIDPOINT_CACHE_H
+#define EDGE_MIDPOINT_CACHE_H
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/// Midpoints of subdivided edges of A, keyed on the sorted pair of endpoint
+/// vertex rows, so that the two triangles sharing an edge share its midpoint
+/// (and its closest-point query).
+///
+/// The cache is a fixed-size, 4-way set-associative table: a new entry evicts
+/// the oldest one of its set when the set is full. Neighbouring triangles have
+/// similar upper bounds and are usually subdivided shortly after one another,
+/// so a small table catches most shared midpoints, while its memory does not
+/// grow with edges whose neighbour is never subdivided. An evicted midpoint is
+/// just created again.
+///
+/// Vertex rows can be recycled, so every entry records the generation of its
+/// three rows; an entry whose rows have been reused since is treated as
+/// missing.
+class EdgeMidpointCache
+{
+  public:
+  /// @param[in] capacity  number of entries (rounded up to a power of two)
+  EdgeMidpointCache(const size_t capacity = 1<<18);
+  /// Look up the midpoint of edge (a,b) and remove it from the cache (an edge
+  /// is shared by at most two triangles, so it is not needed again)
+  ///
+  /// @param[in] a,b  vertex rows of the endpoints (any order)
+  /// @param[in] generation  #rows list of generations of each vertex row
+  /// @param[out] m  vertex row of the midpoint
+  /// @return true if a valid midpoint was found
+  bool take(
+    const int a,
+    const int b,
+    const std::vector<uint32_t> & generation,
+    int & m);
+  /// Store the midpoint m of edge (a,b)
+  void insert(
+    const int a,
+    const int b,
+    const int m,
+    const std::vector<uint32_t> & generation);
+  /// Remove all entries
+  void clear();
+  /// Number of entries the cache can hold
+  size_t capacity() const { return m_table.size(); }
+  /// Memory held by the table, in bytes
+  size_t allocated_bytes() const { return m_table.capacity()*sizeof(Entry); }
+  /// Raw table of capacity() entries of entry_size() bytes (e.g. to save the
+  /// cache)
+  const void * data() const { return m_table.data(); }
+  static size_t entry_size() { return sizeof(Entry); }
+  /// Replace the table by one read from data()
+  ///
+  /// @param[in] data  capacity entries of entry_size() bytes
+  /// @param[in] capacity  number of entries (a power of two, at least 4)
+  /// @param[in] num_vertices  number of vertex rows the midpoints index
+  /// @return false (and the cache is unchanged) if an entry refers to a
+  ///   midpoint outside [0,num_vertices)
+  bool assign(const void * data, const size_t capacity, const int num_vertices);
+  private:
+  struct Entry
+  {
+    uint64_t key;
+    int m;
+    uint32_t generation_a, generation_b, generation_m;
+  };
+  static uint64_t edge_key(const int a, const int b);
+  Entry * set(const uint64_t key);
+  std::vector<Entry> m_table;
+};
+#endif
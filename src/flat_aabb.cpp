@@ -0,0 +1,81 @@
+#include "flat_aabb.h"
+#include <igl/point_simplex_squared_distance.h>
+
+namespace
+{
+    int flatten_aabb_recursive(const igl::AABB<Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor>,3> & tree, std::vector<FlatAABBNode> & nodes){
+        const int n = nodes.size();
+        nodes.push_back(FlatAABBNode());
+        for (int d = 0;d<3;d++){
+            nodes[n].box_min[d] = tree.m_box.min()(d);
+            nodes[n].box_max[d] = tree.m_box.max()(d);
+        }
+        nodes[n].right = -1;
+        nodes[n].primitive = tree.m_primitive;
+        if (!tree.is_leaf()){
+            flatten_aabb_recursive(*tree.m_left,nodes);
+            const int right = flatten_aabb_recursive(*tree.m_right,nodes);
+            nodes[n].right = right;
+        }
+        return n;
+    }
+
+    // squared distance from p to the box of a node (0 inside)
+    inline double box_squared_distance(const FlatAABBNode & node, const Eigen::RowVector3d & p){
+        double sqr_d = 0;
+        for (int d = 0;d<3;d++){
+            const double below = node.box_min[d]-p(d);
+            const double above = p(d)-node.box_max[d];
+            if (below>0){
+                sqr_d += below*below;
+            } else if (above>0){
+                sqr_d += above*above;
+            }
+        }
+        return sqr_d;
+    }
+
+    void flat_aabb_squared_distance_recursive(const FlatAABBNode * nodes, const int n, const Eigen::Ref<const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> > & V, const Eigen::Ref<const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> > & F, const Eigen::RowVector3d & p, double & sqr_d, int & i, Eigen::RowVector3d & c){
+        const FlatAABBNode & node = nodes[n];
+        if (node.primitive>=0){
+            double sqr_d_leaf;
+            Eigen::RowVector3d c_leaf;
+            igl::point_simplex_squared_distance<3>(p,V,F,node.primitive,sqr_d_leaf,c_leaf);
+            if (sqr_d_leaf<sqr_d){
+                sqr_d = sqr_d_leaf;
+                i = node.primitive;
+                c = c_leaf;
+            }
+            return;
+        }
+        const int left = n+1;
+        const int right = node.right;
+        const double sqr_d_left = box_squared_distance(nodes[left],p);
+        const double sqr_d_right = box_squared_distance(nodes[right],p);
+        // look at the closer child first
+        if (sqr_d_left<sqr_d_right){
+            if (sqr_d_left<sqr_d) flat_aabb_squared_distance_recursive(nodes,left,V,F,p,sqr_d,i,c);
+            if (sqr_d_right<sqr_d) flat_aabb_squared_distance_recursive(nodes,right,V,F,p,sqr_d,i,c);
+        } else {
+            if (sqr_d_right<sqr_d) flat_aabb_squared_distance_recursive(nodes,right,V,F,p,sqr_d,i,c);
+            if (sqr_d_left<sqr_d) flat_aabb_squared_distance_recursive(nodes,left,V,F,p,sqr_d,i,c);
+        }
+    }
+}
+
+void flatten_aabb(const igl::AABB<Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor>,3> & tree, std::vector<FlatAABBNode> & nodes){
+    nodes.clear();
+    // an empty tree has no primitive and no children
+    if (!tree.is_leaf() && tree.m_left==nullptr){
+        return;
+    }
+    flatten_aabb_recursive(tree,nodes);
+}
+
+double flat_aabb_squared_distance(const FlatAABBNode * nodes, const int num_nodes, const Eigen::Ref<const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> > & V, const Eigen::Ref<const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> > & F, const Eigen::RowVector3d & p, const double up_sqr_d, int & i, Eigen::RowVector3d & c){
+    double sqr_d = up_sqr_d;
+    if (num_nodes>0 && box_squared_distance(nodes[0],p)<sqr_d){
+        flat_aabb_squared_distance_recursive(nodes,0,V,F,p,sqr_d,i,c);
+    }
+    return sqr_d;
+}
@@ -0,0 +1,50 @@
+#ifndef FLAT_AABB_H
+#define FLAT_AABB_H
+// Flattened (pre-order) AABB tree over the triangles of a mesh, stored in a
+// single contiguous array so that it can be written to disk and queried
+// directly from a memory mapping.
+
+#include <Eigen/Core>
+#include <igl/AABB.h>
+#include <vector>
+
+// Node of a flattened AABB tree. The left child of an internal node n is
+// n+1 (pre-order), so only the right child is stored.
+struct FlatAABBNode
+{
+    double box_min[3];
+    double box_max[3];
+    // index of the right child (-1 for leaves)
+    int right;
+    // index of the triangle stored in a leaf (-1 for internal nodes)
+    int primitive;
+};
+
+// Given a libigl AABB tree, this function lists its nodes in pre-order.
+
+// Input:
+// tree: AABB tree over the triangles of a mesh
+
+// Output:
+// nodes: #nodes list of flattened nodes (empty if the tree is empty)
+
+void flatten_aabb(const igl::AABB<Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor>,3> & tree, std::vector<FlatAABBNode> & nodes);
+
+// Given a flattened AABB tree over the triangles (V,F), this function computes the closest point on the mesh to a query point. Traversal visits the closer child first and prunes boxes farther than the current best, as libigl does.
+
+// Input:
+// nodes: #nodes list of flattened nodes
+// num_nodes: number of nodes
+// V: #V x 3 Eigen matrix containing x, y z coordinates of each vertex
+// F: #F x 3 Eigen matrix containing vertex indices of each face
+// p: query point
+// up_sqr_d: upper bound on the squared distance (only closer points are reported)
+
+// Output:
+// i: index of the closest triangle (unchanged if none is closer than up_sqr_d)
+// c: closest point (unchanged if none is closer than up_sqr_d)
+// returns the squared distance (up_sqr_d if none is closer)
+
+double flat_aabb_squared_distance(const FlatAABBNode * nodes, const int num_nodes, const Eigen::Ref<const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> > & V, const Eigen::Ref<const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> > & F, const Eigen::RowVector3d & p, const double up_sqr_d, int & i, Eigen::RowVector3d & c);
+
+#endif
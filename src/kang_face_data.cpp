@@ -0,0 +1,112 @@
+#include "kang_face_data.h"
+#include "kang_intersect_edge_and_bisector.h"
+#include <igl/parallel_for.h>
+#include <igl/point_simplex_squared_distance.h>
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+
+KangFaceData::KangFaceData(
+    const Eigen::Ref<const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> > & VB,
+    const Eigen::Ref<const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> > & FB):
+    m_faces(FB.rows())
+{
+    // corners and planes
+    igl::parallel_for(FB.rows(),[&](const int f)
+    {
+        Face & face = m_faces[f];
+        for (int c=0; c<3; c++){
+            face.vertices[c] = FB(f,c);
+            face.neighbors[c] = -1;
+            for (int d=0; d<3; d++){
+                face.corners[3*c+d] = VB(FB(f,c),d);
+            }
+        }
+        Eigen::Vector4d plane;
+        kang_normalized_plane(VB.row(FB(f,0)).transpose(),VB.row(FB(f,1)).transpose(),VB.row(FB(f,2)).transpose(),plane);
+        for (int d=0; d<4; d++){
+            face.plane[d] = plane(d);
+        }
+        face.regular = FB(f,0)!=FB(f,1) && FB(f,1)!=FB(f,2) && FB(f,2)!=FB(f,0);
+    },10000);
+
+    // edges of the faces with three distinct vertices, sorted so that the faces
+    // sharing an edge are consecutive
+    std::vector<std::pair<uint64_t,int> > edges;
+    edges.reserve(3*FB.rows());
+    for (int f=0; f<FB.rows(); f++){
+        if (!m_faces[f].regular){
+            continue;
+        }
+        for (int c=0; c<3; c++){
+            const uint32_t a = FB(f,c);
+            const uint32_t b = FB(f,(c+1)%3);
+            edges.push_back(std::make_pair((uint64_t(std::min(a,b))<<32)|std::max(a,b),3*f+c));
+        }
+    }
+    std::sort(edges.begin(),edges.end());
+    for (size_t first=0; first<edges.size();){
+        size_t last = first+1;
+        while (last<edges.size() && edges[last].first==edges[first].first){
+            last++;
+        }
+        if (last-first==2){
+            m_faces[edges[first].second/3].neighbors[edges[first].second%3] = edges[first+1].second/3;
+            m_faces[edges[first+1].second/3].neighbors[edges[first+1].second%3] = edges[first].second/3;
+        } else if (last-first>2){
+            for (size_t e=first; e<last; e++){
+                m_faces[edges[e].second/3].regular = false;
+            }
+        }
+        first = last;
+    }
+}
+
+void KangFaceData::update_vertices(
+    const Eigen::Ref<const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> > & VB)
+{
+    igl::parallel_for(m_faces.size(),[&](const int f)
+    {
+        Face & face = m_faces[f];
+        for (int c=0; c<3; c++){
+            for (int d=0; d<3; d++){
+                face.corners[3*c+d] = VB(face.vertices[c],d);
+            }
+        }
+        Eigen::Vector4d plane;
+        kang_normalized_plane(VB.row(face.vertices[0]).transpose(),VB.row(face.vertices[1]).transpose(),VB.row(face.vertices[2]).transpose(),plane);
+        for (int d=0; d<4; d++){
+            face.plane[d] = plane(d);
+        }
+    },10000);
+}
+
+bool KangFaceData::edge_adjacent(const int f, const int g) const
+{
+    const Face & face_f = m_faces[f];
+    const Face & face_g = m_faces[g];
+    if (face_f.regular && face_g.regular){
+        // faces sharing two vertices are neighbors across one edge (sharing all
+        // three vertices makes them neighbors across every edge)
+        return (face_f.neighbors[0]==g)+(face_f.neighbors[1]==g)+(face_f.neighbors[2]==g)==1;
+    }
+    // count the distinct vertices of the two faces
+    int vertices[6];
+    int number_of_vertices = 0;
+    for (int k=0; k<6; k++){
+        const int v = k<3 ? face_f.vertices[k] : face_g.vertices[k-3];
+        if (std::find(vertices,vertices+number_of_vertices,v)==vertices+number_of_vertices){
+            vertices[number_of_vertices++] = v;
+        }
+    }
+    return number_of_vertices==4;
+}
+
+double KangFaceData::squared_distance(const Eigen::RowVector3d & p, const int f) const
+{
+    const Eigen::Matrix<int,1,3> triangle(0,1,2);
+    double sqr_d;
+    Eigen::RowVector3d c;
+    igl::point_simplex_squared_distance<3>(p,corners(f),triangle,0,sqr_d,c);
+    return sqr_d;
+}
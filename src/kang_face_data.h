@@ -0,0 +1,62 @@
+#ifndef KANG_FACE_DATA_H
+#define KANG_FACE_DATA_H
+#include <Eigen/Core>
+#include <vector>
+
+/// Per-face data of mesh B used by Kang's bound, computed once per mesh and
+/// stored as one flat record per face: the corner positions, the normalized
+/// plane equation and the faces sharing each edge. Kang's bound then looks
+/// these up instead of recomputing planes and comparing vertex lists for
+/// every triangle of A.
+///
+/// All lookups give bit-identical results to computing the same quantities
+/// from VB and FB.
+class KangFaceData
+{
+  public:
+  KangFaceData() {}
+  /// @param[in] VB  #VB by 3 list of vertex positions of mesh B
+  /// @param[in] FB  #FB by 3 list of triangle indices into VB
+  KangFaceData(
+    const Eigen::Ref<const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> > & VB,
+    const Eigen::Ref<const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> > & FB);
+  /// Update the corners and planes to moved vertices (same faces, so the
+  /// adjacency is kept)
+  ///
+  /// @param[in] VB  #VB by 3 list of new vertex positions of mesh B
+  void update_vertices(
+    const Eigen::Ref<const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> > & VB);
+  /// Number of faces
+  int size() const { return m_faces.size(); }
+  /// 3 by 3 matrix whose rows are the corners of face f
+  Eigen::Map<const Eigen::Matrix<double,3,3,Eigen::RowMajor> > corners(const int f) const
+  {
+    return Eigen::Map<const Eigen::Matrix<double,3,3,Eigen::RowMajor> >(m_faces[f].corners);
+  }
+  /// Coefficients (a,b,c,d) of the plane ax+by+cz+d = 0 supporting face f,
+  /// scaled so that (a,b,c) has unit length, with the normal
+  /// (c2-c0)×(c1-c0) used by kang_intersect_edge_and_bisector
+  Eigen::Map<const Eigen::Vector4d> plane(const int f) const
+  {
+    return Eigen::Map<const Eigen::Vector4d>(m_faces[f].plane);
+  }
+  /// True if faces f and g (f != g) have exactly four distinct vertices
+  /// between them, i.e. they share one edge
+  bool edge_adjacent(const int f, const int g) const;
+  /// Squared distance from p to face f
+  double squared_distance(const Eigen::RowVector3d & p, const int f) const;
+  private:
+  struct Face
+  {
+    double corners[9];
+    double plane[4];
+    int vertices[3];
+    // face across each edge (c,c+1): -1 on boundaries
+    int neighbors[3];
+    // false for faces with repeated vertices or non-manifold edges, whose
+    // adjacency is decided by comparing vertices instead
+    bool regular;
+  };
+  std::vector<Face> m_faces;
+};
+#endif
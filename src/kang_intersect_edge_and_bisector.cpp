@@ -10,36 +10,49 @@
 
 #include "kang_intersect_edge_and_bisector.h"
 
-int kang_intersect_edge_and_bisector(const Eigen::Vector3d & P1, const Eigen::Vector3d & P2, const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & VB, Eigen::Vector3d & P_int){
+void kang_normalized_plane(const Eigen::Vector3d & V0, const Eigen::Vector3d & V1, const Eigen::Vector3d & V2, Eigen::Vector4d & plane){
     
-    Eigen::Vector3d v1, v2, cross_product, coeff_abc;
-    double a1, b1, c1, d1, a2, b2, c2, d2, a_plus, b_plus, c_plus, d_plus, a_minus, b_minus, c_minus, d_minus, a_bisec, b_bisec, c_bisec, d_bisec, r1, r2, x0, y0, z0, x1, y1, z1, t;
+    Eigen::Vector3d v1, v2, cross_product;
+    double a, b, c, d, r;
     
-    // calculate coefficients of the plane that contain the first triangle of VB
-    v1 = VB.row(2)-VB.row(0);
-    v2 = VB.row(1)-VB.row(0);
+    // calculate coefficients of the plane that contains the triangle
+    v1 = V2-V0;
+    v2 = V1-V0;
     cross_product = v1.cross(v2);
-    a1 = cross_product(0);
-    b1 = cross_product(1);
-    c1 = cross_product(2);
-    d1 = -cross_product.dot(VB.row(2));
+    a = cross_product(0);
+    b = cross_product(1);
+    c = cross_product(2);
+    d = -cross_product.dot(V2);
     
-    // calculate coefficients of the plane that contain the second triangle of VB
-    v1 = VB.row(5)-VB.row(3);
-    v2 = VB.row(4)-VB.row(3);
-    cross_product = v1.cross(v2);
-    a2 = cross_product(0);
-    b2 = cross_product(1);
-    c2 = cross_product(2);
-    d2 = -cross_product.dot(VB.row(5));
+    // normalize
+    r = sqrt(pow(a,2) + pow(b,2) + pow(c,2));
+    plane(0) = a/r;
+    plane(1) = b/r;
+    plane(2) = c/r;
+    plane(3) = d/r;
+    
+}
+
+int kang_intersect_edge_and_bisector(const Eigen::Vector3d & P1, const Eigen::Vector3d & P2, const Eigen::Matrix<double,6,3,Eigen::RowMajor> & VB, Eigen::Vector3d & P_int){
+    
+    // planes that contain the two triangles of VB
+    Eigen::Vector4d plane1, plane2;
+    kang_normalized_plane(VB.row(0).transpose(), VB.row(1).transpose(), VB.row(2).transpose(), plane1);
+    kang_normalized_plane(VB.row(3).transpose(), VB.row(4).transpose(), VB.row(5).transpose(), plane2);
+    return kang_intersect_edge_and_bisector(P1, P2, plane1, plane2, P_int);
+    
+}
+
+int kang_intersect_edge_and_bisector(const Eigen::Vector3d & P1, const Eigen::Vector3d & P2, const Eigen::Vector4d & plane1, const Eigen::Vector4d & plane2, Eigen::Vector3d & P_int){
+    
+    Eigen::Vector3d coeff_abc;
+    double a_plus, b_plus, c_plus, d_plus, a_bisec, b_bisec, c_bisec, d_bisec, x0, y0, z0, x1, y1, z1, t;
     
     // equations for the bisector:
-    r1 = sqrt(pow(a1,2) + pow(b1,2) + pow(c1,2));
-    r2 = sqrt(pow(a2,2) + pow(b2,2) + pow(c2,2));
-    a_plus = a1/r1-a2/r2;
-    b_plus = b1/r1-b2/r2;
-    c_plus = c1/r1-c2/r2;
-    d_plus = d1/r1-d2/r2;
+    a_plus = plane1(0)-plane2(0);
+    b_plus = plane1(1)-plane2(1);
+    c_plus = plane1(2)-plane2(2);
+    d_plus = plane1(3)-plane2(3);
     
     // Test if the bisector separates the two points
     coeff_abc(0) = a_plus;
@@ -17,4 +17,11 @@
 
 using namespace std;
 
-int kang_intersect_edge_and_bisector(const Eigen::Vector3d & P1, const Eigen::Vector3d & P2, const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & VB, Eigen::Vector3d & P_int);
+int kang_intersect_edge_and_bisector(const Eigen::Vector3d & P1, const Eigen::Vector3d & P2, const Eigen::Matrix<double,6,3,Eigen::RowMajor> & VB, Eigen::Vector3d & P_int);
+
+// Same as above with the normalized planes of the two triangles given (see kang_normalized_plane), e.g. precomputed once per mesh
+// plane1, plane2: coefficients (a,b,c,d) of the planes ax+by+cz+d = 0 with unit (a,b,c)
+int kang_intersect_edge_and_bisector(const Eigen::Vector3d & P1, const Eigen::Vector3d & P2, const Eigen::Vector4d & plane1, const Eigen::Vector4d & plane2, Eigen::Vector3d & P_int);
+
+// Given the three vertices of a triangle, this function calculates the coefficients (a,b,c,d) of its supporting plane ax+by+cz+d = 0, with normal (V2-V0)x(V1-V0) scaled to unit length
+void kang_normalized_plane(const Eigen::Vector3d & V0, const Eigen::Vector3d & V1, const Eigen::Vector3d & V2, Eigen::Vector4d & plane);
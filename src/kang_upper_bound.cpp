@@ -12,271 +12,270 @@
 // u: #faces(A) x 1 Eigen vector containing the upper bound for the Pompeiu-Hausdorff distance from each triangle on mesh A to mesh B
 
 #include "kang_upper_bound.h"
-#include <igl/point_simplex_squared_distance.h>
 
 
-int kang_upper_bound(const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & VA, const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> & FA, const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & VB, const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> & FB, const Eigen::VectorXd & DV, const Eigen::VectorXi & I, Eigen::VectorXd & u){
+int kang_upper_bound(const Eigen::Matrix<double,3,3,Eigen::RowMajor> & V, const Eigen::Vector3d & D, const Eigen::Vector3i & T_proj, const KangFaceData & faces_B, double & u){
     
-    // Variables that are going to be used in the loop
+    // Variables used below (fixed size, so that no memory is allocated)
     
     // Indices of triangles from mesh B to which vertices from mesh A are projected
-    Eigen::VectorXi T_idx(3), T_idx_unique(2);
+    Eigen::Vector3i T_idx;
     int T1, T2, T;
     
-    // Vertices from mesh B (used to define planes supporting triangles from mesh B, from which bisectors are going to be calculated)
-    Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> VB_2(6,3);
+    // Planes supporting triangles from mesh B, from which bisectors are going to be calculated
+    Eigen::Vector4d plane1, plane2;
     
     // Edge-bisector intesrections
-    Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> P_int(2,3);
+    Eigen::Matrix<double,2,3,Eigen::RowMajor> P_int;
     Eigen::Vector3d P_int_edge;
     
     // Barycenter and midpoints
-    Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> B(1,3), m1(1,3), m2(1,3);
+    Eigen::RowVector3d B, m1, m2;
     
     // Point-triangle squared distances
     double Query2_sqrD, Query3_sqrD;
 
     // Partial upper bounds (max of them will be the upper bound)
-    Eigen::VectorXd ha_partial(3);
+    Eigen::Vector3d ha_partial;
     double ha, hb, hc;
     
     // Vertices from mesh A
     Eigen::Vector3d P1, P2;
     
-    // Auxiliary variables to determine if vertices from a triangle from mesh A are projected to 2 adjacent triangles on mesh B
-    Eigen::VectorXi adj_vertices(9);
-    int num_adj_vertices, i1, i2, i, j;
+    // Whether vertices from a triangle from mesh A are projected to 2 adjacent triangles on mesh B
+    bool adjacent;
+    int i, j;
     
-    // loop over all triangles from mesh A
-    for (int k=0; k<FA.rows();k++){
+    
+    // // if the three vertices project to the same triangle, return the exact Pompeiu-Hausdorff distance from the triangle to mesh B (Section 5.3.a of the paper)
+    // if (T_proj(0) == T_proj(1) && T_proj(1) == T_proj(2)){
+    //     u = max(max(D(0), D(1)), D(2));
+    // }
+    // else {
+        
+        // Check (in the precomputed adjacency of mesh B) if the vertices from mesh A were projected to exactly two triangles with 4 unique vertices
+        adjacent = false;
+        if (T_proj(0)==T_proj(1) && T_proj(1)!=T_proj(2)){
+            adjacent = faces_B.edge_adjacent(T_proj(0),T_proj(2));
+        } else if (T_proj(0)==T_proj(2) && T_proj(0)!=T_proj(1)){
+            adjacent = faces_B.edge_adjacent(T_proj(0),T_proj(1));
+        } else if (T_proj(1)==T_proj(2) && T_proj(0)!=T_proj(1)){
+            adjacent = faces_B.edge_adjacent(T_proj(0),T_proj(1));
+        }
         
-        // // if the three vertices project to the same triangle, return the exact Pompeiu-Hausdorff distance from the triangle to mesh B (Section 5.3.a of the paper)
-        // if (I(FA(k,0)) == I(FA(k,1)) && I(FA(k,1)) == I(FA(k,2))){
-        //     u(k) = max(max(DV(FA(k,0)), DV(FA(k,1))), DV(FA(k,2)));
-        // }
-        // else {
+        // if the triangles have 4 unique vertices, then they consist of two adjacent triangles (section 5.3.b of the paper)
+        if (adjacent){
             
-            // Count how many common vertices the triangles from mesh B to which the vertices from mesh A were projected have
-            adj_vertices.segment(0,3) = FB.row(I(FA(k,0)));
-            adj_vertices.segment(3,3) = FB.row(I(FA(k,1)));
-            adj_vertices.segment(6,3) = FB.row(I(FA(k,2)));
-            num_adj_vertices = 9;
-            for (i1=8; i1>=0; i1--){
-                for (i2=i1-1; i2>=0; i2--){
-                    if (adj_vertices(i2)==adj_vertices(i1)){
-                        num_adj_vertices--;
-                        break;
-                    }
+            // collect indices of the triangles
+            T_idx(0) = T_proj(0); T_idx(1) = T_proj(1); T_idx(2) = T_proj(2);
+
+            // if T_idx(0)==T_idx(1), then T_idx(0) and T_idx(2) are the 2 tirangles
+            if (T_idx(0)==T_idx(1)){
+                
+                // indices of the triangles
+                T1 = T_idx(0);
+                T2 = T_idx(2);
+                
+                // Select the two vertices from mesh A (to form an edge) and two triangles from B (their bisector will be intersected with the edge)
+                P1 = V.row(2);
+                P2 = V.row(0);
+                plane1 = faces_B.plane(T_idx(2));
+                plane2 = faces_B.plane(T_idx(0));
+                
+                // Bisector-edge intersection
+                if (!kang_intersect_edge_and_bisector(P1, P2, plane1, plane2, P_int_edge)){
+                    cout << "Error in edge bisector intersection" << endl;
+                    return 0;
                 }
-            }
-            
-            // if the triangles have 4 unique vertices, then they consist of two adjacent triangles (section 5.3.b of the paper)
-            if (num_adj_vertices==4 && ( I(FA(k,0))==I(FA(k,1)) || I(FA(k,1))==I(FA(k,2)) || I(FA(k,0))==I(FA(k,2)) )){
+                P_int(0,0) = P_int_edge(0);
+                P_int(0,1) = P_int_edge(1);
+                P_int(0,2) = P_int_edge(2);
                 
-                // collect indices of the triangles
-                T_idx(0) = I(FA(k,0)); T_idx(1) = I(FA(k,1)); T_idx(2) = I(FA(k,2));
-
-                // if T_idx(0)==T_idx(1), then T_idx(0) and T_idx(2) are the 2 tirangles
-                if (T_idx(0)==T_idx(1)){
-                    
-                    // indices of the triangles
-                    T1 = T_idx(0);
-                    T2 = T_idx(2);
-                    
-                    // Select the two vertices from mesh A (to form an edge) and two triangles from B (their bisector will be intersected with the edge)
-                    P1 = VA.row(FA(k,2));
-                    P2 = VA.row(FA(k,0));
-                    VB_2.row(0) = VB.row(FB(T_idx(2),0));
-                    VB_2.row(1) = VB.row(FB(T_idx(2),1));
-                    VB_2.row(2) = VB.row(FB(T_idx(2),2));
-                    VB_2.row(3) = VB.row(FB(T_idx(0),0));
-                    VB_2.row(4) = VB.row(FB(T_idx(0),1));
-                    VB_2.row(5) = VB.row(FB(T_idx(0),2));
-                    
-                    // Bisector-edge intersection
-                    if (!kang_intersect_edge_and_bisector(P1, P2, VB_2, P_int_edge)){
-                        cout << "Error in edge bisector intersection" << endl;
-                        return 0;
-                    }
-                    P_int(0,0) = P_int_edge(0);
-                    P_int(0,1) = P_int_edge(1);
-                    P_int(0,2) = P_int_edge(2);
-                    
-                    // Now select the other point to form the other edge with P1
-                    P2 = VA.row(FA(k,1));
-                    // Bisector-edge intersection
-                    if (!kang_intersect_edge_and_bisector(P1, P2, VB_2, P_int_edge)){
-                        cout << "Error in edge bisector intersection" << endl;
-                        return 0;
-                    }
-                    P_int(1,0) = P_int_edge(0);
-                    P_int(1,1) = P_int_edge(1);
-                    P_int(1,2) = P_int_edge(2);
-                    
-                // if T_idx(0)==T_idx(2), then T_idx(0) and T_idx(1) are the 2 tirangles
-                } else if (T_idx(0)==T_idx(2)){
-                    
-                    // indices of the triangles
-                    T1 = T_idx(0);
-                    T2 = T_idx(1);
-                    
-                    // Select the two vertices from mesh A (to form an edge) and two triangles from B (their bisector will be intersected with the edge)
-                    P1 = VA.row(FA(k,1));
-                    P2 = VA.row(FA(k,0));
-                    VB_2.row(0) = VB.row(FB(T_idx(1),0));
-                    VB_2.row(1) = VB.row(FB(T_idx(1),1));
-                    VB_2.row(2) = VB.row(FB(T_idx(1),2));
-                    VB_2.row(3) = VB.row(FB(T_idx(0),0));
-                    VB_2.row(4) = VB.row(FB(T_idx(0),1));
-                    VB_2.row(5) = VB.row(FB(T_idx(0),2));
-                    
-                    // Bisector-edge intersection
-                    if (!kang_intersect_edge_and_bisector(P1, P2, VB_2, P_int_edge)){
-                        cout << "Error in edge bisector intersection" << endl;
-                        return 0;
-                    }
-                    P_int(0,0) = P_int_edge(0);
-                    P_int(0,1) = P_int_edge(1);
-                    P_int(0,2) = P_int_edge(2);
-                    
-                    // Now select the other point to form the other edge with P1
-                    P2 = VA.row(FA(k,2));
-                    // Bisector-edge intersection
-                    if (!kang_intersect_edge_and_bisector(P1, P2, VB_2, P_int_edge)){
-                        cout << "Error in edge bisector intersection" << endl;
-                        return 0;
-                    }
-                    P_int(1,0) = P_int_edge(0);
-                    P_int(1,1) = P_int_edge(1);
-                    P_int(1,2) = P_int_edge(2);
-                    
-                // if T_idx(1)==T_idx(2), then T_idx(0) and T_idx(1) are the 2 tirangles
-                } else if (T_idx(1)==T_idx(2)){
-                    
-                    // indices of the triangles
-                    T1 = T_idx(0);
-                    T2 = T_idx(1);
-                    
-                    // Select the two vertices from mesh A (to form an edge) and two triangles from B (their bisector will be intersected with the edge)
-                    P1 = VA.row(FA(k,0));
-                    P2 = VA.row(FA(k,1));
-                    VB_2.row(0) = VB.row(FB(T_idx(0),0));
-                    VB_2.row(1) = VB.row(FB(T_idx(0),1));
-                    VB_2.row(2) = VB.row(FB(T_idx(0),2));
-                    VB_2.row(3) = VB.row(FB(T_idx(1),0));
-                    VB_2.row(4) = VB.row(FB(T_idx(1),1));
-                    VB_2.row(5) = VB.row(FB(T_idx(1),2));
-                    
-                    // Bisector-edge intersection
-                    if (!kang_intersect_edge_and_bisector(P1, P2, VB_2, P_int_edge)){
-                        cout << "Error in edge bisector intersection" << endl;
-                        return 0;
-                    }
-                    P_int(0,0) = P_int_edge(0);
-                    P_int(0,1) = P_int_edge(1);
-                    P_int(0,2) = P_int_edge(2);
-                    
-                    // Now select the other point to form the other edge with P1
-                    P2 = VA.row(FA(k,2));
-                    // Bisector-edge intersection
-                    if (!kang_intersect_edge_and_bisector(P1, P2, VB_2, P_int_edge)){
-                        cout << "Error in edge bisector intersection" << endl;
-                        return 0;
-                    }
-                    P_int(1,0) = P_int_edge(0);
-                    P_int(1,1) = P_int_edge(1);
-                    P_int(1,2) = P_int_edge(2);
-                    
+                // Now select the other point to form the other edge with P1
+                P2 = V.row(1);
+                // Bisector-edge intersection
+                if (!kang_intersect_edge_and_bisector(P1, P2, plane1, plane2, P_int_edge)){
+                    cout << "Error in edge bisector intersection" << endl;
+                    return 0;
                 }
+                P_int(1,0) = P_int_edge(0);
+                P_int(1,1) = P_int_edge(1);
+                P_int(1,2) = P_int_edge(2);
                 
-                // vertex distances
-                hb = max(max(DV(FA(k,0)), DV(FA(k,1))), DV(FA(k,2)));
+            // if T_idx(0)==T_idx(2), then T_idx(0) and T_idx(1) are the 2 tirangles
+            } else if (T_idx(0)==T_idx(2)){
                 
-                Eigen::RowVector3d _;
-
-                // Using the notation in the paper: distance from b_1 to r_{11}
-                igl::point_simplex_squared_distance<3>(P_int.row(0).eval(),VB,FB,T1,Query2_sqrD,_);
-                hb = max(hb,sqrt(Query2_sqrD));
-                    
-                // Using the notation in the paper: distance from b_2 to r_{21}
-                igl::point_simplex_squared_distance<3>(P_int.row(1).eval(),VB,FB,T1,Query2_sqrD,_);
-                hb = max(hb,sqrt(Query2_sqrD));
+                // indices of the triangles
+                T1 = T_idx(0);
+                T2 = T_idx(1);
                 
-                // Using the notation in the paper: distance from b_1 to r_{12}
-                igl::point_simplex_squared_distance<3>(P_int.row(0).eval(),VB,FB,T2,Query2_sqrD,_);
-                hb = max(hb,sqrt(Query2_sqrD));
+                // Select the two vertices from mesh A (to form an edge) and two triangles from B (their bisector will be intersected with the edge)
+                P1 = V.row(1);
+                P2 = V.row(0);
+                plane1 = faces_B.plane(T_idx(1));
+                plane2 = faces_B.plane(T_idx(0));
                 
-                // Using the notation in the paper: distance from b_2 to r_{22}
-                igl::point_simplex_squared_distance<3>(P_int.row(1).eval(),VB,FB,T2,Query2_sqrD,_);
+                // Bisector-edge intersection
+                if (!kang_intersect_edge_and_bisector(P1, P2, plane1, plane2, P_int_edge)){
+                    cout << "Error in edge bisector intersection" << endl;
+                    return 0;
+                }
+                P_int(0,0) = P_int_edge(0);
+                P_int(0,1) = P_int_edge(1);
+                P_int(0,2) = P_int_edge(2);
+                
+                // Now select the other point to form the other edge with P1
+                P2 = V.row(2);
+                // Bisector-edge intersection
+                if (!kang_intersect_edge_and_bisector(P1, P2, plane1, plane2, P_int_edge)){
+                    cout << "Error in edge bisector intersection" << endl;
+                    return 0;
+                }
+                P_int(1,0) = P_int_edge(0);
+                P_int(1,1) = P_int_edge(1);
+                P_int(1,2) = P_int_edge(2);
+                
+            // if T_idx(1)==T_idx(2), then T_idx(0) and T_idx(1) are the 2 tirangles
+            } else {
+                
+                // indices of the triangles
+                T1 = T_idx(0);
+                T2 = T_idx(1);
+                
+                // Select the two vertices from mesh A (to form an edge) and two triangles from B (their bisector will be intersected with the edge)
+                P1 = V.row(0);
+                P2 = V.row(1);
+                plane1 = faces_B.plane(T_idx(0));
+                plane2 = faces_B.plane(T_idx(1));
+                
+                // Bisector-edge intersection
+                if (!kang_intersect_edge_and_bisector(P1, P2, plane1, plane2, P_int_edge)){
+                    cout << "Error in edge bisector intersection" << endl;
+                    return 0;
+                }
+                P_int(0,0) = P_int_edge(0);
+                P_int(0,1) = P_int_edge(1);
+                P_int(0,2) = P_int_edge(2);
+                
+                // Now select the other point to form the other edge with P1
+                P2 = V.row(2);
+                // Bisector-edge intersection
+                if (!kang_intersect_edge_and_bisector(P1, P2, plane1, plane2, P_int_edge)){
+                    cout << "Error in edge bisector intersection" << endl;
+                    return 0;
+                }
+                P_int(1,0) = P_int_edge(0);
+                P_int(1,1) = P_int_edge(1);
+                P_int(1,2) = P_int_edge(2);
                 
-                // Return upper bound
-                u(k) = max(hb,sqrt(Query2_sqrD));
-
             }
             
-            // projection points belong to three triangle or two non-adjacent triangles (section 5.3.c of the paper)
-            else {
+            // vertex distances
+            hb = max(max(D(0), D(1)), D(2));
+            
+
+            // Using the notation in the paper: distance from b_1 to r_{11}
+            Query2_sqrD = faces_B.squared_distance(P_int.row(0).eval(),T1);
+            hb = max(hb,sqrt(Query2_sqrD));
+                
+            // Using the notation in the paper: distance from b_2 to r_{21}
+            Query2_sqrD = faces_B.squared_distance(P_int.row(1).eval(),T1);
+            hb = max(hb,sqrt(Query2_sqrD));
+            
+            // Using the notation in the paper: distance from b_1 to r_{12}
+            Query2_sqrD = faces_B.squared_distance(P_int.row(0).eval(),T2);
+            hb = max(hb,sqrt(Query2_sqrD));
+            
+            // Using the notation in the paper: distance from b_2 to r_{22}
+            Query2_sqrD = faces_B.squared_distance(P_int.row(1).eval(),T2);
+            
+            // Return upper bound
+            u = max(hb,sqrt(Query2_sqrD));
+
+        }
+        
+        // projection points belong to three triangle or two non-adjacent triangles (section 5.3.c of the paper)
+        else {
+            
+            // initialize partial upper bound
+            hc = 0;
+            ha_partial(0) = 0;
+            ha_partial(1) = 0;
+            ha_partial(2) = 0;
+            ha = DBL_MAX;
+            
+            // barycenter of the triangle from mesh A
+            B = (V.row(0)+V.row(1)+V.row(2))/3;
+            
+            // loop over its vertices
+            for (i=0; i<3; i++){
+                
+                // triangle on mesh B to which this vertex from mesh a is projected
+                T = T_proj(i);
+                
+                // using the notation in equation (22) of the paper, this is the distance from p_i to r_i
+                hc = max(hc,D(i));
+                
+                // distance from c to r_{ic}
+                Query3_sqrD = faces_B.squared_distance(B.row(0).eval(),T);
                 
-                // initialize partial upper bound
-                hc = 0;
-                ha_partial(0) = 0;
-                ha_partial(1) = 0;
-                ha_partial(2) = 0;
-                ha = DBL_MAX;
+                // update upper bound
+                hc = max(hc,sqrt(Query3_sqrD));
                 
-                // barycenter of the triangle from mesh A
-                B = (VA.row(FA(k,0))+VA.row(FA(k,1))+VA.row(FA(k,2)))/3;
+                // distance from m_i to r_{ia}
+                m1 = (V.row((i)%3)+V.row((i+1)%3))/2;
+                Query3_sqrD = faces_B.squared_distance(m1.row(0).eval(),T);
                 
-                Eigen::RowVector3d _;
-                // loop over its vertices
-                for (i=0; i<3; i++){
-                    
-                    // triangle on mesh B to which this vertex from mesh a is projected
-                    T = I(FA(k,i));
-                    
-                    // using the notation in equation (22) of the paper, this is the distance from p_i to r_i
-                    hc = max(hc,DV(FA(k,i)));
-                    
-                    // distance from c to r_{ic}
-                    igl::point_simplex_squared_distance<3>(B.row(0).eval(),VB,FB,T,Query3_sqrD,_);
-                    
-                    // update upper bound
-                    hc = max(hc,sqrt(Query3_sqrD));
-                    
-                    // distance from m_i to r_{ia}
-                    m1 = (VA.row(FA(k,(i)%3))+VA.row(FA(k,(i+1)%3)))/2;
-                    igl::point_simplex_squared_distance<3>(m1.row(0).eval(),VB,FB,T,Query3_sqrD,_);
-                    
-                    // update upper bound
-                    hc = max(hc,sqrt(Query3_sqrD));
+                // update upper bound
+                hc = max(hc,sqrt(Query3_sqrD));
 
-                    // distance from m_{i+2} to r_{ib}
-                    m2 = (VA.row(FA(k,(i)%3))+VA.row(FA(k,(i+2)%3)))/2;
-                    igl::point_simplex_squared_distance<3>(m2.row(0).eval(),VB,FB,T,Query3_sqrD,_);
-                    
-                    // update upper bound
-                    hc = max(hc,sqrt(Query3_sqrD));
-                    
-                    // Comppute h_a as in equation (23) of the paper
-                    for (j=0; j<3; j++){
-                        if (j==i){
-                            ha_partial(i) = max(ha_partial(i),DV(FA(k,i)));
-                        } else {
-                            Eigen::RowVector3d P_query(VA(FA(k,j),0),VA(FA(k,j),1),VA(FA(k,j),2));
-                            igl::point_simplex_squared_distance<3>(P_query,VB,FB,T,Query3_sqrD,_);
-                            ha_partial(i) = max(ha_partial(i),sqrt(Query3_sqrD));
-                        }
+                // distance from m_{i+2} to r_{ib}
+                m2 = (V.row((i)%3)+V.row((i+2)%3))/2;
+                Query3_sqrD = faces_B.squared_distance(m2.row(0).eval(),T);
+                
+                // update upper bound
+                hc = max(hc,sqrt(Query3_sqrD));
+                
+                // Comppute h_a as in equation (23) of the paper
+                for (j=0; j<3; j++){
+                    if (j==i){
+                        ha_partial(i) = max(ha_partial(i),D(i));
+                    } else {
+                        Eigen::RowVector3d P_query(V(j,0),V(j,1),V(j,2));
+                        Query3_sqrD = faces_B.squared_distance(P_query,T);
+                        ha_partial(i) = max(ha_partial(i),sqrt(Query3_sqrD));
                     }
                 }
-                ha = ha_partial.minCoeff();
-                
-                // Equation (23) of the paper
-                u(k) = min(hc,ha);
-
             }
+            ha = ha_partial.minCoeff();
+            
+            // Equation (23) of the paper
+            u = min(hc,ha);
+
+        }
+
+    // }
 
-        // }
+    return 1;
+    
+}
 
+int kang_upper_bound(const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & VA, const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> & FA, const KangFaceData & faces_B, const Eigen::VectorXd & DV, const Eigen::VectorXi & I, Eigen::VectorXd & u){
+    
+    Eigen::Matrix<double,3,3,Eigen::RowMajor> V;
+    Eigen::Vector3d D;
+    Eigen::Vector3i T_proj;
+
+    // loop over all triangles from mesh A
+    for (int k=0; k<FA.rows();k++){
+        for (int c=0; c<3; c++){
+            V.row(c) = VA.row(FA(k,c));
+            D(c) = DV(FA(k,c));
+            T_proj(c) = I(FA(k,c));
+        }
+        if (!kang_upper_bound(V, D, T_proj, faces_B, u(k))){
+            return 0;
+        }
     }
     
     return 1;
@@ -3,8 +3,7 @@
 // Input:
 // VA: #vertices(A) x 3 Eigen matrix containing x, y z coordinates of each vertex
 // FA: #faces(A) x 3 Eigen matrix containing vertex indices of each face
-// VB: #vertices(B) x 3 Eigen matrix containing x, y z coordinates of each vertex
-// FB: #faces(B) x 3 Eigen matrix containing vertex indices of each face
+// faces_B: per-face data of mesh B (planes and adjacency, see KangFaceData), built once per mesh and shared between calls
 // DV: #vertices(A) x 1 Eigen matrix containing distances from each vertex of A to B
 // I: #vertices(A) x 1 Eigen vector containing indices of faces from B to which points from A are projected
 
@@ -18,8 +17,17 @@
 #include <Eigen/Core>
 #include <Eigen/Dense>
 #include "kang_intersect_edge_and_bisector.h"
+#include "kang_face_data.h"
 
 
 using namespace std;
 
-int kang_upper_bound(const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & VA, const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> & FA, const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & VB, const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> & FB, const Eigen::VectorXd & DV, const Eigen::VectorXi & I, Eigen::VectorXd & u);
+// Single triangle version (fixed-size, allocation free), used by the refinement loop and by the version below
+// V: 3 x 3 matrix whose rows are the vertices of the triangle from A
+// D: distances from the three vertices to mesh B
+// T_proj: indices of the faces of B to which the three vertices are projected
+// faces_B: per-face data of mesh B (planes and adjacency, computed once per mesh)
+// u: upper bound for the triangle
+int kang_upper_bound(const Eigen::Matrix<double,3,3,Eigen::RowMajor> & V, const Eigen::Vector3d & D, const Eigen::Vector3i & T_proj, const KangFaceData & faces_B, double & u);
+
+int kang_upper_bound(const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & VA, const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> & FA, const KangFaceData & faces_B, const Eigen::VectorXd & DV, const Eigen::VectorXi & I, Eigen::VectorXd & u);
@@ -0,0 +1,92 @@
+#include "mapped_file.h"
+#include <stdexcept>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string & path): m_data(nullptr), m_size(0)
+{
+#ifdef _WIN32
+    m_file = nullptr;
+    m_mapping = nullptr;
+    HANDLE file = CreateFileA(
+        path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE){
+        throw std::runtime_error("Could not open " + path);
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)){
+        CloseHandle(file);
+        throw std::runtime_error("Could not get the size of " + path);
+    }
+    m_file = file;
+    m_size = static_cast<size_t>(size.QuadPart);
+    if (m_size == 0){
+        return;
+    }
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping == NULL){
+        CloseHandle(file);
+        throw std::runtime_error("Could not map " + path);
+    }
+    m_mapping = mapping;
+    m_data = static_cast<const char *>(
+        MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (m_data == nullptr){
+        CloseHandle(mapping);
+        CloseHandle(file);
+        throw std::runtime_error("Could not map " + path);
+    }
+#else
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0){
+        throw std::runtime_error("Could not open " + path);
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0){
+        close(fd);
+        throw std::runtime_error("Could not get the size of " + path);
+    }
+    m_size = static_cast<size_t>(st.st_size);
+    if (m_size == 0){
+        close(fd);
+        return;
+    }
+    void * data = mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0);
+    // the mapping keeps its own reference to the file
+    close(fd);
+    if (data == MAP_FAILED){
+        throw std::runtime_error("Could not map " + path);
+    }
+    m_data = static_cast<const char *>(data);
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+#ifdef _WIN32
+    if (m_data){
+        UnmapViewOfFile(m_data);
+    }
+    if (m_mapping){
+        CloseHandle(static_cast<HANDLE>(m_mapping));
+    }
+    if (m_file){
+        CloseHandle(static_cast<HANDLE>(m_file));
+    }
+#else
+    if (m_data){
+        munmap(const_cast<char *>(m_data), m_size);
+    }
+#endif
+}
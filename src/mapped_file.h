@@ -0,0 +1,29 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+#include <string>
+#include <cstddef>
+
+/// Read-only memory mapping of a whole file. Pages are loaded on first access
+/// so opening is cheap regardless of the file size.
+class MappedFile
+{
+  public:
+  /// @param[in] path  path to the file to map (throws std::runtime_error if it
+  ///   cannot be opened or mapped)
+  MappedFile(const std::string & path);
+  ~MappedFile();
+  MappedFile(const MappedFile &) = delete;
+  MappedFile & operator=(const MappedFile &) = delete;
+  /// Start of the mapping
+  const char * data() const { return m_data; }
+  /// Size of the mapping in bytes
+  size_t size() const { return m_size; }
+  private:
+  const char * m_data;
+  size_t m_size;
+#ifdef _WIN32
+  void * m_file;
+  void * m_mapping;
+#endif
+};
+#endif
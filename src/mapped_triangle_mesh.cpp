@@ -0,0 +1,56 @@
+#include "mapped_triangle_mesh.h"
+#include "mesh_file_header.h"
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+MappedTriangleMesh::MappedTriangleMesh(const std::string & path): m_file(path)
+{
+    MeshFileHeader header;
+    if (!read_mesh_file_header(m_file, header)){
+        throw std::runtime_error(path + " is not a valid .phdm file");
+    }
+    m_vertices = reinterpret_cast<const double *>(m_file.data()+header.vertices_offset);
+    m_faces = reinterpret_cast<const int *>(m_file.data()+header.faces_offset);
+    m_num_vertices = header.num_vertices;
+    m_num_faces = header.num_faces;
+}
+
+Eigen::Map<const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> > MappedTriangleMesh::vertices() const
+{
+    return Eigen::Map<const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> >(m_vertices, m_num_vertices, 3);
+}
+
+Eigen::Map<const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> > MappedTriangleMesh::faces() const
+{
+    return Eigen::Map<const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> >(m_faces, m_num_faces, 3);
+}
+
+void MappedTriangleMesh::chunk(
+    const int first,
+    const int count,
+    Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & V,
+    Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> & F) const
+{
+    if (first < 0 || count < 0 || count > m_num_faces-first){
+        throw std::runtime_error("Chunk out of range of the faces of the mesh");
+    }
+    // vertices used by the chunk, sorted so that they are read in file order
+    const int * faces = m_faces+3*(size_t)first;
+    std::vector<int> used(faces, faces+3*(size_t)count);
+    std::sort(used.begin(), used.end());
+    used.erase(std::unique(used.begin(), used.end()), used.end());
+    if (!used.empty() && (used.front() < 0 || used.back() >= m_num_vertices)){
+        throw std::runtime_error("Face index out of range of the vertices of the mesh");
+    }
+    V.resize(used.size(), 3);
+    for (int v = 0; v < (int)used.size(); v++){
+        V.row(v) = Eigen::Map<const Eigen::RowVector3d>(m_vertices+3*(size_t)used[v]);
+    }
+    F.resize(count, 3);
+    for (int f = 0; f < count; f++){
+        for (int c = 0; c < 3; c++){
+            F(f,c) = std::lower_bound(used.begin(), used.end(), faces[3*(size_t)f+c])-used.begin();
+        }
+    }
+}
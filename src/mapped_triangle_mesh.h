@@ -0,0 +1,47 @@
+#ifndef MAPPED_TRIANGLE_MESH_H
+#define MAPPED_TRIANGLE_MESH_H
+#include <Eigen/Core>
+#include <string>
+#include "mapped_file.h"
+
+/// Read-only memory mapping of a raw binary mesh file (.phdm, see
+/// write_triangle_mesh_binary), to process a mesh that does not fit in
+/// memory in chunks of consecutive faces. Nothing is read when the file is
+/// opened; pages are loaded as chunks access them and belong to the page
+/// cache, which can evict them again, so the memory held by the process only
+/// grows with the chunks copied out of the file.
+class MappedTriangleMesh
+{
+  public:
+  /// @param[in] path  path to the .phdm file (throws std::runtime_error if it
+  ///   cannot be mapped or is not a valid .phdm file)
+  MappedTriangleMesh(const std::string & path);
+  MappedTriangleMesh(const MappedTriangleMesh &) = delete;
+  MappedTriangleMesh & operator=(const MappedTriangleMesh &) = delete;
+  int num_vertices() const { return m_num_vertices; }
+  int num_faces() const { return m_num_faces; }
+  /// #V by 3 view of all the vertices in the file
+  Eigen::Map<const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> > vertices() const;
+  /// #F by 3 view of all the faces in the file (indices are not checked)
+  Eigen::Map<const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> > faces() const;
+  /// Copy a range of faces and the vertices they use, renumbered in the
+  /// order of the file (throws std::runtime_error if an index is out of
+  /// range)
+  ///
+  /// @param[in] first  index of the first face of the chunk
+  /// @param[in] count  number of faces of the chunk
+  /// @param[out] V  #V by 3 list of the vertices used by the chunk
+  /// @param[out] F  count by 3 list of triangle indices into V
+  void chunk(
+    const int first,
+    const int count,
+    Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & V,
+    Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> & F) const;
+  private:
+  MappedFile m_file;
+  const double * m_vertices;
+  const int * m_faces;
+  int m_num_vertices;
+  int m_num_faces;
+};
+#endif
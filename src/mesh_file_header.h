@@ -0,0 +1,30 @@
+#ifndef MESH_FILE_HEADER_H
+#define MESH_FILE_HEADER_H
+#include <cstdint>
+class MappedFile;
+
+/// Header of a raw binary mesh file (.phdm): it is followed by the vertices
+/// (double) and the faces (int) at the given offsets, in the byte order of
+/// the host that wrote them.
+struct MeshFileHeader
+{
+  char magic[8];
+  /// 0x01020304 as written by the host (detects byte order mismatches)
+  uint32_t byte_order;
+  uint32_t reserved;
+  int64_t num_vertices;
+  int64_t num_faces;
+  int64_t vertices_offset;
+  int64_t faces_offset;
+};
+const char mesh_file_magic[8] = {'P','H','D','M','S','H','0','1'};
+
+/// Read the header of a mapped .phdm file
+///
+/// @param[in] file  mapped file
+/// @param[out] header  header of the file
+/// @return false if the file is not a .phdm file written on a host with the
+///   same byte order, or if its arrays do not fit in the file or in int
+///   indices (the face indices are not checked)
+bool read_mesh_file_header(const MappedFile & file, MeshFileHeader & header);
+#endif
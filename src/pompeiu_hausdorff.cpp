@@ -3,6 +3,7 @@
 
 
 #include <iostream>
+#include <stdexcept>
 std::tuple<
   double /* lower */,
   double /* upper_max */,
@@ -16,11 +17,19 @@ pompeiu_hausdorff(
   const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> & FB,
   const double tol,
   const double max_factor,
-  const bool normalize)
+  const bool normalize,
+  const PompeiuHausdorffOptions & options,
+  PompeiuHausdorffStats * stats)
 {
   std::cout<< "Computing Pompeiu-Hausdorff distance..." << std::endl;
-  PompeiuHausdorff ph(VA, FA, VB, FB, tol, max_factor, normalize);
+  PompeiuHausdorff ph(VA, FA, VB, FB, tol, max_factor, normalize, options);
   std::cout<< "Done." << std::endl;
+  if (ph.exit_reason==PompeiuHausdorffExit::memory_limit){
+    throw std::runtime_error("Exceeded maximum number of faces or vertices");
+  }
+  if (stats){
+    *stats = ph.stats;
+  }
   return std::make_tuple(
     ph.lower, 
     ph.upper_max, 
@@ -0,0 +1,30 @@
+#include "pompeiu_hausdorff_budget.h"
+#include <limits>
+
+const char * pompeiu_hausdorff_exit_name(const PompeiuHausdorffExit exit)
+{
+    switch (exit){
+        case PompeiuHausdorffExit::tolerance: return "tolerance";
+        case PompeiuHausdorffExit::queue_empty: return "queue_empty";
+        case PompeiuHausdorffExit::time_limit: return "time_limit";
+        case PompeiuHausdorffExit::iteration_limit: return "iteration_limit";
+        case PompeiuHausdorffExit::cancelled: return "cancelled";
+        case PompeiuHausdorffExit::stopped: return "stopped";
+        case PompeiuHausdorffExit::memory_limit: return "memory_limit";
+        case PompeiuHausdorffExit::below_threshold: return "below_threshold";
+        case PompeiuHausdorffExit::above_threshold: return "above_threshold";
+    }
+    return "unknown";
+}
+
+PompeiuHausdorffBudget::PompeiuHausdorffBudget():
+    time_limit(std::numeric_limits<double>::infinity()),
+    max_iterations(-1),
+    progress(nullptr),
+    progress_interval(0),
+    cancel(nullptr),
+    stop(nullptr),
+    checkpoint_interval(60000),
+    threshold(std::numeric_limits<double>::quiet_NaN())
+{
+}
@@ -0,0 +1,91 @@
+#ifndef POMPEIU_HAUSDORFF_BUDGET_H
+#define POMPEIU_HAUSDORFF_BUDGET_H
+#include <Eigen/Core>
+#include <atomic>
+#include <functional>
+#include <string>
+
+/// Why a refinement of PompeiuHausdorff ended. The bounds are certified in
+/// every case, only tolerance guarantees that they are within the tolerance.
+enum class PompeiuHausdorffExit
+{
+  /// upper_max-lower reached the tolerance
+  tolerance,
+  /// no triangle is left in the queue
+  queue_empty,
+  /// the time limit of the budget was reached
+  time_limit,
+  /// the iteration limit of the budget was reached
+  iteration_limit,
+  /// the cancellation flag of the budget was set
+  cancelled,
+  /// the stop function of the budget returned true
+  stopped,
+  /// one more subdivision would exceed max_factor times the size of mesh A
+  memory_limit,
+  /// the bounds tell that h(A,B) <= threshold (upper_max <= threshold)
+  below_threshold,
+  /// the bounds tell that h(A,B) > threshold (lower > threshold)
+  above_threshold
+};
+
+/// Name of an exit reason (e.g. "time_limit")
+const char * pompeiu_hausdorff_exit_name(const PompeiuHausdorffExit exit);
+
+/// Limits of one refinement of PompeiuHausdorff, for anytime use ("the best
+/// bounds you can give in 200 ms"). Refinement stops at the first limit
+/// reached, between two iterations, so a call can overrun its time limit by
+/// one iteration. The default budget has no limit.
+struct PompeiuHausdorffBudget
+{
+  PompeiuHausdorffBudget();
+  /// Wall-clock time allowed for the call, in milliseconds (infinite by
+  /// default). The initial pass of a constructor always completes.
+  double time_limit;
+  /// Maximum number of iterations of the call (-1 for no limit)
+  long max_iterations;
+  /// Optional function called with the current (lower, upper_max) when the
+  /// refinement starts (after the initial pass of a constructor), every
+  /// progress_interval milliseconds while refining and once more when it
+  /// ends
+  std::function<void(double,double)> progress;
+  /// Minimum time between two calls to progress, in milliseconds (0 calls it
+  /// after every iteration)
+  double progress_interval;
+  /// Optional flag, set from another thread to stop the refinement
+  const std::atomic<bool> * cancel;
+  /// Optional function called before every iteration with the current
+  /// (lower, upper_max); the refinement stops early (with valid but looser
+  /// bounds) when it returns true, e.g. once another computation makes the
+  /// rest of this one useless
+  std::function<bool(double,double)> stop;
+  /// Optional path of a checkpoint (see PompeiuHausdorff::save_checkpoint)
+  /// written every checkpoint_interval milliseconds while refining and once
+  /// more when the refinement ends, so that a long run can be resumed after
+  /// the process is killed
+  std::string checkpoint;
+  /// Minimum time between two checkpoints, in milliseconds
+  double checkpoint_interval;
+  /// Threshold of a pass/fail decision (NaN for none): refinement stops as
+  /// soon as the bounds tell whether h(A,B) <= threshold, and triangles
+  /// whose upper bound is below the threshold leave the queue, since they
+  /// cannot change the answer (upper_max then no longer gets below the
+  /// threshold, until a refinement without it queues them again). A
+  /// constructor first queries a sample of points of A, and answers
+  /// above_threshold without the initial pass if one of them is farther
+  /// than the threshold.
+  double threshold;
+  /// Optional #P by 3 list of points of A where the distance to B is likely
+  /// to be the largest (e.g. lower_point of a previous run on a similar mesh
+  /// or frame), queried by the constructors and next_frame before the
+  /// initial bounds so that the lower bound rejects more triangles at once.
+  /// Each point is first moved to the closest point of A, which takes a BVH
+  /// of A, so the bound stays certified for points off A.
+  Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> hint_points;
+  /// Optional #H list of faces of A (indices into FA) and #H by 3 list of
+  /// barycentric coordinates of more such locations, which are queried
+  /// without a BVH of A (coordinates are clamped to the triangle)
+  Eigen::VectorXi hint_faces;
+  Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> hint_barycentric;
+};
+#endif
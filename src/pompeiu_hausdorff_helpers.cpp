@@ -0,0 +1,60 @@
+#include "pompeiu_hausdorff_helpers.h"
+#include "PompeiuHausdorff.h"
+#include "PompeiuHausdorffTarget.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+// Number of face centroids, spread over all of A, queried to seed the lower
+// bound
+#define SEED_SAMPLES 4096
+
+double now()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+double seed_lower_bound(
+    const Eigen::Ref<const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> > & VA,
+    const Eigen::Ref<const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> > & FA,
+    const PompeiuHausdorffTarget & target,
+    PompeiuHausdorffStats & stats)
+{
+    const int stride = std::max<int>(1,FA.rows()/SEED_SAMPLES);
+    Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> P((FA.rows()+stride-1)/stride,3);
+    int n = 0;
+    for (int f=0; f<FA.rows(); f+=stride){
+        if (FA.row(f).minCoeff()>=0 && FA.row(f).maxCoeff()<VA.rows()){
+            P.row(n++) = (VA.row(FA(f,0))+VA.row(FA(f,1))+VA.row(FA(f,2)))/3;
+        }
+    }
+    P.conservativeResize(n,3);
+    if (n==0){
+        return 0;
+    }
+    Eigen::VectorXd sqrD;
+    Eigen::VectorXi I;
+    Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> C;
+    target.squared_distance(P,sqrD,I,C);
+    stats.closest_point_queries += n;
+    return std::sqrt(sqrD.maxCoeff());
+}
+
+bool restart_after_pre_pass(
+    PompeiuHausdorff & ph,
+    const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & VA,
+    const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> & FA,
+    const PompeiuHausdorffTarget & target,
+    const double tol,
+    const double max_factor,
+    const PompeiuHausdorffOptions & options,
+    const PompeiuHausdorffBudget & budget,
+    PompeiuHausdorffStats & stats)
+{
+    if (ph.initialized()){
+        return false;
+    }
+    stats += ph.stats;
+    ph = PompeiuHausdorff(VA,FA,target,tol,max_factor,false,options,budget);
+    return true;
+}
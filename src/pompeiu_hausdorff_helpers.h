@@ -0,0 +1,58 @@
+#ifndef POMPEIU_HAUSDORFF_HELPERS_H
+#define POMPEIU_HAUSDORFF_HELPERS_H
+// Helpers shared by the refinement and by the drivers that split A into
+// pieces refined one after the other or in parallel
+// (streaming_pompeiu_hausdorff and sharded_pompeiu_hausdorff).
+
+#include <Eigen/Core>
+#include "pompeiu_hausdorff_options.h"
+#include "pompeiu_hausdorff_budget.h"
+#include "pompeiu_hausdorff_stats.h"
+class PompeiuHausdorff;
+class PompeiuHausdorffTarget;
+
+/// Current time on a monotonic clock, in seconds
+double now();
+
+/// Lower bound on h(A,B) from the distances of face centroids spread over all
+/// of A, so that the first pieces of A are not refined against their own
+/// lower bound only. Faces with an index out of range are skipped.
+///
+/// @param[in] VA  #VA by 3 list of vertex positions of mesh A
+/// @param[in] FA  #FA by 3 list of triangle indices into VA
+/// @param[in] target  mesh B and its BVH
+/// @param[in,out] stats  counts the closest-point queries
+/// @return largest distance from a sampled centroid to B (0 if A is empty)
+double seed_lower_bound(
+  const Eigen::Ref<const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> > & VA,
+  const Eigen::Ref<const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> > & FA,
+  const PompeiuHausdorffTarget & target,
+  PompeiuHausdorffStats & stats);
+
+/// Start a piece of A over if the sampled pre-pass of a decision answered it
+/// before the initial pass (see PompeiuHausdorff::initialized), so that it
+/// can be refined further
+///
+/// @param[in,out] ph  refinement of the piece, replaced by a new one
+/// @param[in] VA  #VA by 3 list of vertex positions of the piece
+/// @param[in] FA  #FA by 3 list of triangle indices into VA
+/// @param[in] target  mesh B and its BVH
+/// @param[in] tol  absolute tolerance
+/// @param[in] max_factor  see PompeiuHausdorff::PompeiuHausdorff
+/// @param[in] options  see PompeiuHausdorffOptions
+/// @param[in] budget  budget of the new refinement (e.g. with a higher
+///   threshold, or none to refine the piece to the tolerance)
+/// @param[in,out] stats  gets the stats of the pre-pass added
+/// @return false (and ph is unchanged) if ph was initialized
+bool restart_after_pre_pass(
+  PompeiuHausdorff & ph,
+  const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & VA,
+  const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> & FA,
+  const PompeiuHausdorffTarget & target,
+  const double tol,
+  const double max_factor,
+  const PompeiuHausdorffOptions & options,
+  const PompeiuHausdorffBudget & budget,
+  PompeiuHausdorffStats & stats);
+
+#endif
@@ -0,0 +1,10 @@
+#include "pompeiu_hausdorff_options.h"
+
+PompeiuHausdorffOptions::PompeiuHausdorffOptions():
+    batch_size(1),
+    recycle(false),
+    wide_bvh(false),
+    lazy(false),
+    adaptive_cascade(false)
+{
+}
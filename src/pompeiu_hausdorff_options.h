@@ -0,0 +1,40 @@
+#ifndef POMPEIU_HAUSDORFF_OPTIONS_H
+#define POMPEIU_HAUSDORFF_OPTIONS_H
+
+/// Options of the refinement of PompeiuHausdorff, shared by all the entry
+/// points (the constructors, pompeiu_hausdorff, the symmetric, streaming and
+/// sharded drivers and PompeiuHausdorffTarget::distance_from). The default
+/// options reproduce the sequential refinement.
+struct PompeiuHausdorffOptions
+{
+  PompeiuHausdorffOptions();
+  /// Number of triangles popped from the queue and refined (in parallel) per
+  /// iteration. Results only depend on batch_size, not on the number of
+  /// threads. 1 reproduces the sequential refinement.
+  int batch_size;
+  /// Reuse the rows of VA_aug/FA_aug (and of their companions) that belong
+  /// to triangles that left the queue, so that memory is bounded by the
+  /// largest queue instead of growing with every subdivision. The bounds are
+  /// the same; VA_aug/FA_aug then only hold the triangles in the queue, and
+  /// number_of_vertices/number_of_faces count rows in use (live or free).
+  bool recycle;
+  /// Query mesh B with a 4-wide SAH BVH and vectorized point-triangle
+  /// distances instead of libigl's AABB tree (same distances up to
+  /// rounding). Ignored by the entry points given a prebuilt target, which
+  /// chooses its BVH.
+  bool wide_bvh;
+  /// Queue new triangles with the cheap bounds (u0-u2) only and evaluate
+  /// Kang's bound and u4 when a triangle reaches the top of the queue, where
+  /// it is refined if its tightened bound is still the largest and requeued
+  /// otherwise. Triangles that are never popped skip the expensive bounds.
+  /// The bounds are certified, but the refinement order (and so the final
+  /// bounds) differs.
+  bool lazy;
+  /// Measure the success rate and cost of Kang's bound and u4 on a sample of
+  /// the refined triangles and try the one that costs less per rejected
+  /// triangle first, skipping the other while it rejects almost nothing on
+  /// its own. The bounds are certified but depend on timings, so they are
+  /// not reproducible; false keeps the fixed order Kang's bound, u4.
+  bool adaptive_cascade;
+};
+#endif
@@ -0,0 +1,60 @@
+#include "pompeiu_hausdorff_stats.h"
+#include <algorithm>
+#include <ostream>
+
+PompeiuHausdorffStats::PompeiuHausdorffStats():
+    iterations(0),
+    closest_point_queries(0),
+    time_bvh(0),
+    time_queries(0),
+    time_bounds(0),
+    time_queue(0),
+    time_allocation(0),
+    max_depth(0),
+    peak_queue_size(0),
+    peak_allocated_bytes(0)
+{
+    for (int b = 0;b<5;b++){
+        bound_attempts[b] = 0;
+        bound_successes[b] = 0;
+    }
+}
+
+PompeiuHausdorffStats & PompeiuHausdorffStats::operator+=(const PompeiuHausdorffStats & other)
+{
+    iterations += other.iterations;
+    closest_point_queries += other.closest_point_queries;
+    for (int b = 0;b<5;b++){
+        bound_attempts[b] += other.bound_attempts[b];
+        bound_successes[b] += other.bound_successes[b];
+    }
+    time_bvh += other.time_bvh;
+    time_queries += other.time_queries;
+    time_bounds += other.time_bounds;
+    time_queue += other.time_queue;
+    time_allocation += other.time_allocation;
+    max_depth = std::max(max_depth,other.max_depth);
+    peak_queue_size += other.peak_queue_size;
+    peak_allocated_bytes += other.peak_allocated_bytes;
+    return *this;
+}
+
+std::ostream & operator<<(std::ostream & os, const PompeiuHausdorffStats & stats)
+{
+    const char * const names[5] = {"u0","u1","u2","kang","u4"};
+    os << "iterations=" << stats.iterations << std::endl;
+    os << "closest_point_queries=" << stats.closest_point_queries << std::endl;
+    for (int b = 0;b<5;b++){
+        os << names[b] << "_attempts=" << stats.bound_attempts[b] << std::endl;
+        os << names[b] << "_successes=" << stats.bound_successes[b] << std::endl;
+    }
+    os << "bvh_build_time(ms)=" << stats.time_bvh << std::endl;
+    os << "query_time(ms)=" << stats.time_queries << std::endl;
+    os << "upper_bound_time(ms)=" << stats.time_bounds << std::endl;
+    os << "queue_time(ms)=" << stats.time_queue << std::endl;
+    os << "allocation_time(ms)=" << stats.time_allocation << std::endl;
+    os << "max_depth=" << stats.max_depth << std::endl;
+    os << "peak_queue_size=" << stats.peak_queue_size << std::endl;
+    os << "peak_allocated_bytes=" << stats.peak_allocated_bytes << std::endl;
+    return os;
+}
@@ -0,0 +1,47 @@
+#ifndef POMPEIU_HAUSDORFF_STATS_H
+#define POMPEIU_HAUSDORFF_STATS_H
+#include <cstddef>
+#include <iosfwd>
+
+/// Counters and per-stage timings of one run of PompeiuHausdorff, to tell
+/// where a slow run spends its time. Times are in milliseconds, measured on a
+/// monotonic clock.
+struct PompeiuHausdorffStats
+{
+  PompeiuHausdorffStats();
+  /// Number of refinement iterations
+  long iterations;
+  /// Number of closest-point queries on B (vertices of A and new edge
+  /// midpoints)
+  long closest_point_queries;
+  /// Per bound (u0, u1, u2, Kang's bound, u4), number of faces it was
+  /// evaluated on and number of faces it rejected
+  long bound_attempts[5];
+  long bound_successes[5];
+  /// Time spent building the BVH of B
+  double time_bvh;
+  /// Time spent in closest-point queries
+  double time_queries;
+  /// Time spent evaluating upper bounds (including subdividing the popped
+  /// triangles)
+  double time_bounds;
+  /// Time spent pushing, popping and pruning queue entries
+  double time_queue;
+  /// Time spent allocating and growing the augmented mesh
+  double time_allocation;
+  /// Largest number of subdivisions that produced a triangle of the refined
+  /// mesh
+  int max_depth;
+  /// Largest number of queued triangles
+  size_t peak_queue_size;
+  /// Largest memory held by the augmented mesh, the queue, the free lists and
+  /// the midpoint cache, in bytes
+  size_t peak_allocated_bytes;
+  /// Add the counters, times and peaks of another run (max_depth takes the
+  /// larger of the two)
+  PompeiuHausdorffStats & operator+=(const PompeiuHausdorffStats & other);
+};
+
+/// Print the stats as one name=value pair per line
+std::ostream & operator<<(std::ostream & os, const PompeiuHausdorffStats & stats);
+#endif
@@ -0,0 +1,573 @@
+// Given a path to a triangle mesh, this function loads its vertices and faces directly into row-major matrices. The file is memory mapped and parsed by several threads:
+// - .obj (v and f lines; polygons are fan triangulated, negative indices are supported)
+// - .ply (binary little or big endian)
+// - .stl (binary; every triangle gets its own three vertices)
+// - .phdm (raw binary mesh written by write_triangle_mesh_binary)
+// Other formats and variants (e.g. ascii .ply or .stl) fall back to igl::read_triangle_mesh.
+
+// Input:
+// path: path to the mesh file
+
+// Output:
+// V: #V x 3 Eigen matrix containing x, y z coordinates of each vertex
+// F: #F x 3 Eigen matrix containing vertex indices of each face
+// returns false if the file could not be read
+
+#include "read_triangle_mesh_fast.h"
+#include "mapped_file.h"
+#include "mesh_file_header.h"
+#include <igl/parallel_for.h>
+#include <igl/read_triangle_mesh.h>
+#include <algorithm>
+#include <cctype>
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <vector>
+
+namespace
+{
+    // Bytes of input handled by one parsing task (independent of the number of
+    // threads, so chunking is deterministic)
+    const size_t chunk_size = 1<<20;
+
+    std::string lower_extension(const std::string & path)
+    {
+        const size_t dot = path.find_last_of('.');
+        std::string ext = dot == std::string::npos ? "" : path.substr(dot+1);
+        std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+        return ext;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    // OBJ
+    ////////////////////////////////////////////////////////////////////////////
+
+    inline bool is_blank(const char c)
+    {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+    inline const char * skip_blanks(const char * p, const char * end)
+    {
+        while (p < end && is_blank(*p)) p++;
+        return p;
+    }
+
+    inline const char * end_of_line(const char * p, const char * end)
+    {
+        const char * q = static_cast<const char *>(std::memchr(p, '\n', end-p));
+        return q ? q : end;
+    }
+
+    // Parse a floating point token (the mapping is not null terminated, so
+    // copy the token before calling strtod)
+    inline const char * parse_double(const char * p, const char * end, double & x, bool & ok)
+    {
+        p = skip_blanks(p, end);
+        char buffer[64];
+        int n = 0;
+        while (p < end && !is_blank(*p) && *p != '\n' && n < 63){
+            buffer[n++] = *p++;
+        }
+        buffer[n] = '\0';
+        char * parsed;
+        x = std::strtod(buffer, &parsed);
+        ok = ok && n > 0 && parsed == buffer+n;
+        return p;
+    }
+
+    // Parse the vertex index of a face token ("i", "i/t", "i//n", "i/t/n")
+    // and skip the rest of the token
+    inline const char * parse_face_index(const char * p, const char * end, long long & index, bool & ok)
+    {
+        bool negative = false;
+        if (p < end && (*p == '-' || *p == '+')){
+            negative = *p == '-';
+            p++;
+        }
+        const char * digits = p;
+        index = 0;
+        while (p < end && *p >= '0' && *p <= '9'){
+            index = 10*index + (*p-'0');
+            p++;
+        }
+        ok = ok && p > digits;
+        if (negative) index = -index;
+        while (p < end && !is_blank(*p) && *p != '\n') p++;
+        return p;
+    }
+
+    // Line type: 1 for vertices, 2 for faces, 0 otherwise
+    inline int line_type(const char * p, const char * line_end)
+    {
+        if (line_end-p >= 2 && is_blank(p[1])){
+            if (p[0] == 'v') return 1;
+            if (p[0] == 'f') return 2;
+        }
+        return 0;
+    }
+
+    // Number of vertex tokens on a face line starting after "f"
+    inline int count_tokens(const char * p, const char * line_end)
+    {
+        int n = 0;
+        while (true){
+            p = skip_blanks(p, line_end);
+            if (p >= line_end) return n;
+            n++;
+            while (p < line_end && !is_blank(*p)) p++;
+        }
+    }
+
+    bool read_obj(
+        const MappedFile & file,
+        Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & V,
+        Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> & F)
+    {
+        const char * begin = file.data();
+        const char * end = begin + file.size();
+
+        // Split at line boundaries
+        std::vector<const char *> chunks(1, begin);
+        while (chunks.back() < end){
+            const char * next = chunks.back() + std::min(chunk_size, size_t(end-chunks.back()));
+            if (next < end){
+                next = end_of_line(next, end);
+                if (next < end) next++;
+            }
+            chunks.push_back(next);
+        }
+        const int num_chunks = chunks.size()-1;
+
+        // First pass: count vertices and triangles of every chunk
+        std::vector<long long> chunk_vertices(num_chunks+1, 0), chunk_faces(num_chunks+1, 0);
+        igl::parallel_for(num_chunks, [&](const int c)
+        {
+            long long nv = 0, nf = 0;
+            for (const char * p = chunks[c]; p < chunks[c+1]; ){
+                p = skip_blanks(p, chunks[c+1]);
+                const char * line_end = end_of_line(p, chunks[c+1]);
+                switch (line_type(p, line_end)){
+                    case 1: nv++; break;
+                    case 2: nf += std::max(count_tokens(p+1, line_end)-2, 0); break;
+                }
+                p = line_end < chunks[c+1] ? line_end+1 : chunks[c+1];
+            }
+            chunk_vertices[c+1] = nv;
+            chunk_faces[c+1] = nf;
+        }, 2);
+        for (int c = 0; c < num_chunks; c++){
+            chunk_vertices[c+1] += chunk_vertices[c];
+            chunk_faces[c+1] += chunk_faces[c];
+        }
+        const long long num_vertices = chunk_vertices[num_chunks];
+        if (num_vertices > INT_MAX || chunk_faces[num_chunks] > INT_MAX){
+            return false;
+        }
+        V.resize(num_vertices, 3);
+        F.resize(chunk_faces[num_chunks], 3);
+
+        // Second pass: parse directly into V and F
+        std::vector<char> chunk_ok(num_chunks, 1);
+        igl::parallel_for(num_chunks, [&](const int c)
+        {
+            bool ok = true;
+            long long v = chunk_vertices[c];
+            long long f = chunk_faces[c];
+            std::vector<long long> polygon;
+            for (const char * p = chunks[c]; p < chunks[c+1] && ok; ){
+                p = skip_blanks(p, chunks[c+1]);
+                const char * line_end = end_of_line(p, chunks[c+1]);
+                switch (line_type(p, line_end)){
+                    case 1:
+                    {
+                        const char * q = p+1;
+                        for (int d = 0; d < 3; d++){
+                            q = parse_double(q, line_end, V(v,d), ok);
+                        }
+                        v++;
+                        break;
+                    }
+                    case 2:
+                    {
+                        polygon.clear();
+                        const char * q = skip_blanks(p+1, line_end);
+                        while (q < line_end){
+                            long long index;
+                            q = skip_blanks(parse_face_index(q, line_end, index, ok), line_end);
+                            // 1-based, or relative to the vertices read so far (0 is neither)
+                            ok = ok && index != 0;
+                            index = index > 0 ? index-1 : v+index;
+                            ok = ok && index >= 0 && index < num_vertices;
+                            polygon.push_back(index);
+                        }
+                        for (size_t k = 1; k+1 < polygon.size(); k++){
+                            F(f,0) = polygon[0];
+                            F(f,1) = polygon[k];
+                            F(f,2) = polygon[k+1];
+                            f++;
+                        }
+                        break;
+                    }
+                }
+                p = line_end < chunks[c+1] ? line_end+1 : chunks[c+1];
+            }
+            chunk_ok[c] = ok;
+        }, 2);
+        return std::find(chunk_ok.begin(), chunk_ok.end(), 0) == chunk_ok.end();
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    // PLY
+    ////////////////////////////////////////////////////////////////////////////
+
+    enum PlyType
+    {
+        PLY_INVALID, PLY_INT8, PLY_UINT8, PLY_INT16, PLY_UINT16, PLY_INT32,
+        PLY_UINT32, PLY_FLOAT32, PLY_FLOAT64
+    };
+
+    PlyType ply_type(const std::string & type)
+    {
+        if (type == "char" || type == "int8") return PLY_INT8;
+        if (type == "uchar" || type == "uint8") return PLY_UINT8;
+        if (type == "short" || type == "int16") return PLY_INT16;
+        if (type == "ushort" || type == "uint16") return PLY_UINT16;
+        if (type == "int" || type == "int32") return PLY_INT32;
+        if (type == "uint" || type == "uint32") return PLY_UINT32;
+        if (type == "float" || type == "float32") return PLY_FLOAT32;
+        if (type == "double" || type == "float64") return PLY_FLOAT64;
+        return PLY_INVALID;
+    }
+
+    int ply_type_size(const PlyType type)
+    {
+        switch (type){
+            case PLY_INT8: case PLY_UINT8: return 1;
+            case PLY_INT16: case PLY_UINT16: return 2;
+            case PLY_INT32: case PLY_UINT32: case PLY_FLOAT32: return 4;
+            case PLY_FLOAT64: return 8;
+            default: return 0;
+        }
+    }
+
+    struct PlyProperty
+    {
+        std::string name;
+        // scalar type (or type of the list entries)
+        PlyType type;
+        // type of the list count (PLY_INVALID for scalar properties)
+        PlyType count_type;
+    };
+
+    struct PlyElement
+    {
+        std::string name;
+        long long count;
+        std::vector<PlyProperty> properties;
+    };
+
+    // Read a value of the given PLY type at p
+    inline double ply_read(const char * p, const PlyType type, const bool swap)
+    {
+        unsigned char bytes[8];
+        const int size = ply_type_size(type);
+        for (int b = 0; b < size; b++){
+            bytes[b] = p[swap ? size-1-b : b];
+        }
+        switch (type){
+            case PLY_INT8: { int8_t x; std::memcpy(&x, bytes, 1); return x; }
+            case PLY_UINT8: { uint8_t x; std::memcpy(&x, bytes, 1); return x; }
+            case PLY_INT16: { int16_t x; std::memcpy(&x, bytes, 2); return x; }
+            case PLY_UINT16: { uint16_t x; std::memcpy(&x, bytes, 2); return x; }
+            case PLY_INT32: { int32_t x; std::memcpy(&x, bytes, 4); return x; }
+            case PLY_UINT32: { uint32_t x; std::memcpy(&x, bytes, 4); return x; }
+            case PLY_FLOAT32: { float x; std::memcpy(&x, bytes, 4); return x; }
+            default: { double x; std::memcpy(&x, bytes, 8); return x; }
+        }
+    }
+
+    // Returns -1 if the file is a PLY variant this reader does not handle
+    // (the caller falls back to libigl), 0 on errors and 1 on success
+    int read_ply(
+        const MappedFile & file,
+        Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & V,
+        Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> & F)
+    {
+        const char * begin = file.data();
+        const char * end = begin + file.size();
+        const char * marker = "end_header";
+        const char * header_end = std::search(begin, end, marker, marker+std::strlen(marker));
+        if (header_end == end){
+            return 0;
+        }
+        const char * body = end_of_line(header_end, end)+1;
+        if (body > end){
+            return 0;
+        }
+
+        // Parse the header
+        std::istringstream header(std::string(begin, header_end));
+        std::string line, format;
+        std::vector<PlyElement> elements;
+        while (std::getline(header, line)){
+            std::istringstream words(line);
+            std::string keyword;
+            words >> keyword;
+            if (keyword == "format"){
+                words >> format;
+            } else if (keyword == "element"){
+                PlyElement element;
+                words >> element.name >> element.count;
+                elements.push_back(element);
+            } else if (keyword == "property" && !elements.empty()){
+                PlyProperty property;
+                std::string type, count_type;
+                words >> type;
+                if (type == "list"){
+                    words >> count_type >> type;
+                }
+                words >> property.name;
+                property.type = ply_type(type);
+                property.count_type = count_type.empty() ? PLY_INVALID : ply_type(count_type);
+                if (property.type == PLY_INVALID ||
+                    (!count_type.empty() && property.count_type == PLY_INVALID)){
+                    return 0;
+                }
+                elements.back().properties.push_back(property);
+            }
+        }
+        if (format != "binary_little_endian" && format != "binary_big_endian"){
+            return -1;
+        }
+        const uint32_t one = 1;
+        const bool little_endian_host = *reinterpret_cast<const char *>(&one) == 1;
+        const bool swap = (format == "binary_little_endian") != little_endian_host;
+
+        const char * p = body;
+        bool read_vertices = false, read_faces = false;
+        for (size_t e = 0; e < elements.size() && !(read_vertices && read_faces); e++){
+            const PlyElement & element = elements[e];
+            // byte offsets of the scalar properties (-1 once a list is found)
+            long long stride = 0;
+            int x = -1, y = -1, z = -1;
+            std::vector<long long> offsets;
+            for (size_t k = 0; k < element.properties.size(); k++){
+                const PlyProperty & property = element.properties[k];
+                offsets.push_back(stride);
+                if (property.count_type != PLY_INVALID){
+                    stride = -1;
+                    break;
+                }
+                if (property.name == "x") x = k;
+                if (property.name == "y") y = k;
+                if (property.name == "z") z = k;
+                stride += ply_type_size(property.type);
+            }
+
+            if (element.name == "vertex"){
+                if (stride < 0 || x < 0 || y < 0 || z < 0 || element.count > INT_MAX ||
+                    element.count*stride > end-p){
+                    return stride < 0 ? -1 : 0;
+                }
+                V.resize(element.count, 3);
+                const int xyz[3] = {x, y, z};
+                igl::parallel_for((int)element.count, [&](const int v)
+                {
+                    for (int d = 0; d < 3; d++){
+                        V(v,d) = ply_read(
+                            p+v*stride+offsets[xyz[d]], element.properties[xyz[d]].type, swap);
+                    }
+                }, 10000);
+                p += element.count*stride;
+                read_vertices = true;
+            } else if (element.name == "face"){
+                // only the vertex index list is supported
+                if (element.properties.size() != 1 || element.properties[0].count_type == PLY_INVALID){
+                    return -1;
+                }
+                const PlyType count_type = element.properties[0].count_type;
+                const PlyType index_type = element.properties[0].type;
+                const int count_size = ply_type_size(count_type);
+                const int index_size = ply_type_size(index_type);
+                if (element.count > INT_MAX){
+                    return 0;
+                }
+
+                // Triangles only: fixed stride, decoded in parallel
+                const long long triangle_stride = count_size+3*index_size;
+                bool all_triangles = element.count*triangle_stride <= end-p;
+                if (all_triangles){
+                    std::vector<char> is_triangle(element.count);
+                    igl::parallel_for((int)element.count, [&](const int f)
+                    {
+                        is_triangle[f] = ply_read(p+f*triangle_stride, count_type, swap) == 3;
+                    }, 10000);
+                    all_triangles = std::find(is_triangle.begin(), is_triangle.end(), 0) == is_triangle.end();
+                }
+                if (all_triangles){
+                    F.resize(element.count, 3);
+                    igl::parallel_for((int)element.count, [&](const int f)
+                    {
+                        for (int d = 0; d < 3; d++){
+                            F(f,d) = ply_read(
+                                p+f*triangle_stride+count_size+d*index_size, index_type, swap);
+                        }
+                    }, 10000);
+                } else {
+                    // Polygons: sequential fan triangulation
+                    std::vector<int> triangles;
+                    const char * q = p;
+                    for (long long f = 0; f < element.count; f++){
+                        if (end-q < count_size) return 0;
+                        const long long n = ply_read(q, count_type, swap);
+                        q += count_size;
+                        if (n < 0 || end-q < n*index_size) return 0;
+                        for (long long k = 1; k+1 < n; k++){
+                            triangles.push_back(ply_read(q, index_type, swap));
+                            triangles.push_back(ply_read(q+k*index_size, index_type, swap));
+                            triangles.push_back(ply_read(q+(k+1)*index_size, index_type, swap));
+                        }
+                        q += n*index_size;
+                    }
+                    F = Eigen::Map<const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> >(
+                        triangles.data(), triangles.size()/3, 3);
+                }
+                read_faces = true;
+                // later elements are ignored
+            } else {
+                // skip other elements with fixed size records
+                if (stride < 0){
+                    return -1;
+                }
+                p += element.count*stride;
+            }
+        }
+        if (!read_vertices || !read_faces){
+            return 0;
+        }
+        return (F.size() == 0 || (F.minCoeff() >= 0 && F.maxCoeff() < V.rows())) ? 1 : 0;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    // STL
+    ////////////////////////////////////////////////////////////////////////////
+
+    // Returns -1 for ascii STL (the caller falls back to libigl)
+    int read_stl(
+        const MappedFile & file,
+        Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & V,
+        Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> & F)
+    {
+        // 80 byte header, number of triangles, then 50 bytes per triangle
+        if (file.size() < 84){
+            return -1;
+        }
+        uint32_t num_faces;
+        std::memcpy(&num_faces, file.data()+80, 4);
+        if (file.size() != 84+50*size_t(num_faces) || 3*size_t(num_faces) > INT_MAX){
+            return -1;
+        }
+        V.resize(3*num_faces, 3);
+        F.resize(num_faces, 3);
+        igl::parallel_for((int)num_faces, [&](const int f)
+        {
+            // skip the normal
+            const char * p = file.data()+84+50*size_t(f)+12;
+            for (int c = 0; c < 3; c++){
+                float x[3];
+                std::memcpy(x, p+12*c, 12);
+                V.row(3*f+c) << x[0], x[1], x[2];
+                F(f,c) = 3*f+c;
+            }
+        }, 10000);
+        return 1;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Raw binary mesh
+    ////////////////////////////////////////////////////////////////////////////
+
+    bool read_phdm(
+        const MappedFile & file,
+        Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & V,
+        Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> & F)
+    {
+        MeshFileHeader header;
+        if (!read_mesh_file_header(file, header)){
+            return false;
+        }
+        V = Eigen::Map<const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> >(
+            reinterpret_cast<const double *>(file.data()+header.vertices_offset), header.num_vertices, 3);
+        F = Eigen::Map<const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> >(
+            reinterpret_cast<const int *>(file.data()+header.faces_offset), header.num_faces, 3);
+        return F.size() == 0 || (F.minCoeff() >= 0 && F.maxCoeff() < V.rows());
+    }
+}
+
+bool read_mesh_file_header(const MappedFile & file, MeshFileHeader & header)
+{
+    if (file.size() < sizeof(header)){
+        return false;
+    }
+    std::memcpy(&header, file.data(), sizeof(header));
+    const int64_t size = file.size();
+    return std::memcmp(header.magic, mesh_file_magic, sizeof(header.magic)) == 0 &&
+        header.byte_order == 0x01020304 &&
+        header.num_vertices >= 0 && header.num_faces >= 0 &&
+        header.num_vertices <= INT_MAX && header.num_faces <= INT_MAX &&
+        header.vertices_offset >= (int64_t)sizeof(header) && header.faces_offset >= (int64_t)sizeof(header) &&
+        header.vertices_offset+header.num_vertices*3*(int64_t)sizeof(double) <= size &&
+        header.faces_offset+header.num_faces*3*(int64_t)sizeof(int) <= size;
+}
+
+bool read_triangle_mesh_fast(const std::string & path, Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & V, Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> & F)
+{
+    const std::string ext = lower_extension(path);
+    if (ext != "obj" && ext != "ply" && ext != "stl" && ext != "phdm"){
+        return igl::read_triangle_mesh(path, V, F);
+    }
+    std::unique_ptr<MappedFile> file;
+    try {
+        file.reset(new MappedFile(path));
+    } catch (const std::exception &){
+        return false;
+    }
+    int result = 0;
+    if (ext == "obj"){
+        result = read_obj(*file, V, F);
+    } else if (ext == "ply"){
+        result = read_ply(*file, V, F);
+    } else if (ext == "stl"){
+        result = read_stl(*file, V, F);
+    } else {
+        result = read_phdm(*file, V, F);
+    }
+    if (result < 0){
+        file.reset();
+        return igl::read_triangle_mesh(path, V, F);
+    }
+    return result == 1;
+}
+
+bool write_triangle_mesh_binary(const std::string & path, const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & V, const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> & F)
+{
+    MeshFileHeader header;
+    std::memcpy(header.magic, mesh_file_magic, sizeof(header.magic));
+    header.byte_order = 0x01020304;
+    header.reserved = 0;
+    header.num_vertices = V.rows();
+    header.num_faces = F.rows();
+    header.vertices_offset = sizeof(header);
+    header.faces_offset = header.vertices_offset+header.num_vertices*3*sizeof(double);
+    std::ofstream out(path.c_str(), std::ios::binary);
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(V.data()), header.num_vertices*3*sizeof(double));
+    out.write(reinterpret_cast<const char *>(F.data()), header.num_faces*3*sizeof(int));
+    return bool(out);
+}
@@ -0,0 +1,31 @@
+// Given a path to a triangle mesh, this function loads its vertices and faces directly into row-major matrices. The file is memory mapped and parsed by several threads:
+// - .obj (v and f lines; polygons are fan triangulated, negative indices are supported)
+// - .ply (binary little or big endian)
+// - .stl (binary; every triangle gets its own three vertices)
+// - .phdm (raw binary mesh written by write_triangle_mesh_binary)
+// Other formats and variants (e.g. ascii .ply or .stl) fall back to igl::read_triangle_mesh.
+
+// Input:
+// path: path to the mesh file
+
+// Output:
+// V: #V x 3 Eigen matrix containing x, y z coordinates of each vertex
+// F: #F x 3 Eigen matrix containing vertex indices of each face
+// returns false if the file could not be read
+
+#include <Eigen/Core>
+#include <string>
+
+bool read_triangle_mesh_fast(const std::string & path, Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & V, Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> & F);
+
+// Given a triangle mesh, this function writes it to the raw binary .phdm format (a small header followed by the vertex and face arrays) that read_triangle_mesh_fast loads with a memory copy.
+
+// Input:
+// path: path to the .phdm file
+// V: #V x 3 Eigen matrix containing x, y z coordinates of each vertex
+// F: #F x 3 Eigen matrix containing vertex indices of each face
+
+// Output:
+// returns false if the file could not be written
+
+bool write_triangle_mesh_binary(const std::string & path, const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & V, const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> & F);
@@ -0,0 +1,116 @@
+#include "refinement_queue.h"
+#include <algorithm>
+
+// Queues smaller than this are never pruned or shrunk
+#define REFINEMENT_QUEUE_MIN_PRUNE_SIZE 4096
+
+RefinementQueue::RefinementQueue(): m_prune_size(REFINEMENT_QUEUE_MIN_PRUNE_SIZE)
+{
+}
+
+void RefinementQueue::push(const value_type & entry)
+{
+    m_heap.push_back(entry);
+    sift_up(m_heap.size()-1);
+}
+
+void RefinementQueue::pop()
+{
+    m_heap.front() = m_heap.back();
+    m_heap.pop_back();
+    if (!m_heap.empty()){
+        sift_down(0);
+    }
+}
+
+size_t RefinementQueue::prune(
+    const double lower,
+    const std::function<void(int)> & removed)
+{
+    const std::vector<value_type>::iterator kept_end = std::partition(
+        m_heap.begin(),m_heap.end(),
+        [lower](const value_type & entry){ return !(entry.first < lower); });
+    const size_t number_removed = m_heap.end()-kept_end;
+    if (removed){
+        for (std::vector<value_type>::iterator it = kept_end;it != m_heap.end();it++){
+            removed(it->second);
+        }
+    }
+    m_heap.erase(kept_end,m_heap.end());
+    if (number_removed > 0){
+        // Floyd's heap construction (sift down every parent, last first)
+        for (size_t i = m_heap.size() > 1 ? (m_heap.size()-2)/4+1 : 0; i-- > 0;){
+            sift_down(i);
+        }
+        if (m_heap.capacity() > REFINEMENT_QUEUE_MIN_PRUNE_SIZE &&
+            m_heap.capacity() > 2*m_heap.size()){
+            std::vector<value_type>(m_heap).swap(m_heap);
+        }
+    }
+    m_prune_size = std::max<size_t>(2*m_heap.size(),REFINEMENT_QUEUE_MIN_PRUNE_SIZE);
+    return number_removed;
+}
+
+void RefinementQueue::lazy_prune(
+    const double lower,
+    const std::function<void(int)> & removed)
+{
+    if (m_heap.size() >= m_prune_size){
+        prune(lower,removed);
+    }
+}
+
+bool RefinementQueue::assign(std::vector<value_type> heap, const size_t prune_size)
+{
+    if (prune_size < REFINEMENT_QUEUE_MIN_PRUNE_SIZE){
+        return false;
+    }
+    for (size_t i = 1;i<heap.size();i++){
+        if (heap[(i-1)/4] < heap[i]){
+            return false;
+        }
+    }
+    m_heap.swap(heap);
+    m_prune_size = prune_size;
+    return true;
+}
+
+void RefinementQueue::sift_up(size_t i)
+{
+    const value_type entry = m_heap[i];
+    while (i > 0){
+        const size_t parent = (i-1)/4;
+        if (!(m_heap[parent] < entry)){
+            break;
+        }
+        m_heap[i] = m_heap[parent];
+        i = parent;
+    }
+    m_heap[i] = entry;
+}
+
+void RefinementQueue::sift_down(size_t i)
+{
+    const size_t n = m_heap.size();
+    const value_type entry = m_heap[i];
+    while (true){
+        const size_t first = 4*i+1;
+        if (first >= n){
+            break;
+        }
+        // largest of the (up to four) children
+        const size_t last = std::min(first+4,n);
+        size_t largest = first;
+        for (size_t c = first+1;c<last;c++){
+            if (m_heap[largest] < m_heap[c]){
+                largest = c;
+            }
+        }
+        if (!(entry < m_heap[largest])){
+            break;
+        }
+        m_heap[i] = m_heap[largest];
+        i = largest;
+    }
+    m_heap[i] = entry;
+}
@@ -0,0 +1,67 @@
+#ifndef REFINEMENT_QUEUE_H
+#define REFINEMENT_QUEUE_H
+#include <vector>
+#include <utility>
+#include <cstddef>
+#include <functional>
+
+/// Max-queue of (upper bound, face) pairs driving the refinement, stored as
+/// an implicit 4-ary heap (children of node i are 4i+1,…,4i+4, so a sift-down
+/// reads one or two cache lines per level and the tree is half as deep as a
+/// binary heap). Pairs are ordered like std::priority_queue<std::pair<double,
+/// int> >, so faces are popped in exactly the same order.
+///
+/// Entries whose upper bound falls below the global lower bound can never
+/// contain the maximizer; prune() discards them and releases the memory they
+/// held.
+class RefinementQueue
+{
+  public:
+  typedef std::pair<double,int> value_type;
+  RefinementQueue();
+  bool empty() const { return m_heap.empty(); }
+  size_t size() const { return m_heap.size(); }
+  /// Number of entries the queue can hold without reallocating
+  size_t capacity() const { return m_heap.capacity(); }
+  /// Entry with the largest upper bound (queue must not be empty)
+  const value_type & top() const { return m_heap.front(); }
+  void push(const value_type & entry);
+  void emplace(const double upper, const int f) { push(value_type(upper,f)); }
+  void pop();
+  /// Remove all entries with upper bound < lower, rebuild the heap in linear
+  /// time and shrink its memory if less than half of it is used
+  ///
+  /// @param[in] lower  global lower bound
+  /// @param[in] removed  optional function called with the face of every
+  ///   removed entry
+  /// @return number of entries removed
+  size_t prune(
+    const double lower,
+    const std::function<void(int)> & removed = nullptr);
+  /// Call prune() only once the queue has doubled in size since the last
+  /// pruning, so that pruning costs amortized O(1) per pushed entry
+  ///
+  /// @param[in] lower  global lower bound
+  /// @param[in] removed  see prune()
+  void lazy_prune(
+    const double lower,
+    const std::function<void(int)> & removed = nullptr);
+  /// i-th entry in heap order (e.g. to save the queue)
+  const value_type & operator[](const size_t i) const { return m_heap[i]; }
+  /// Size at which lazy_prune() prunes next
+  size_t prune_size() const { return m_prune_size; }
+  /// Replace the entries by ones read in heap order with operator[] and
+  /// restore the size at which lazy_prune() prunes next
+  ///
+  /// @param[in] heap  entries in heap order
+  /// @param[in] prune_size  see prune_size()
+  /// @return false (and the queue is unchanged) if the entries are not in
+  ///   heap order or prune_size is below the size at which queues are pruned
+  bool assign(std::vector<value_type> heap, const size_t prune_size);
+  private:
+  void sift_up(size_t i);
+  void sift_down(size_t i);
+  std::vector<value_type> m_heap;
+  size_t m_prune_size;
+};
+#endif
@@ -0,0 +1,399 @@
+#include "sharded_pompeiu_hausdorff.h"
+#include "PompeiuHausdorff.h"
+#include "PompeiuHausdorffTarget.h"
+#include "pompeiu_hausdorff_helpers.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+// Shards per worker process when the number of shards is not given
+#define SHARDS_PER_PROCESS 4
+// Number of times a shard is refined again after its worker crashed
+#define SHARD_RETRIES 2
+// Time between two checks of the workers by the parent, in microseconds
+#define SHARD_POLL_INTERVAL 10000
+
+namespace
+{
+#ifndef _WIN32
+    // State of a shard: pending, done, failed, or the pid of the worker
+    // refining it
+    const int shard_pending = 0;
+    const int shard_done = -1;
+    const int shard_failed = -2;
+
+    // Shard in shared memory, written by the worker that refines it
+    struct ShardSlot
+    {
+        std::atomic<int> state;
+        int attempts;
+        double lower;
+        double upper_max;
+        PompeiuHausdorffStats stats;
+        char error[256];
+    };
+
+    // Memory shared by the parent and the workers: this header followed by
+    // the slots of the shards
+    struct SharedState
+    {
+        std::atomic<double> lower;
+        std::atomic<bool> cancel;
+    };
+
+    // Anonymous shared mapping, unmapped when the computation ends
+    class SharedMapping
+    {
+      public:
+        SharedMapping(const size_t size): m_size(size)
+        {
+            m_data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+            if (m_data == MAP_FAILED){
+                throw std::runtime_error("Could not map shared memory for the workers");
+            }
+        }
+        ~SharedMapping() { munmap(m_data, m_size); }
+        SharedMapping(const SharedMapping &) = delete;
+        SharedMapping & operator=(const SharedMapping &) = delete;
+        void * data() const { return m_data; }
+      private:
+        void * m_data;
+        size_t m_size;
+    };
+
+    // Raise an atomic maximum
+    void raise(std::atomic<double> & maximum, const double value)
+    {
+        double current = maximum.load();
+        while (value > current && !maximum.compare_exchange_weak(current, value)){
+        }
+    }
+
+    // Interleave the low 21 bits of x with two zero bits
+    uint64_t spread_bits(uint64_t x)
+    {
+        x &= 0x1fffff;
+        x = (x | x << 32) & 0x1f00000000ffffULL;
+        x = (x | x << 16) & 0x1f0000ff0000ffULL;
+        x = (x | x << 8) & 0x100f00f00f00f00fULL;
+        x = (x | x << 4) & 0x10c30c30c30c30c3ULL;
+        x = (x | x << 2) & 0x1249249249249249ULL;
+        return x;
+    }
+
+    // Faces of A in the Morton order of their centroids
+    std::vector<int> morton_order(
+        const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & VA,
+        const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> & FA)
+    {
+        Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> centroids(FA.rows(),3);
+        for (int f=0; f<FA.rows(); f++){
+            centroids.row(f) = (VA.row(FA(f,0))+VA.row(FA(f,1))+VA.row(FA(f,2)))/3;
+        }
+        std::vector<std::pair<uint64_t,int> > keys(FA.rows());
+        if (FA.rows()>0){
+            const Eigen::RowVector3d corner = centroids.colwise().minCoeff();
+            const Eigen::RowVector3d extent = centroids.colwise().maxCoeff()-corner;
+            const double scale = extent.maxCoeff()>0 ? ((1<<21)-1)/extent.maxCoeff() : 0;
+            for (int f=0; f<FA.rows(); f++){
+                uint64_t key = 0;
+                for (int d=0; d<3; d++){
+                    key |= spread_bits(uint64_t((centroids(f,d)-corner(d))*scale)) << d;
+                }
+                keys[f] = std::make_pair(key,f);
+            }
+        }
+        std::sort(keys.begin(),keys.end());
+        std::vector<int> order(FA.rows());
+        for (int f=0; f<FA.rows(); f++){
+            order[f] = keys[f].second;
+        }
+        return order;
+    }
+
+    // Faces of a shard and the vertices they use, renumbered in the order of
+    // VA
+    void shard_mesh(
+        const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & VA,
+        const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> & FA,
+        const int * faces,
+        const int count,
+        Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & V,
+        Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> & F)
+    {
+        std::vector<int> used;
+        used.reserve(3*(size_t)count);
+        for (int f=0; f<count; f++){
+            for (int c=0; c<3; c++){
+                used.push_back(FA(faces[f],c));
+            }
+        }
+        std::sort(used.begin(),used.end());
+        used.erase(std::unique(used.begin(),used.end()),used.end());
+        V.resize(used.size(),3);
+        for (int v=0; v<(int)used.size(); v++){
+            V.row(v) = VA.row(used[v]);
+        }
+        F.resize(count,3);
+        for (int f=0; f<count; f++){
+            for (int c=0; c<3; c++){
+                F(f,c) = std::lower_bound(used.begin(),used.end(),FA(faces[f],c))-used.begin();
+            }
+        }
+    }
+
+    // Refine one shard in a worker, as a decision against the shared lower
+    // bound that is restarted whenever the shared bound rises, until the
+    // upper bound of the shard is within the tolerance of it
+    void refine_shard(
+        const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & VA,
+        const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> & FA,
+        const PompeiuHausdorffTarget & target,
+        const double tol,
+        const double max_factor,
+        const PompeiuHausdorffOptions & options,
+        SharedState & shared,
+        ShardSlot & slot)
+    {
+        PompeiuHausdorffBudget budget;
+        budget.cancel = &shared.cancel;
+        const auto set_threshold = [&]()
+        {
+            const double lower = shared.lower.load();
+            budget.threshold = lower>0 ? lower : std::numeric_limits<double>::quiet_NaN();
+        };
+        bool settled = false;
+        budget.stop = [&](const double lower, const double upper_max)
+        {
+            raise(shared.lower,lower);
+            const double shared_lower = shared.lower.load();
+            if (upper_max-shared_lower<=tol){
+                settled = true;
+                return true;
+            }
+            return shared_lower>budget.threshold;
+        };
+        PompeiuHausdorffStats stats;
+        set_threshold();
+        PompeiuHausdorff ph(VA,FA,target,tol,max_factor,false,options,budget);
+        while (true){
+            raise(shared.lower,ph.lower);
+            if (ph.exit_reason==PompeiuHausdorffExit::memory_limit){
+                throw std::runtime_error("Exceeded maximum number of faces or vertices");
+            }
+            if (ph.exit_reason==PompeiuHausdorffExit::above_threshold ||
+                (ph.exit_reason==PompeiuHausdorffExit::stopped && !settled)){
+                set_threshold();
+                if (!restart_after_pre_pass(ph,VA,FA,target,tol,max_factor,options,budget,stats)){
+                    ph.refine(budget);
+                }
+            } else {
+                break;
+            }
+        }
+        stats += ph.stats;
+        slot.lower = ph.lower;
+        slot.upper_max = ph.upper_max;
+        slot.stats = stats;
+        slot.state.store(ph.exit_reason==PompeiuHausdorffExit::cancelled ? shard_pending : shard_done);
+    }
+
+    // Worker process: take pending shards until there is none left (never
+    // returns)
+    void run_worker(
+        const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & VA,
+        const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> & FA,
+        const PompeiuHausdorffTarget & target,
+        const std::vector<int> & order,
+        const int num_shards,
+        const double tol,
+        const double max_factor,
+        const PompeiuHausdorffOptions & options,
+        SharedState & shared,
+        ShardSlot * slots)
+    {
+        const int pid = getpid();
+        Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> VA_shard;
+        Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> FA_shard;
+        for (int s=0; s<num_shards && !shared.cancel.load(); s++){
+            int pending = shard_pending;
+            if (!slots[s].state.compare_exchange_strong(pending,pid)){
+                continue;
+            }
+            try {
+                const int first = (int64_t)FA.rows()*s/num_shards;
+                const int last = (int64_t)FA.rows()*(s+1)/num_shards;
+                shard_mesh(VA,FA,order.data()+first,last-first,VA_shard,FA_shard);
+                refine_shard(VA_shard,FA_shard,target,tol,max_factor,options,shared,slots[s]);
+            } catch (const std::exception & e){
+                std::strncpy(slots[s].error,e.what(),sizeof(slots[s].error)-1);
+                slots[s].state.store(shard_failed);
+                shared.cancel.store(true);
+            }
+        }
+        std::cout.flush();
+        _exit(0);
+    }
+#endif
+}
+
+std::tuple<
+    double /* lower */,
+    double /* upper */,
+    double /* dA */,
+    double /* time_taken_bvh */,
+    double /* time_taken_bounds */>
+sharded_pompeiu_hausdorff(
+    const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & VA,
+    const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> & FA,
+    const PompeiuHausdorffTarget & target,
+    const int processes,
+    const int shards,
+    const double tol,
+    const double max_factor,
+    const bool normalize,
+    const PompeiuHausdorffOptions & options,
+    PompeiuHausdorffStats * stats)
+{
+#ifdef _WIN32
+    throw std::runtime_error("Sharded computation needs fork, which is not available on this platform");
+#else
+    const double t_start = now();
+    const int num_processes = processes>0 ? processes : std::max(1u,std::thread::hardware_concurrency());
+    const int num_shards = std::min<int>(FA.rows(),shards>0 ? shards : SHARDS_PER_PROCESS*num_processes);
+    // Every shard uses the same absolute tolerance
+    const double dA = normalize && VA.rows()>0 ?
+        (VA.colwise().maxCoeff()-VA.colwise().minCoeff()).norm() : 1.0;
+    const std::vector<int> order = morton_order(VA,FA);
+
+    SharedMapping mapping(sizeof(SharedState)+num_shards*sizeof(ShardSlot));
+    SharedState & shared = *new (mapping.data()) SharedState();
+    ShardSlot * slots = reinterpret_cast<ShardSlot *>(static_cast<char *>(mapping.data())+sizeof(SharedState));
+    if (!shared.lower.is_lock_free()){
+        throw std::runtime_error("Atomic doubles are not lock-free on this platform, so they cannot be shared between processes");
+    }
+    shared.lower.store(0);
+    shared.cancel.store(false);
+    for (int s=0; s<num_shards; s++){
+        new (&slots[s]) ShardSlot();
+        slots[s].state.store(shard_pending);
+        slots[s].attempts = 0;
+        slots[s].error[0] = '\0';
+    }
+
+    std::cout<< "Computing Pompeiu-Hausdorff distance..." << std::endl;
+    // Seed the shared lower bound with points spread over all of A, so that
+    // the first shards are not refined against their own lower bound only
+    PompeiuHausdorffStats total;
+    shared.lower.store(seed_lower_bound(VA,FA,target,total));
+
+    // Fork the workers, and replace those that crash while shards are left
+    std::vector<pid_t> workers;
+    const auto fork_worker = [&]()
+    {
+        std::cout.flush();
+        const pid_t pid = fork();
+        if (pid==0){
+            run_worker(VA,FA,target,order,num_shards,tol*dA,max_factor,options,shared,slots);
+        }
+        if (pid>0){
+            workers.push_back(pid);
+        }
+        return pid>0;
+    };
+    const auto shards_pending = [&]()
+    {
+        for (int s=0; s<num_shards; s++){
+            if (slots[s].state.load()==shard_pending){
+                return true;
+            }
+        }
+        return false;
+    };
+    for (int p=0; p<std::min(num_processes,num_shards); p++){
+        if (!fork_worker() && workers.empty()){
+            throw std::runtime_error("Could not fork the worker processes");
+        }
+    }
+    while (!workers.empty()){
+        bool reaped = false;
+        for (size_t w=0; w<workers.size(); w++){
+            int status;
+            const pid_t result = waitpid(workers[w],&status,WNOHANG);
+            if (result==0 || (result<0 && errno!=ECHILD)){
+                continue;
+            }
+            reaped = true;
+            const pid_t pid = workers[w];
+            workers.erase(workers.begin()+w--);
+            // a shard still held by the worker was not finished (the worker
+            // crashed): it is refined again by a new worker
+            for (int s=0; s<num_shards; s++){
+                int running = pid;
+                if (slots[s].state.load()!=pid){
+                    continue;
+                }
+                if (++slots[s].attempts>SHARD_RETRIES){
+                    std::snprintf(slots[s].error,sizeof(slots[s].error),"The worker of shard %d crashed %d times",s,slots[s].attempts);
+                    slots[s].state.compare_exchange_strong(running,shard_failed);
+                    shared.cancel.store(true);
+                } else {
+                    slots[s].state.compare_exchange_strong(running,shard_pending);
+                }
+            }
+        }
+        while (!shared.cancel.load() && (int)workers.size()<num_processes && shards_pending()){
+            if (!fork_worker()){
+                break;
+            }
+        }
+        if (workers.empty() && !shared.cancel.load() && shards_pending()){
+            throw std::runtime_error("Could not fork the worker processes");
+        }
+        if (!reaped){
+            usleep(SHARD_POLL_INTERVAL);
+        }
+    }
+    std::cout<< "Done." << std::endl;
+
+    // Reduce the bounds of the shards
+    double upper_max = 0;
+    for (int s=0; s<num_shards; s++){
+        if (slots[s].state.load()==shard_failed){
+            throw std::runtime_error(slots[s].error);
+        }
+    }
+    for (int s=0; s<num_shards; s++){
+        if (slots[s].state.load()!=shard_done){
+            throw std::runtime_error("A shard was not refined");
+        }
+        upper_max = std::max(upper_max,slots[s].upper_max);
+        total += slots[s].stats;
+    }
+    if (stats){
+        *stats = total;
+    }
+    return std::make_tuple(shared.lower.load(), upper_max, dA, 0.0, 1000*(now()-t_start));
+#endif
+}
@@ -0,0 +1,60 @@
+#include <Eigen/Core>
+#include <tuple>
+#include "pompeiu_hausdorff_stats.h"
+#include "pompeiu_hausdorff_options.h"
+class PompeiuHausdorffTarget;
+
+/// Compute lower and upper bounds on the Pompeiu-Hausdorff distance from a
+/// mesh A to a target mesh B with several worker processes on one host
+/// (Linux and other POSIX systems; throws std::runtime_error elsewhere).
+///
+/// The faces of A are split into spatially coherent shards (consecutive
+/// runs in the Morton order of their centroids), and forked workers take
+/// shards one after the other and refine them against the target, which
+/// they share read-only with the parent (copy-on-write pages of the fork).
+/// The best lower bound of all workers lives in shared memory: each worker
+/// publishes its own and refines its shard as a decision against the
+/// shared one, restarted whenever another worker raises it, so that its
+/// triangles closer to B leave the queue and it stops as soon as its upper
+/// bound is within the tolerance of the shared lower bound. The parent
+/// reduces the bounds of the shards, which are certified and within the
+/// tolerance of each other, but depend on the timing of the workers.
+///
+/// A worker that crashes (e.g. killed by the out-of-memory killer) is
+/// replaced and its shard is refined again, up to twice per shard. An
+/// exception in a worker cancels the others and is rethrown by the parent.
+/// Each worker runs libigl's parallel loops with the number of threads of
+/// the parent, so IGL_NUM_THREADS should be set to the number of cores
+/// divided by the number of processes.
+///
+/// @param[in] VA  #VA by 3 list of vertex positions of mesh A
+/// @param[in] FA  #FA by 3 list of triangle indices into VA
+/// @param[in] target  mesh B and its BVH
+/// @param[in] processes  number of worker processes (0 for the number of cores)
+/// @param[in] shards  number of shards of A (0 for 4 per process); more shards balance the load better, fewer share more of the refinement
+/// @param[in] tol  tolerance value for the difference between upper and lower bounds
+/// @param[in] max_factor  factor to define the maximum allowed number of faces and vertices in the subdivided shard with respect to the number of faces and vertices of the shard
+/// @param[in] normalize  0 (false) or 1 (true) to normalize tolerance by the length of the diagonal of A's bounding box
+/// @param[in] options  options of the refinement of each shard (see PompeiuHausdorffOptions; batch_size triangles are refined in parallel by each worker, wide_bvh is ignored since the target chooses its BVH)
+/// @param[out] stats  optional counters and per-stage timings of all the shards added together
+///
+/// The returned time_taken_bvh is 0 since the tree is reused, and
+/// time_taken_bounds is the wall-clock time of the whole computation.
+
+std::tuple<
+  double /* lower */,
+  double /* upper */,
+  double /* dA */,
+  double /* time_taken_bvh */,
+  double /* time_taken_bounds */>
+sharded_pompeiu_hausdorff(
+  const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & VA,
+  const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> & FA,
+  const PompeiuHausdorffTarget & target,
+  const int processes = 0,
+  const int shards = 0,
+  const double tol = 1e-8,
+  const double max_factor = 1000000,
+  const bool normalize = true,
+  const PompeiuHausdorffOptions & options = PompeiuHausdorffOptions(),
+  PompeiuHausdorffStats * stats = nullptr);
@@ -0,0 +1,80 @@
+#include "streaming_pompeiu_hausdorff.h"
+#include "PompeiuHausdorff.h"
+#include "PompeiuHausdorffTarget.h"
+#include "mapped_triangle_mesh.h"
+#include "pompeiu_hausdorff_helpers.h"
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+std::tuple<
+    double /* lower */,
+    double /* upper */,
+    double /* dA */,
+    double /* time_taken_bvh */,
+    double /* time_taken_bounds */>
+streaming_pompeiu_hausdorff(
+    const std::string & path_A,
+    const PompeiuHausdorffTarget & target,
+    const int chunk_faces,
+    const double tol,
+    const double max_factor,
+    const bool normalize,
+    const PompeiuHausdorffOptions & options,
+    PompeiuHausdorffStats * stats)
+{
+    if (chunk_faces<1){
+        throw std::runtime_error("chunk_faces must be positive");
+    }
+    const double t_start = now();
+    const MappedTriangleMesh A(path_A);
+    const Eigen::Map<const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> > VA = A.vertices();
+    const Eigen::Map<const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> > FA = A.faces();
+    // Every chunk uses the same absolute tolerance
+    const double dA = normalize && VA.rows()>0 ?
+        (VA.colwise().maxCoeff()-VA.colwise().minCoeff()).norm() : 1.0;
+
+    std::cout<< "Computing Pompeiu-Hausdorff distance..." << std::endl;
+    // Seed the lower bound with points spread over all of A (faces are only
+    // checked chunk by chunk, so the seeding skips invalid ones)
+    PompeiuHausdorffStats total;
+    double lower = seed_lower_bound(VA,FA,target,total);
+    double upper_max = 0;
+
+    Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> VA_chunk;
+    Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> FA_chunk;
+    size_t peak_queue_size = 0;
+    size_t peak_allocated_bytes = 0;
+    for (int first=0; first<A.num_faces(); first+=chunk_faces){
+        A.chunk(first,std::min(chunk_faces,A.num_faces()-first),VA_chunk,FA_chunk);
+        // Triangles closer to B than the best lower bound so far cannot raise
+        // the distance: refine the chunk as a decision against that bound, and
+        // to the tolerance only if it is farther than it
+        PompeiuHausdorffBudget budget;
+        if (lower>0){
+            budget.threshold = lower;
+        }
+        PompeiuHausdorff ph(VA_chunk,FA_chunk,target,tol*dA,max_factor,false,options,budget);
+        if (ph.exit_reason==PompeiuHausdorffExit::above_threshold &&
+            !restart_after_pre_pass(ph,VA_chunk,FA_chunk,target,tol*dA,max_factor,options,PompeiuHausdorffBudget(),total)){
+            ph.refine();
+        }
+        if (ph.exit_reason==PompeiuHausdorffExit::memory_limit){
+            throw std::runtime_error("Exceeded maximum number of faces or vertices");
+        }
+        lower = std::max(lower,ph.lower);
+        upper_max = std::max(upper_max,ph.upper_max);
+        peak_queue_size = std::max(peak_queue_size,ph.stats.peak_queue_size);
+        peak_allocated_bytes = std::max(peak_allocated_bytes,ph.stats.peak_allocated_bytes);
+        total += ph.stats;
+    }
+    std::cout<< "Done." << std::endl;
+    // chunks run one after the other, so peaks are those of the largest one
+    total.peak_queue_size = peak_queue_size;
+    total.peak_allocated_bytes = peak_allocated_bytes;
+    if (stats){
+        *stats = total;
+    }
+    return std::make_tuple(lower, upper_max, dA, 0.0, 1000*(now()-t_start));
+}
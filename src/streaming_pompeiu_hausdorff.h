@@ -0,0 +1,52 @@
+#include <Eigen/Core>
+#include <string>
+#include <tuple>
+#include "pompeiu_hausdorff_stats.h"
+#include "pompeiu_hausdorff_options.h"
+class PompeiuHausdorffTarget;
+
+/// Compute lower and upper bounds on the Pompeiu-Hausdorff distance from a
+/// mesh A too large for the memory to a target mesh B, streaming A from a
+/// .phdm file (see write_triangle_mesh_binary) in chunks of consecutive faces.
+/// Memory is bounded by B and one chunk (with its refinement) instead of
+/// growing with A.
+///
+/// Each chunk is refined against the resident target with the best lower
+/// bound found so far as the threshold of a decision (first seeded from a
+/// sample of face centroids spread over the whole file), so that its
+/// triangles closer to B than that bound leave the queue at once and a chunk
+/// that cannot raise the distance stops as soon as its upper bound falls
+/// below it. Chunks that can are refined to the tolerance. Nothing is kept
+/// from one chunk to the next but the two bounds, which are certified and
+/// within the tolerance of each other like those of pompeiu_hausdorff (but
+/// depend on the chunk size).
+///
+/// @param[in] path_A  path to the .phdm file of mesh A (throws
+///   std::runtime_error if it is not a valid .phdm file or a face index is
+///   out of range)
+/// @param[in] target  mesh B and its BVH
+/// @param[in] chunk_faces  number of faces of A per chunk
+/// @param[in] tol  tolerance value for the difference between upper and lower bounds
+/// @param[in] max_factor  factor to define the maximum allowed number of faces and vertices in the subdivided chunk with respect to the number of faces and vertices of the chunk
+/// @param[in] normalize  0 (false) or 1 (true) to normalize tolerance by the length of the diagonal of A's bounding box (read in one pass over the vertices of the file)
+/// @param[in] options  options of the refinement of each chunk (see PompeiuHausdorffOptions; wide_bvh is ignored, the target chooses its BVH)
+/// @param[out] stats  optional counters and per-stage timings of all the chunks added together (peaks are those of the largest chunk)
+///
+/// The returned time_taken_bvh is 0 since the tree is reused, and
+/// time_taken_bounds includes reading the chunks.
+
+std::tuple<
+  double /* lower */,
+  double /* upper */,
+  double /* dA */,
+  double /* time_taken_bvh */,
+  double /* time_taken_bounds */>
+streaming_pompeiu_hausdorff(
+  const std::string & path_A,
+  const PompeiuHausdorffTarget & target,
+  const int chunk_faces = 1000000,
+  const double tol = 1e-8,
+  const double max_factor = 1000000,
+  const bool normalize = true,
+  const PompeiuHausdorffOptions & options = PompeiuHausdorffOptions(),
+  PompeiuHausdorffStats * stats = nullptr);
@@ -0,0 +1,91 @@
+#include "symmetric_pompeiu_hausdorff.h"
+#include "PompeiuHausdorff.h"
+
+#include <atomic>
+#include <thread>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+std::tuple<
+    double /* lower */,
+    double /* upper */,
+    double /* dA */,
+    double /* time_taken_bvh */,
+    double /* time_taken_bounds */>
+symmetric_pompeiu_hausdorff(
+    const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & VA,
+    const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> & FA,
+    const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & VB,
+    const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> & FB,
+    const double tol,
+    const double max_factor,
+    const bool normalize,
+    const PompeiuHausdorffOptions & options,
+    PompeiuHausdorffStats * stats)
+{
+    // Both directions use the same absolute tolerance
+    const double dA = normalize ?
+        (VA.colwise().maxCoeff()-VA.colwise().minCoeff()).norm() : 1.0;
+
+    // Current lower bound of each direction, published every iteration
+    std::atomic<double> lower_AB(0), lower_BA(0);
+
+    std::cout<< "Computing symmetric Pompeiu-Hausdorff distance..." << std::endl;
+    // B → A in a second thread
+    PompeiuHausdorff ph_BA;
+    std::exception_ptr error_BA;
+    std::thread thread_BA([&]()
+    {
+        try {
+            PompeiuHausdorffBudget budget;
+            budget.stop = [&](const double lower, const double upper_max)
+            {
+                lower_BA.store(lower);
+                return upper_max < lower_AB.load();
+            };
+            ph_BA = PompeiuHausdorff(VB, FB, VA, FA, tol*dA, max_factor, false, options, budget);
+            lower_BA.store(ph_BA.lower);
+        } catch (...){
+            error_BA = std::current_exception();
+        }
+    });
+    // A → B in this thread
+    PompeiuHausdorff ph_AB;
+    std::exception_ptr error_AB;
+    try {
+        PompeiuHausdorffBudget budget;
+        budget.stop = [&](const double lower, const double upper_max)
+        {
+            lower_AB.store(lower);
+            return upper_max < lower_BA.load();
+        };
+        ph_AB = PompeiuHausdorff(VA, FA, VB, FB, tol*dA, max_factor, false, options, budget);
+        lower_AB.store(ph_AB.lower);
+    } catch (...){
+        error_AB = std::current_exception();
+    }
+    thread_BA.join();
+    if (error_AB){
+        std::rethrow_exception(error_AB);
+    }
+    if (error_BA){
+        std::rethrow_exception(error_BA);
+    }
+    if (ph_AB.exit_reason==PompeiuHausdorffExit::memory_limit ||
+        ph_BA.exit_reason==PompeiuHausdorffExit::memory_limit){
+        throw std::runtime_error("Exceeded maximum number of faces or vertices");
+    }
+    std::cout<< "Done." << std::endl;
+    if (stats){
+        *stats = ph_AB.stats;
+        *stats += ph_BA.stats;
+    }
+
+    // Both directions ran concurrently, so report the slower of each stage
+    return std::make_tuple(
+        std::max(ph_AB.lower, ph_BA.lower),
+        std::max(ph_AB.upper_max, ph_BA.upper_max),
+        dA,
+        std::max(ph_AB.time_taken_bvh, ph_BA.time_taken_bvh),
+        std::max(ph_AB.time_taken_bounds, ph_BA.time_taken_bounds));
+}
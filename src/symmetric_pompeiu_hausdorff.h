@@ -0,0 +1,37 @@
+#include <Eigen/Core>
+#include <tuple>
+#include "pompeiu_hausdorff_stats.h"
+#include "pompeiu_hausdorff_options.h"
+
+/// Compute lower and upper bounds on the symmetric Pompeiu-Hausdorff distance
+/// max(h(A,B),h(B,A)) between two meshes A and B. Both directions are refined
+/// concurrently (including the construction of their AABB trees) and a
+/// direction stops as soon as its upper bound falls below the lower bound of
+/// the other one, since it can no longer change the maximum.
+///
+/// @param[in] VA  #VA by 3 list of vertex positions of mesh A 
+/// @param[in] FA  #FA by 3 list of triangle indices into VA
+/// @param[in] VB  #VB by 3 list of vertex positions of mesh B
+/// @param[in] FB  #FB by 3 list of triangle indices into VB
+/// @param[in] tol  tolerance value for the difference between upper and lower bounds
+/// @param[in] max_factor  factor to define the maximum allowed number of faces and vertices in the subdivided mesh with respect to the number of faces and vertices of the initial mesh (for each direction)
+/// @param[in] normalize  0 (false) or 1 (true) to normalize tolerance by the length of the diagonal of A's bounding box
+/// @param[in] options  options of the refinement of each direction (see PompeiuHausdorffOptions; batch_size triangles are refined in parallel in each direction)
+/// @param[out] stats  optional counters and per-stage timings of both directions added together (max_depth is the larger of the two)
+
+std::tuple<
+  double /* lower */,
+  double /* upper */,
+  double /* dA */,
+  double /* time_taken_bvh */,
+  double /* time_taken_bounds */>
+symmetric_pompeiu_hausdorff(
+  const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & VA,
+  const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> & FA,
+  const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & VB,
+  const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> & FB,
+  const double tol = 1e-8,
+  const double max_factor = 1000000,
+  const bool normalize = true,
+  const PompeiuHausdorffOptions & options = PompeiuHausdorffOptions(),
+  PompeiuHausdorffStats * stats = nullptr);
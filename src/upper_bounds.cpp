@@ -1,202 +1,340 @@
 // Given two triangle soups (VA,FA) and (VB,FB), this function calculates cascading upper bounds for the Pompeiu-Hausdorff distance between each triangle from A to mesh B.
+// The cheap bounds (u0, u1, u2) are evaluated in parallel on blocks of faces stored as structure of arrays (vectorized); only the faces they fail to reject go through Kang's bound and u4, in a second parallel sweep.
 
 // Input:
 // VA: #vertices(A) x 3 Eigen matrix containing x, y z coordinates of each vertex
 // FA: #faces(A) x 3 Eigen matrix containing vertex indices of each face
-// VB: #vertices(B) x 3 Eigen matrix containing x, y z coordinates of each vertex
-// FB: #faces(B) x 3 Eigen matrix containing vertex indices of each face
+// faces_B: per-face data of mesh B (see kang_face_data.h)
 // DV: #vertices(A) x 1 Eigen matrix containing distances from each vertex of A to B
 // I: #vertices(A) x 1 Eigen vector containing indices of faces of B to which points from A are projected
 // C: #vertices(A) x 3 Eigen matrix containing the closest points on B to the vertices of A
 // lower: global lower bound (double)
+// lazy: if true, only the cheap bounds (u0, u1, u2) are evaluated; faces they fail to reject keep min(u1,u2) in u and get success_bound = -1, and their cascade is finished later by expensive_upper_bound (default false)
+// order: order in which Kang's bound and u4 are tried (default: Kang's bound, then u4; see cascade_order.h)
+// counters: optional tallies of the expensive bounds for an adaptive order (fixed-size version only)
 
 // Output:
 // u: #faces(A) x 1 Eigen vector containing the upper bound for the Pompeiu-Hausdorff distance from each triangle on A to mesh B
-// succes_bound: #faces(A) x 1 Eigen vector containing the index of the upper bound that was successful at rejecting the triangle (= 5 if none of them were successful)
+// succes_bound: #faces(A) x 1 Eigen vector containing the index of the upper bound that was successful at rejecting the triangle (= 5 if none of them were successful, -1 if the expensive bounds were deferred)
 
 #include "upper_bounds.h"
-
-int upper_bounds(const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & VA, const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> & FA, const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & VB, const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> & FB, const Eigen::VectorXd & DV, const Eigen::VectorXi & I, const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & C, const double & lower, Eigen::VectorXd & u, Eigen::VectorXi & success_bound){
-    
-    if (u.rows()!=FA.rows()){
-        cout << "upper_bounds.cpp: Upper bound vector has been passed with wrong number of entries (not the same as the number of triangles)" << endl;
-        return 0;
-    }
-    
-    // flags
-    std::vector<bool> upper_bound_done(FA.rows());
-
-    // Edge lengths (needed for u1 and u2)
-    Eigen::VectorXd e(3);
-    
-    // uKang variables
-    Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> VAKang(3,3);
-    Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> FAKang(1,3);
-    Eigen::VectorXd DVKang(3);
-    Eigen::VectorXi IKang(3);
-    Eigen::VectorXd uKang(1);
-    
-    for(int i = 0;i<FA.rows();i++){
-
-        // upper bound initialization
-        u(i) = DBL_MAX;
-        // initialize flags as false
-        upper_bound_done[i] = false;
-        
-        // Max vertex distance (exact HD) if the three vertices project to the same triangle.
-        if (I(FA(i,0)) == I(FA(i,1)) && I(FA(i,1)) == I(FA(i,2))){
-            u(i) = fmax(fmax(DV(FA(i,0)), DV(FA(i,1))), DV(FA(i,2)));
-            upper_bound_done[i] = true;
-            success_bound(i) = 0;
+#include <igl/parallel_for.h>
+#include <chrono>
+#include <vector>
+
+// Number of faces whose cheap bounds (u0, u1, u2) are evaluated together in
+// structure-of-arrays form. Fixed-size blocks live on the stack and let Eigen
+// vectorize the arithmetic across faces.
+#define UPPER_BOUNDS_BLOCK 64
+
+namespace
+{
+    // Cheap part of the cascade (u0, u1 and u2) for the n <= N faces
+    // first,…,first+n-1, evaluated together in structure-of-arrays form.
+    // Faces that survive are marked with success_bound = -1.
+    template <int N, typename DerivedVA, typename DerivedFA, typename DerivedDV, typename DerivedI, typename Derivedu, typename Derivedsuccess>
+    void cheap_upper_bounds(const int first, const int n, const DerivedVA & VA, const DerivedFA & FA, const DerivedDV & DV, const DerivedI & I, const double & lower, Derivedu & u, Derivedsuccess & success_bound){
+
+        typedef Eigen::Array<double,N,1> BlockArray;
+
+        // Gather vertex distances and edge vectors in structure-of-arrays form
+        // (padding rows repeat the last face)
+        BlockArray d0, d1, d2, x0, y0, z0, x1, y1, z1, x2, y2, z2;
+        for(int k = 0;k<N;k++)
+        {
+            const int i = first+std::min(k,n-1);
+            d0(k) = DV(FA(i,0)); d1(k) = DV(FA(i,1)); d2(k) = DV(FA(i,2));
+            // edge c is opposite to vertex c
+            x0(k) = VA(FA(i,1),0)-VA(FA(i,2),0); y0(k) = VA(FA(i,1),1)-VA(FA(i,2),1); z0(k) = VA(FA(i,1),2)-VA(FA(i,2),2);
+            x1(k) = VA(FA(i,2),0)-VA(FA(i,0),0); y1(k) = VA(FA(i,2),1)-VA(FA(i,0),1); z1(k) = VA(FA(i,2),2)-VA(FA(i,0),2);
+            x2(k) = VA(FA(i,0),0)-VA(FA(i,1),0); y2(k) = VA(FA(i,0),1)-VA(FA(i,1),1); z2(k) = VA(FA(i,0),2)-VA(FA(i,1),2);
         }
 
+        // Edge lengths (needed for u1 and u2)
+        const BlockArray e0 = (x0*x0+y0*y0+z0*z0).sqrt();
+        const BlockArray e1 = (x1*x1+y1*y1+z1*z1).sqrt();
+        const BlockArray e2 = (x2*x2+y2*y2+z2*z2).sqrt();
+
         // u1 upper bound
-        if (!upper_bound_done[i]) {
-            double u1 = DBL_MAX;
+        const BlockArray u1 = (d0+e1.max(e2)).min(d1+e2.max(e0)).min(d2+e0.max(e1));
 
-            for(int c = 0;c<3;c++)
-            {
-                e(c) = (VA.row(FA(i,(c+1)%3)) - VA.row(FA(i,(c+2)%3))).norm();
+        // u2 upper bound
+        // Semiperimeter
+        const BlockArray s = (e0+e1+e2)/2.0;
+        // Area
+        const BlockArray A = (s*(s-e0)*(s-e1)*(s-e2)).sqrt();
+        // Circumradius
+        const BlockArray R = e0*e1*e2/(4.0*A);
+        // Inradius
+        const BlockArray r = A/s;
+        const BlockArray emax = e0.max(e1).max(e2);
+        const BlockArray dmax = d0.max(d1).max(d2);
+        const BlockArray u2 = dmax + (s-r > 2.*R).select(R, emax/2.0);
+
+        for(int k = 0;k<n;k++)
+        {
+            const int i = first+k;
+
+            // Max vertex distance (exact HD) if the three vertices project to the same triangle.
+            if (I(FA(i,0)) == I(FA(i,1)) && I(FA(i,1)) == I(FA(i,2))){
+                u(i) = dmax(k);
+                success_bound(i) = 0;
+                continue;
             }
 
-            for(int c = 0;c<3;c++)
-            {
-                const double dic = DV(FA(i,c));
-                u1 = std::min(u1,dic+max(e((c+1)%3), e((c+2)%3)));
+            u(i) = u1(k);
+            if (u(i)<lower){
+                success_bound(i) = 1;
+                continue;
             }
 
-            u(i) = u1;
-
+            u(i) = std::min(u2(k),u(i));
             if (u(i)<lower){
-                upper_bound_done[i] = true;
-                success_bound(i) = 1;
+                success_bound(i) = 2;
+                continue;
             }
 
+            success_bound(i) = -1;
         }
+    }
 
-        // u2 upper bound
-        if (!upper_bound_done[i]) {
-
-            double u2 = 0;
-            // Semiperimeter
-            double s = e.array().sum()/2.0;
-            // Area
-            double A = sqrt(s*(s-e(0))*(s-e(1))*(s-e(2)));
-            // Circumradius
-            double R = e(0)*e(1)*e(2)/(4.0*A);
-            // Inradius
-            double r = A/s;
-
-            for(int c = 0;c<3;c++)
-            {
-                const double dic = DV(FA(i,c));
-                u2 = std::max(u2,dic);
-            }
+    // Kang's bound (u3) for face i. Only fixed-size temporaries are used.
+    // Returns 0 on error.
+    template <typename DerivedVA, typename DerivedFA, typename DerivedDV, typename DerivedI>
+    int kang_bound(const int i, const DerivedVA & VA, const DerivedFA & FA, const KangFaceData & faces_B, const DerivedDV & DV, const DerivedI & I, double & uKang){
+
+        Eigen::Matrix<double,3,3,Eigen::RowMajor> VKang;
+        Eigen::Vector3d DKang;
+        Eigen::Vector3i IKang;
+        for(int c = 0;c<3;c++)
+        {
+            VKang.row(c) = VA.row(FA(i,c));
+            DKang(c) = DV(FA(i,c));
+            IKang(c) = I(FA(i,c));
+        }
 
-            u2 += ( s-r > 2.*R ? R : e.maxCoeff()/2.0 );
+        return kang_upper_bound(VKang, DKang, IKang, faces_B, uKang);
 
-            u(i) = std::min(u2,u(i));
+    }
 
-            if (u(i)<lower){
-                upper_bound_done[i] = true;
-                success_bound(i) = 2;
-            }
+    // u4 upper bound for face i, from the bisectors of the closest points of
+    // its shortest edge. Returns 0 on error.
+    template <typename DerivedVA, typename DerivedFA, typename DerivedC>
+    int u4_bound(const int i, const DerivedVA & VA, const DerivedFA & FA, const DerivedC & C, double & u4){
 
+        // Edge lengths
+        Eigen::Vector3d e;
+        for(int c = 0;c<3;c++)
+        {
+            e(c) = (VA.row(FA(i,(c+1)%3)) - VA.row(FA(i,(c+2)%3))).norm();
         }
-            
-        // u3 upper bound
-        if (!upper_bound_done[i]) {
-                
-            VAKang.row(0) = VA.row(FA(i,0));
-            VAKang.row(1) = VA.row(FA(i,1));
-            VAKang.row(2) = VA.row(FA(i,2));
-            FAKang(0,0) = 0; FAKang(0,1) = 1; FAKang(0,2) = 2;
-            DVKang(0,0) = DV(FA(i,0)); DVKang(1,0) = DV(FA(i,1)); DVKang(2,0) = DV(FA(i,2));
-            IKang(0) = I(FA(i,0)); IKang(1) = I(FA(i,1)); IKang(2) = I(FA(i,2));
-                
-            kang_upper_bound(VAKang, FAKang, VB, FB, DVKang, IKang, uKang);
-
-                
-            u(i) = std::min(uKang(0),u(i));
-                
-            if (u(i)<lower){
-                upper_bound_done[i] = true;
-                success_bound(i) = 3;
-            }
-                
+
+        int sm_edge = -1;
+        if ((e(0)<e(1))&&(e(0)<e(2))){
+            sm_edge = 0;
+        } else if ((e(1)<e(0))&&(e(1)<e(2))){
+            sm_edge = 1;
+        } else {
+            sm_edge = 2;
         }
 
-        // u4 upper bound
-        if (!upper_bound_done[i]) {
+        u4 = DBL_MAX;
 
-            int sm_edge = -1;
-            if ((e(0)<e(1))&&(e(0)<e(2))){
-                sm_edge = 0;
-            } else if ((e(1)<e(0))&&(e(1)<e(2))){
-                sm_edge = 1;
-            } else {
-                sm_edge = 2;
-            }
+        for (int a=1; a<=2; a++){
 
-            if (sm_edge!=-1){
+            Eigen::Vector3d Q1 = C.row(FA(i,sm_edge));
+            Eigen::Vector3d Q2 = C.row(FA(i,(sm_edge+a)%3));
 
-                double u4 = DBL_MAX;
+            double a_bisec, b_bisec, c_bisec, d_bisec;
+            if (!bisector_of_two_points(Q1, Q2, a_bisec, b_bisec, c_bisec, d_bisec)){
+                    cout << "Error in edge bisector intersection" << endl;
+                    return 0;
+            }
 
-                for (int a=1; a<=2; a++){
+            Eigen::Vector3d v0 = VA.row(FA(i,0));
+            Eigen::Vector3d v1 = VA.row(FA(i,1));
+            Eigen::Vector3d v2 = VA.row(FA(i,2));
+            double u_vert = std::max(std::max(std::min((v0-Q1).norm(),(v0-Q2).norm()),std::min((v1-Q1).norm(),(v1-Q2).norm())),std::min((v2-Q1).norm(),(v2-Q2).norm()));
 
-                    Eigen::Vector3d Q1 = C.row(FA(i,sm_edge));
-                    Eigen::Vector3d Q2 = C.row(FA(i,(sm_edge+a)%3));
+            double u_partial = u_vert;
 
-                    double a_bisec, b_bisec, c_bisec, d_bisec;
-                    if (!bisector_of_two_points(Q1, Q2, a_bisec, b_bisec, c_bisec, d_bisec)){
-                            cout << "Error in edge bisector intersection" << endl;
-                            return 0;
-                    }
+            for (int b=0; b<=2; b++){
 
-                    Eigen::Vector3d v0 = VA.row(FA(i,0));
-                    Eigen::Vector3d v1 = VA.row(FA(i,1));
-                    Eigen::Vector3d v2 = VA.row(FA(i,2));
-                    double u_vert = std::max(std::max(std::min((v0-Q1).norm(),(v0-Q2).norm()),std::min((v1-Q1).norm(),(v1-Q2).norm())),std::min((v2-Q1).norm(),(v2-Q2).norm()));
-                        
-                    double u_partial = u_vert;
+                Eigen::Vector3d P1 = VA.row(FA(i,(b+1)%3));
+                Eigen::Vector3d P2 = VA.row(FA(i,(b+2)%3));
+                double t_bisec = -(a_bisec*P1(0) + b_bisec*P1(1) + c_bisec*P1(2)+d_bisec)/(a_bisec*(P2(0)-P1(0))+b_bisec*(P2(1)-P1(1))+c_bisec*(P2(2)-P1(2)));
 
-                    for (int b=0; b<=2; b++){
+                if (t_bisec>0 && t_bisec<1){
+                    Eigen::Vector3d P_bisec = P1+t_bisec*(P2-P1);
+                    u_partial = std::max(std::max((P_bisec-Q1).norm(),(P_bisec-Q2).norm()),u_partial);
+                }
 
-                        Eigen::Vector3d P1 = VA.row(FA(i,(b+1)%3));
-                        Eigen::Vector3d P2 = VA.row(FA(i,(b+2)%3));
-                        double t_bisec = -(a_bisec*P1(0) + b_bisec*P1(1) + c_bisec*P1(2)+d_bisec)/(a_bisec*(P2(0)-P1(0))+b_bisec*(P2(1)-P1(1))+c_bisec*(P2(2)-P1(2)));
+            }
 
-                        if (t_bisec>0 && t_bisec<1){
-                            Eigen::Vector3d P_bisec = P1+t_bisec*(P2-P1);
-                            u_partial = std::max(std::max((P_bisec-Q1).norm(),(P_bisec-Q2).norm()),u_partial);
-                        }
+            u4 = std::min(u4,u_partial);
 
-                    }
+        }
 
-                    u4 = std::min(u4,u_partial);
+        return 1;
 
-                }
+    }
 
-                u(i) = std::min(u4,u(i));
-                
-                if (u(i)<lower){
-                    upper_bound_done[i] = true;
-                    success_bound(i) = 4; 
+    // Expensive part of the cascade (Kang's bound and u4, in the given order)
+    // for face i, whose u(i) already holds min(u1,u2). Faces picked as probes
+    // are evaluated with both bounds, timed, and tallied in counters.
+    // Returns 0 on error.
+    template <typename DerivedVA, typename DerivedFA, typename DerivedDV, typename DerivedI, typename DerivedC, typename Derivedu, typename Derivedsuccess>
+    int expensive_upper_bounds(const int i, const DerivedVA & VA, const DerivedFA & FA, const KangFaceData & faces_B, const DerivedDV & DV, const DerivedI & I, const DerivedC & C, const double & lower, Derivedu & u, Derivedsuccess & success_bound, const CascadeOrder & order, CascadeCounters * counters){
+
+        // bound 3 (Kang) or 4 (u4) of face i
+        const auto evaluate = [&](const int bound, double & u_bound)
+        {
+            return bound==3 ? kang_bound(i,VA,FA,faces_B,DV,I,u_bound) : u4_bound(i,VA,FA,C,u_bound);
+        };
+
+        if (counters && order.probe(*counters)){
+            double u_bound[2];
+            bool rejected[2];
+            for(int b = 0;b<2;b++)
+            {
+                const double t_start = std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+                if (!evaluate(3+b,u_bound[b])){
+                    return 0;
                 }
-
+                const double t_end = std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+                counters->seconds[b] += t_end-t_start;
+                rejected[b] = u_bound[b]<lower;
             }
-
+            counters->probes++;
+            for(int b = 0;b<2;b++)
+            {
+                counters->attempts[b]++;
+                counters->rejected[b] += rejected[b];
+                counters->rejected_alone[b] += rejected[b] && !rejected[1-b];
+            }
+            u(i) = std::min(std::min(u_bound[0],u_bound[1]),u(i));
+            success_bound(i) = rejected[0] ? 3 : (rejected[1] ? 4 : 5);
+            if (success_bound(i)!=5){
+                counters->successes[success_bound(i)-3]++;
+            }
+            return 1;
         }
 
+        for(int k = 0;k<order.size();k++)
+        {
+            double u_bound;
+            if (!evaluate(order.bound(k),u_bound)){
+                return 0;
+            }
+            u(i) = std::min(u_bound,u(i));
+            if (counters){
+                counters->attempts[order.bound(k)-3]++;
+            }
+            if (u(i)<lower){
+                success_bound(i) = order.bound(k);
+                if (counters){
+                    counters->successes[order.bound(k)-3]++;
+                }
+                return 1;
+            }
+        }
 
         // None of the bounds were successful at rejecting the triangle
-        if (!upper_bound_done[i]) {
-            success_bound(i) = 5;
+        success_bound(i) = 5;
+        return 1;
+
+    }
+}
+
+int upper_bounds(const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & VA, const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> & FA, const KangFaceData & faces_B, const Eigen::VectorXd & DV, const Eigen::VectorXi & I, const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & C, const double & lower, Eigen::VectorXd & u, Eigen::VectorXi & success_bound, const bool lazy, const CascadeOrder & order){
+    
+    if (u.rows()!=FA.rows()){
+        cout << "upper_bounds.cpp: Upper bound vector has been passed with wrong number of entries (not the same as the number of triangles)" << endl;
+        return 0;
+    }
+
+    const int num_faces = FA.rows();
+    const int num_blocks = (num_faces+UPPER_BOUNDS_BLOCK-1)/UPPER_BOUNDS_BLOCK;
+
+    // First sweep: u0, u1 and u2 on blocks of faces. Faces that survive are
+    // marked with success_bound = -1.
+    igl::parallel_for(num_blocks,[&](const int block)
+    {
+        const int first = block*UPPER_BOUNDS_BLOCK;
+        const int n = std::min(UPPER_BOUNDS_BLOCK,num_faces-first);
+        cheap_upper_bounds<UPPER_BOUNDS_BLOCK>(first,n,VA,FA,DV,I,lower,u,success_bound);
+    },16);
+
+    if (lazy){
+        return 1;
+    }
+
+    // Faces that need the expensive bounds, in order
+    std::vector<int> survivors;
+    for(int i = 0;i<num_faces;i++)
+    {
+        if (success_bound(i) == -1){
+            survivors.push_back(i);
+        }
+    }
+
+    // Second sweep: Kang's bound and u4 on the surviving faces (one success
+    // flag per thread)
+    std::vector<int> success;
+    igl::parallel_for(
+        (int)survivors.size(),
+        [&](const size_t nthreads){ success.resize(nthreads,1); },
+        [&](const int j, const size_t t)
+        {
+            if (success[t]){
+                success[t] = expensive_upper_bounds(survivors[j],VA,FA,faces_B,DV,I,C,lower,u,success_bound,order,(CascadeCounters *)nullptr);
+            }
+        },
+        [](const size_t){},
+        64);
+
+    for(size_t t = 0;t<success.size();t++)
+    {
+        if (!success[t]){
+            return 0;
         }
-        
-        
     }
     
     return 1;
     
 }
+
+int upper_bounds(const Eigen::Matrix<double,6,3,Eigen::RowMajor> & VA, const Eigen::Matrix<int,4,3,Eigen::RowMajor> & FA, const KangFaceData & faces_B, const Eigen::Matrix<double,6,1> & DV, const Eigen::Matrix<int,6,1> & I, const Eigen::Matrix<double,6,3,Eigen::RowMajor> & C, const double & lower, Eigen::Vector4d & u, Eigen::Vector4i & success_bound, const bool lazy, const CascadeOrder & order, CascadeCounters * counters){
+
+    // Same cascade as above with a single block of the four children
+    cheap_upper_bounds<4>(0,4,VA,FA,DV,I,lower,u,success_bound);
+
+    if (lazy){
+        return 1;
+    }
+
+    for(int i = 0;i<4;i++)
+    {
+        if (success_bound(i) == -1 && !expensive_upper_bounds(i,VA,FA,faces_B,DV,I,C,lower,u,success_bound,order,counters)){
+            return 0;
+        }
+    }
+
+    return 1;
+
+}
+
+int expensive_upper_bound(const Eigen::Matrix<double,3,3,Eigen::RowMajor> & V, const Eigen::Vector3d & D, const Eigen::Vector3i & I, const Eigen::Matrix<double,3,3,Eigen::RowMajor> & C, const KangFaceData & faces_B, const double & lower, double & u, int & success_bound, const CascadeOrder & order, CascadeCounters * counters){
+
+    // The triangle is the only face of its own corners
+    const Eigen::Matrix<int,1,3,Eigen::RowMajor> F(0,1,2);
+    Eigen::Matrix<double,1,1> u_face(u);
+    Eigen::Matrix<int,1,1> success_face;
+    if (!expensive_upper_bounds(0,V,F,faces_B,D,I,C,lower,u_face,success_face,order,counters)){
+        return 0;
+    }
+    u = u_face(0);
+    success_bound = success_face(0);
+    return 1;
+
+}
\ No newline at end of file
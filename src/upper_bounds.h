@@ -1,19 +1,3 @@
-// Given two triangle soups (VA,FA) and (VB,FB), this function calculates cascading upper bounds for the Pompeiu-Hausdorff distance between each triangle from A to mesh B.
-
-// Input:
-// VA: #vertices(A) x 3 Eigen matrix containing x, y z coordinates of each vertex
-// FA: #faces(A) x 3 Eigen matrix containing vertex indices of each face
-// VB: #vertices(B) x 3 Eigen matrix containing x, y z coordinates of each vertex
-// FB: #faces(B) x 3 Eigen matrix containing vertex indices of each face
-// DV: #vertices(A) x 1 Eigen matrix containing distances from each vertex of A to B
-// I: #vertices(A) x 1 Eigen vector containing indices of faces of B to which points from A are projected
-// C: #vertices(A) x 3 Eigen matrix containing the closest points on B to the vertices of A
-// lower: global lower bound (double)
-
-// Output:
-// u: #faces(A) x 1 Eigen vector containing the upper bound for the Pompeiu-Hausdorff distance from each triangle on A to mesh B
-// succes_bound: #faces(A) x 1 Eigen vector containing the index of the upper bound that was successful at rejecting the triangle (= 5 if none of them were successful)
-
 #include <stdio.h>
 #include <iostream>
 #include <cfloat>
@@ -21,8 +5,31 @@
 #include <Eigen/Dense>
 #include <igl/AABB.h>
 #include "kang_upper_bound.h"
+#include "cascade_order.h"
 #include "bisector_of_two_points.h"
 
 using namespace std;
 
-int upper_bounds(const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & VA, const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> & FA, const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & VB, const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> & FB, const Eigen::VectorXd & DV, const Eigen::VectorXi & I, const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & C, const double & lower, Eigen::VectorXd & u, Eigen::VectorXi & success_bound);
+/// Cascading upper bounds on the Pompeiu-Hausdorff distance from each triangle
+/// of a triangle soup (VA,FA) to mesh B (u0, u1 and u2 first, then Kang's
+/// bound and u4 for the triangles they fail to reject; see upper_bounds.cpp).
+///
+/// @param[in] VA  #vertices(A) x 3 vertex coordinates of A
+/// @param[in] FA  #faces(A) x 3 vertex indices of each face of A
+/// @param[in] faces_B  per-face data of mesh B (see kang_face_data.h)
+/// @param[in] DV  #vertices(A) distances from each vertex of A to B
+/// @param[in] I  #vertices(A) indices of the faces of B closest to the vertices of A
+/// @param[in] C  #vertices(A) x 3 closest points on B to the vertices of A
+/// @param[in] lower  global lower bound
+/// @param[out] u  #faces(A) upper bounds of the faces of A
+/// @param[out] success_bound  #faces(A) index of the bound that rejected each face (5 if none did, -1 if the expensive bounds were deferred)
+/// @param[in] lazy  evaluate the cheap bounds only: faces they fail to reject keep min(u1,u2) in u, to be finished by expensive_upper_bound
+/// @param[in] order  order in which Kang's bound and u4 are tried (see cascade_order.h)
+/// @return nonzero on success
+int upper_bounds(const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & VA, const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> & FA, const KangFaceData & faces_B, const Eigen::VectorXd & DV, const Eigen::VectorXi & I, const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> & C, const double & lower, Eigen::VectorXd & u, Eigen::VectorXi & success_bound, const bool lazy = false, const CascadeOrder & order = CascadeOrder());
+
+/// Fixed-size version for the four children of a subdivided triangle (6 vertices: the 3 corners followed by the 3 edge midpoints). Same bounds as above, without any heap allocation; counters are optional tallies of the expensive bounds for an adaptive order.
+int upper_bounds(const Eigen::Matrix<double,6,3,Eigen::RowMajor> & VA, const Eigen::Matrix<int,4,3,Eigen::RowMajor> & FA, const KangFaceData & faces_B, const Eigen::Matrix<double,6,1> & DV, const Eigen::Matrix<int,6,1> & I, const Eigen::Matrix<double,6,3,Eigen::RowMajor> & C, const double & lower, Eigen::Vector4d & u, Eigen::Vector4i & success_bound, const bool lazy = false, const CascadeOrder & order = CascadeOrder(), CascadeCounters * counters = nullptr);
+
+/// Rest of the cascade (Kang's bound and u4) for a single triangle whose bounds were deferred with lazy = true. V holds its corners, D, I and C the distances, closest faces and closest points of the corners, and u the bound from the cheap part; u and success_bound are updated as above.
+int expensive_upper_bound(const Eigen::Matrix<double,3,3,Eigen::RowMajor> & V, const Eigen::Vector3d & D, const Eigen::Vector3i & I, const Eigen::Matrix<double,3,3,Eigen::RowMajor> & C, const KangFaceData & faces_B, const double & lower, double & u, int & success_bound, const CascadeOrder & order = CascadeOrder(), CascadeCounters * counters = nullptr);
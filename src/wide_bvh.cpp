@@ -0,0 +1,362 @@
+#include "wide_bvh.h"
+#include <Eigen/Geometry>
+#include <algorithm>
+#include <limits>
+
+struct WideBVH::BuildPrimitive
+{
+    Eigen::AlignedBox3d box;
+    Eigen::Vector3d centroid;
+    int face;
+};
+
+namespace
+{
+    // Number of bins per axis of the surface area heuristic
+    const int number_of_bins = 16;
+
+    double surface_area(const Eigen::AlignedBox3d & box)
+    {
+        if (box.isEmpty()){
+            return 0;
+        }
+        const Eigen::Vector3d s = box.sizes();
+        return 2*(s(0)*s(1)+s(1)*s(2)+s(2)*s(0));
+    }
+
+    // Split primitives [first,last) in two with the binned surface area
+    // heuristic (median split along the widest axis when all centroids fall in
+    // one bin) and return the first index of the second half
+    template <typename Primitive>
+    int sah_split(std::vector<Primitive> & primitives, const int first, const int last)
+    {
+        Eigen::AlignedBox3d centroids;
+        for (int k=first; k<last; k++){
+            centroids.extend(primitives[k].centroid);
+        }
+        const auto bin_of = [&](const Primitive & primitive, const int axis)
+        {
+            const double extent = centroids.max()(axis)-centroids.min()(axis);
+            const int b = int(number_of_bins*(primitive.centroid(axis)-centroids.min()(axis))/extent);
+            return std::min(b,number_of_bins-1);
+        };
+        double best_cost = std::numeric_limits<double>::infinity();
+        int best_axis = -1;
+        int best_bin = -1;
+        for (int axis=0; axis<3; axis++){
+            if (!(centroids.max()(axis)>centroids.min()(axis))){
+                continue;
+            }
+            Eigen::AlignedBox3d bin_box[number_of_bins];
+            int bin_count[number_of_bins] = {0};
+            for (int k=first; k<last; k++){
+                const int b = bin_of(primitives[k],axis);
+                bin_box[b].extend(primitives[k].box);
+                bin_count[b]++;
+            }
+            // area and count of the right side of every split, then sweep the left
+            double right_area[number_of_bins];
+            int right_count[number_of_bins];
+            Eigen::AlignedBox3d box;
+            int count = 0;
+            for (int b=number_of_bins-1; b>0; b--){
+                box.extend(bin_box[b]);
+                count += bin_count[b];
+                right_area[b] = surface_area(box);
+                right_count[b] = count;
+            }
+            box.setEmpty();
+            count = 0;
+            for (int b=0; b<number_of_bins-1; b++){
+                box.extend(bin_box[b]);
+                count += bin_count[b];
+                if (count==0 || right_count[b+1]==0){
+                    continue;
+                }
+                const double cost = surface_area(box)*count+right_area[b+1]*right_count[b+1];
+                if (cost<best_cost){
+                    best_cost = cost;
+                    best_axis = axis;
+                    best_bin = b;
+                }
+            }
+        }
+        if (best_axis<0){
+            int axis;
+            centroids.sizes().maxCoeff(&axis);
+            const int mid = (first+last)/2;
+            std::nth_element(primitives.begin()+first,primitives.begin()+mid,primitives.begin()+last,
+                [axis](const Primitive & x, const Primitive & y){ return x.centroid(axis)<y.centroid(axis); });
+            return mid;
+        }
+        return std::partition(primitives.begin()+first,primitives.begin()+last,
+            [&](const Primitive & primitive){ return bin_of(primitive,best_axis)<=best_bin; })
+            -primitives.begin();
+    }
+}
+
+WideBVH::WideBVH(): m_root(0)
+{
+}
+
+void WideBVH::init(
+    const Eigen::Ref<const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> > & V,
+    const Eigen::Ref<const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> > & F)
+{
+    m_nodes.clear();
+    m_packets.clear();
+    m_root = 0;
+    if (F.rows()==0){
+        return;
+    }
+    std::vector<BuildPrimitive> primitives(F.rows());
+    for (int f=0; f<F.rows(); f++){
+        BuildPrimitive & primitive = primitives[f];
+        primitive.box.setEmpty();
+        for (int c=0; c<3; c++){
+            primitive.box.extend(V.row(F(f,c)).transpose());
+        }
+        primitive.centroid = (V.row(F(f,0))+V.row(F(f,1))+V.row(F(f,2))).transpose()/3;
+        primitive.face = f;
+    }
+    // a 4-wide tree has about a third as many nodes as packets
+    m_packets.reserve((F.rows()+3)/4*2);
+    m_nodes.reserve(m_packets.capacity()/2+1);
+    m_root = build(primitives,0,F.rows(),V,F);
+}
+
+int WideBVH::build(
+    std::vector<BuildPrimitive> & primitives,
+    const int first,
+    const int last,
+    const Eigen::Ref<const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> > & V,
+    const Eigen::Ref<const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> > & F)
+{
+    const int count = last-first;
+    if (count<=4){
+        TrianglePacket packet;
+        for (int l=0; l<4; l++){
+            packet.face[l] = l<count ? primitives[first+l].face : -1;
+        }
+        set_packet(packet,V,F);
+        m_packets.push_back(packet);
+        return ~int(m_packets.size()-1);
+    }
+
+    // split into (up to) four ranges, always splitting the largest one
+    int range_first[4] = {first};
+    int range_last[4] = {last};
+    int number_of_ranges = 1;
+    while (number_of_ranges<4){
+        int largest = 0;
+        for (int r=1; r<number_of_ranges; r++){
+            if (range_last[r]-range_first[r]>range_last[largest]-range_first[largest]){
+                largest = r;
+            }
+        }
+        if (range_last[largest]-range_first[largest]<=4){
+            break;
+        }
+        const int mid = sah_split(primitives,range_first[largest],range_last[largest]);
+        range_first[number_of_ranges] = mid;
+        range_last[number_of_ranges] = range_last[largest];
+        range_last[largest] = mid;
+        number_of_ranges++;
+    }
+
+    const int node = m_nodes.size();
+    m_nodes.push_back(Node());
+    for (int r=0; r<4; r++){
+        Eigen::AlignedBox3d box;
+        int child = 0;
+        if (r<number_of_ranges){
+            for (int k=range_first[r]; k<range_last[r]; k++){
+                box.extend(primitives[k].box);
+            }
+            child = build(primitives,range_first[r],range_last[r],V,F);
+        } else {
+            box.min().setConstant(std::numeric_limits<double>::infinity());
+            box.max().setConstant(-std::numeric_limits<double>::infinity());
+        }
+        // the recursion may have moved the nodes
+        Node & n = m_nodes[node];
+        n.min_x[r] = box.min()(0); n.min_y[r] = box.min()(1); n.min_z[r] = box.min()(2);
+        n.max_x[r] = box.max()(0); n.max_y[r] = box.max()(1); n.max_z[r] = box.max()(2);
+        n.child[r] = child;
+    }
+    return node;
+}
+
+void WideBVH::set_packet(
+    TrianglePacket & packet,
+    const Eigen::Ref<const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> > & V,
+    const Eigen::Ref<const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> > & F)
+{
+    for (int l=0; l<4; l++){
+        // unused lanes repeat lane 0
+        const int f = packet.face[l]>=0 ? packet.face[l] : packet.face[0];
+        const Eigen::RowVector3d a = V.row(F(f,0));
+        const Eigen::RowVector3d ab = V.row(F(f,1))-a;
+        const Eigen::RowVector3d ac = V.row(F(f,2))-a;
+        packet.ax[l] = a(0); packet.ay[l] = a(1); packet.az[l] = a(2);
+        packet.abx[l] = ab(0); packet.aby[l] = ab(1); packet.abz[l] = ab(2);
+        packet.acx[l] = ac(0); packet.acy[l] = ac(1); packet.acz[l] = ac(2);
+    }
+}
+
+void WideBVH::box(const int ref, double b[6]) const
+{
+    const double inf = std::numeric_limits<double>::infinity();
+    b[0] = b[1] = b[2] = inf;
+    b[3] = b[4] = b[5] = -inf;
+    if (ref<0){
+        const TrianglePacket & t = m_packets[~ref];
+        for (int l=0; l<4; l++){
+            const double x[3] = {t.ax[l],t.ax[l]+t.abx[l],t.ax[l]+t.acx[l]};
+            const double y[3] = {t.ay[l],t.ay[l]+t.aby[l],t.ay[l]+t.acy[l]};
+            const double z[3] = {t.az[l],t.az[l]+t.abz[l],t.az[l]+t.acz[l]};
+            for (int c=0; c<3; c++){
+                b[0] = std::min(b[0],x[c]); b[1] = std::min(b[1],y[c]); b[2] = std::min(b[2],z[c]);
+                b[3] = std::max(b[3],x[c]); b[4] = std::max(b[4],y[c]); b[5] = std::max(b[5],z[c]);
+            }
+        }
+    } else {
+        const Node & n = m_nodes[ref];
+        for (int r=0; r<4; r++){
+            b[0] = std::min(b[0],n.min_x[r]); b[1] = std::min(b[1],n.min_y[r]); b[2] = std::min(b[2],n.min_z[r]);
+            b[3] = std::max(b[3],n.max_x[r]); b[4] = std::max(b[4],n.max_y[r]); b[5] = std::max(b[5],n.max_z[r]);
+        }
+    }
+}
+
+void WideBVH::refit(
+    const Eigen::Ref<const Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> > & V,
+    const Eigen::Ref<const Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> > & F)
+{
+    for (size_t k=0; k<m_packets.size(); k++){
+        set_packet(m_packets[k],V,F);
+    }
+    // children are built after their parent, so visiting the nodes backwards
+    // refits every child before its parent
+    for (size_t k=m_nodes.size(); k-->0;){
+        Node & n = m_nodes[k];
+        for (int r=0; r<4; r++){
+            // empty lanes keep their empty box
+            if (!(n.min_x[r]<=n.max_x[r])){
+                continue;
+            }
+            double b[6];
+            box(n.child[r],b);
+            n.min_x[r] = b[0]; n.min_y[r] = b[1]; n.min_z[r] = b[2];
+            n.max_x[r] = b[3]; n.max_y[r] = b[4]; n.max_z[r] = b[5];
+        }
+    }
+}
+
+double WideBVH::squared_distance(
+    const Eigen::RowVector3d & p,
+    const double up_sqr_d,
+    int & i,
+    Eigen::RowVector3d & c) const
+{
+    double sqr_d = up_sqr_d;
+    if (!empty()){
+        squared_distance_recursive(m_root,p,sqr_d,i,c);
+    }
+    return sqr_d;
+}
+
+void WideBVH::squared_distance_recursive(
+    const int ref,
+    const Eigen::RowVector3d & p,
+    double & sqr_d,
+    int & i,
+    Eigen::RowVector3d & c) const
+{
+    const double px = p(0), py = p(1), pz = p(2);
+    if (ref<0){
+        // closest point on each of the four triangles: the projection on the
+        // plane if it falls inside, else the closest of the three edges
+        const TrianglePacket & t = m_packets[~ref];
+        double d[4], cx[4], cy[4], cz[4];
+        for (int l=0; l<4; l++){
+            const double apx = px-t.ax[l], apy = py-t.ay[l], apz = pz-t.az[l];
+            const double d00 = t.abx[l]*t.abx[l]+t.aby[l]*t.aby[l]+t.abz[l]*t.abz[l];
+            const double d01 = t.abx[l]*t.acx[l]+t.aby[l]*t.acy[l]+t.abz[l]*t.acz[l];
+            const double d11 = t.acx[l]*t.acx[l]+t.acy[l]*t.acy[l]+t.acz[l]*t.acz[l];
+            const double dbc = d00-2*d01+d11;
+            const double denom = d00*d11-d01*d01;
+            const double d20 = apx*t.abx[l]+apy*t.aby[l]+apz*t.abz[l];
+            const double d21 = apx*t.acx[l]+apy*t.acy[l]+apz*t.acz[l];
+            // edge ab
+            const double s_ab = std::min(1.0,std::max(0.0,(d00>0 ? d20/d00 : 0)));
+            const double ex_ab = apx-s_ab*t.abx[l], ey_ab = apy-s_ab*t.aby[l], ez_ab = apz-s_ab*t.abz[l];
+            const double e_ab = ex_ab*ex_ab+ey_ab*ey_ab+ez_ab*ez_ab;
+            // edge ac
+            const double s_ac = std::min(1.0,std::max(0.0,(d11>0 ? d21/d11 : 0)));
+            const double ex_ac = apx-s_ac*t.acx[l], ey_ac = apy-s_ac*t.acy[l], ez_ac = apz-s_ac*t.acz[l];
+            const double e_ac = ex_ac*ex_ac+ey_ac*ey_ac+ez_ac*ez_ac;
+            // edge bc (bp·bc = ap·ac - ap·ab - ab·ac + ab·ab)
+            const double s_bc = std::min(1.0,std::max(0.0,(dbc>0 ? (d21-d20-d01+d00)/dbc : 0)));
+            const double ux = t.abx[l]+s_bc*(t.acx[l]-t.abx[l]);
+            const double uy = t.aby[l]+s_bc*(t.acy[l]-t.aby[l]);
+            const double uz = t.abz[l]+s_bc*(t.acz[l]-t.abz[l]);
+            const double ex_bc = apx-ux, ey_bc = apy-uy, ez_bc = apz-uz;
+            const double e_bc = ex_bc*ex_bc+ey_bc*ey_bc+ez_bc*ez_bc;
+            // interior (barycentric coordinates of the projection)
+            const double inv_denom = denom>0 ? 1/denom : 0;
+            const double v = (d11*d20-d01*d21)*inv_denom;
+            const double w = (d00*d21-d01*d20)*inv_denom;
+            const bool inside = denom>0 && v>=0 && w>=0 && v+w<=1;
+            const double fx = apx-v*t.abx[l]-w*t.acx[l];
+            const double fy = apy-v*t.aby[l]-w*t.acy[l];
+            const double fz = apz-v*t.abz[l]-w*t.acz[l];
+            // offsets from p to the closest point
+            double ox = e_ab<=e_ac ? ex_ab : ex_ac;
+            double oy = e_ab<=e_ac ? ey_ab : ey_ac;
+            double oz = e_ab<=e_ac ? ez_ab : ez_ac;
+            double e = std::min(e_ab,e_ac);
+            ox = e_bc<e ? ex_bc : ox;
+            oy = e_bc<e ? ey_bc : oy;
+            oz = e_bc<e ? ez_bc : oz;
+            e = std::min(e,e_bc);
+            ox = inside ? fx : ox;
+            oy = inside ? fy : oy;
+            oz = inside ? fz : oz;
+            d[l] = inside ? fx*fx+fy*fy+fz*fz : e;
+            cx[l] = px-ox;
+            cy[l] = py-oy;
+            cz[l] = pz-oz;
+        }
+        for (int l=0; l<4; l++){
+            if (d[l]<sqr_d){
+                sqr_d = d[l];
+                i = t.face[l];
+                c << cx[l], cy[l], cz[l];
+            }
+        }
+        return;
+    }
+
+    // squared distances to the four child boxes
+    const Node & n = m_nodes[ref];
+    double d[4];
+    for (int l=0; l<4; l++){
+        const double dx = std::max(0.0,std::max(n.min_x[l]-px,px-n.max_x[l]));
+        const double dy = std::max(0.0,std::max(n.min_y[l]-py,py-n.max_y[l]));
+        const double dz = std::max(0.0,std::max(n.min_z[l]-pz,pz-n.max_z[l]));
+        d[l] = dx*dx+dy*dy+dz*dz;
+    }
+    // look at the closer children first
+    int order[4] = {0,1,2,3};
+    for (int k=1; k<4; k++){
+        for (int j=k; j>0 && d[order[j]]<d[order[j-1]]; j--){
+            std::swap(order[j],order[j-1]);
+        }
+    }
+    for (int k=0; k<4; k++){
+        if (d[order[k]]<sqr_d){
+            squared_distance_recursive(n.child[order[k]],p,sqr_d,i,c);
+        }
+    }
+}
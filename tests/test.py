@@ -2,11 +2,19 @@
 #
 #    cat ../tests/test.py | python  
 import pytest
-from cascading_upper_bounds import pompeiu_hausdorff, PompeiuHausdorff
+from cascading_upper_bounds import pompeiu_hausdorff, symmetric_pompeiu_hausdorff, streaming_pompeiu_hausdorff, sharded_pompeiu_hausdorff, write_triangle_mesh_binary, PompeiuHausdorff, PompeiuHausdorffTarget, CancelFlag
 import numpy as np
 import igl
 import pathlib
 
+this_dir = pathlib.Path(__file__).parent.resolve()
+
+@pytest.fixture(scope="module")
+def meshes():
+    VA, FA = igl.read_triangle_mesh(f"{this_dir}/../meshes/107100.obj")
+    VB, FB = igl.read_triangle_mesh(f"{this_dir}/../meshes/107100_sf.obj")
+    return VA, FA, VB, FB
+
 def test_example():
     this_dir = pathlib.Path(__file__).parent.resolve()
     # ./pompeiu_hausdorff ../meshes/107100.obj ../meshes/107100_sf.obj 1e-8 1000000 1 \
@@ -33,3 +41,271 @@ def test_example():
     print("number of faces: ", ph.number_of_faces)
     print("# faces in queue: ", ph.Q.size())
     print("top of queue: ", ph.Q.top())
+
+def test_batch_refinement(meshes):
+    VA, FA, VB, FB = meshes
+    tol = 1e-6
+    lower, upper_max, dA, _, _ = pompeiu_hausdorff(VA, FA, VB, FB, tol, 1000000.0, True)
+    # batched refinement must certify the same distance
+    lower_b, upper_max_b, _, _, _ = pompeiu_hausdorff(VA, FA, VB, FB, tol, 1000000.0, True, 64)
+    assert lower_b <= upper_max and lower <= upper_max_b
+    assert upper_max_b - lower_b <= tol*dA
+    # and be reproducible
+    lower_c, upper_max_c, _, _, _ = pompeiu_hausdorff(VA, FA, VB, FB, tol, 1000000.0, True, 64)
+    assert (lower_b, upper_max_b) == (lower_c, upper_max_c)
+
+def test_symmetric(meshes):
+    VA, FA, VB, FB = meshes
+    tol = 1e-6
+    lower, upper_max, dA, _, _ = symmetric_pompeiu_hausdorff(VA, FA, VB, FB, tol, 1000000.0, True)
+    assert upper_max - lower <= tol*dA
+    # the symmetric distance is at least each one-sided distance
+    lower_AB, upper_AB, _, _, _ = pompeiu_hausdorff(VA, FA, VB, FB, tol*dA, 1000000.0, False)
+    lower_BA, upper_BA, _, _, _ = pompeiu_hausdorff(VB, FB, VA, FA, tol*dA, 1000000.0, False)
+    assert lower <= max(upper_AB, upper_BA) and max(lower_AB, lower_BA) <= upper_max
+
+def test_target(meshes):
+    VA, FA, VB, FB = meshes
+    tol = 1e-6
+    lower, upper_max, _, _, _ = pompeiu_hausdorff(VA, FA, VB, FB, tol, 1000000.0, True)
+    target = PompeiuHausdorffTarget(VB, FB)
+    for _ in range(2):
+        lower_t, upper_max_t, _, time_taken_bvh, _ = target.distance_from(VA, FA, tol, 1000000.0, True)
+        assert (lower_t, upper_max_t) == (lower, upper_max)
+        assert time_taken_bvh == 0
+    ph = PompeiuHausdorff(VA, FA, target, tol, 1000000.0, True)
+    assert (ph.lower, ph.upper_max) == (lower, upper_max)
+
+def test_target_file(tmp_path, meshes):
+    VA, FA, VB, FB = meshes
+    tol = 1e-6
+    target = PompeiuHausdorffTarget(VB, FB)
+    target.save(str(tmp_path / "B.phdt"))
+    mapped = PompeiuHausdorffTarget(str(tmp_path / "B.phdt"))
+    assert np.array_equal(mapped.VB, target.VB) and np.array_equal(mapped.FB, target.FB)
+    lower, upper_max, _, _, _ = target.distance_from(VA, FA, tol, 1000000.0, True)
+    lower_m, upper_max_m, _, _, _ = mapped.distance_from(VA, FA, tol, 1000000.0, True)
+    assert (lower_m, upper_max_m) == (lower, upper_max)
+
+def test_queue_pruned(meshes):
+    VA, FA, VB, FB = meshes
+    ph = PompeiuHausdorff(VA, FA, VB, FB, 1e-6, 1000000.0, True)
+    # no queued triangle is dominated by the final lower bound
+    assert ph.Q.prune(ph.lower) == 0
+    previous = np.inf
+    while not ph.Q.empty():
+        upper, f = ph.Q.top()
+        assert ph.lower <= upper <= previous
+        previous = upper
+        ph.Q.pop()
+
+def test_recycle(meshes):
+    VA, FA, VB, FB = meshes
+    tol = 1e-6
+    ph = PompeiuHausdorff(VA, FA, VB, FB, tol, 1000000.0, True)
+    ph_r = PompeiuHausdorff(VA, FA, VB, FB, tol, 1000000.0, True, recycle=True)
+    assert (ph_r.lower, ph_r.upper_max) == (ph.lower, ph.upper_max)
+    assert ph_r.number_of_faces <= ph.number_of_faces
+    # every row in use is either queued or free
+    assert ph_r.Q.size() + len(ph_r.free_faces) == ph_r.number_of_faces
+
+def test_wide_bvh(meshes):
+    VA, FA, VB, FB = meshes
+    tol = 1e-6
+    lower, upper_max, dA, _, _ = pompeiu_hausdorff(VA, FA, VB, FB, tol, 1000000.0, True)
+    lower_w, upper_max_w, _, _, _ = pompeiu_hausdorff(VA, FA, VB, FB, tol, 1000000.0, True, wide_bvh=True)
+    # same distances up to rounding, so both are certified to the tolerance
+    assert lower_w == pytest.approx(lower, rel=1e-9)
+    assert upper_max_w - lower_w <= tol*dA
+
+def test_lazy(meshes):
+    VA, FA, VB, FB = meshes
+    tol = 1e-6
+    lower, upper_max, dA, _, _ = pompeiu_hausdorff(VA, FA, VB, FB, tol, 1000000.0, True)
+    for batch_size in [1, 64]:
+        lower_l, upper_max_l, _, _, _ = pompeiu_hausdorff(VA, FA, VB, FB, tol, 1000000.0, True, batch_size, lazy=True)
+        # both intervals are certified, so they contain the distance
+        assert upper_max_l - lower_l <= tol*dA
+        assert max(lower, lower_l) <= min(upper_max, upper_max_l)
+    ph = PompeiuHausdorff(VA, FA, VB, FB, tol, 1000000.0, True, recycle=True, lazy=True)
+    assert ph.upper_max - ph.lower <= tol*dA
+    assert ph.Q.size() + len(ph.free_faces) == ph.number_of_faces
+
+def test_adaptive_cascade(meshes):
+    VA, FA, VB, FB = meshes
+    tol = 1e-6
+    lower, upper_max, dA, _, _ = pompeiu_hausdorff(VA, FA, VB, FB, tol, 1000000.0, True)
+    for batch_size in [1, 64]:
+        lower_a, upper_max_a, _, _, _ = pompeiu_hausdorff(VA, FA, VB, FB, tol, 1000000.0, True, batch_size, adaptive_cascade=True)
+        assert upper_max_a - lower_a <= tol*dA
+        assert max(lower, lower_a) <= min(upper_max, upper_max_a)
+
+def test_stats(meshes):
+    VA, FA, VB, FB = meshes
+    ph = PompeiuHausdorff(VA, FA, VB, FB, 1e-6, 1000000.0, True)
+    stats = ph.stats
+    assert stats["iterations"] > 0
+    # the vertices of A and one query per new midpoint
+    assert stats["closest_point_queries"] == ph.number_of_vertices
+    # every face goes through u0, and each bound only sees the faces the
+    # previous ones did not reject
+    attempts, successes = stats["bound_attempts"], stats["bound_successes"]
+    assert attempts["u0"] == ph.number_of_faces
+    for previous, bound in [("u0", "u1"), ("u1", "u2"), ("u2", "kang"), ("kang", "u4")]:
+        assert attempts[bound] == attempts[previous] - successes[previous]
+    assert stats["max_depth"] > 0
+    assert stats["peak_queue_size"] >= ph.Q.size()
+    assert stats["peak_allocated_bytes"] > 0
+
+def test_anytime(meshes):
+    VA, FA, VB, FB = meshes
+    tol = 1e-8
+    lower, upper_max, dA, _, _ = pompeiu_hausdorff(VA, FA, VB, FB, tol, 1000000.0, True)
+    # the initial pass only, then refinement in chunks of iterations
+    ph = PompeiuHausdorff(VA, FA, VB, FB, tol, 1000000.0, True, max_iterations=0)
+    assert ph.exit_reason == "iteration_limit"
+    assert ph.lower <= upper_max and lower <= ph.upper_max
+    progress = []
+    while ph.refine(max_iterations=100000, progress=lambda l, u: progress.append((l, u)), progress_interval=0) == "iteration_limit":
+        pass
+    assert ph.exit_reason == "tolerance"
+    # same refinement as a single run
+    assert (ph.lower, ph.upper_max) == (lower, upper_max)
+    assert progress[-1] == (ph.lower, ph.upper_max)
+    # certified bounds within a time limit, or when cancelled
+    ph = PompeiuHausdorff(VA, FA, VB, FB, tol, 1000000.0, True, time_limit=50)
+    assert ph.exit_reason in ["time_limit", "tolerance"]
+    assert ph.lower <= upper_max and lower <= ph.upper_max
+    cancel = CancelFlag()
+    cancel.set()
+    ph = PompeiuHausdorff(VA, FA, VB, FB, tol, 1000000.0, True, cancel=cancel)
+    assert ph.exit_reason == "cancelled"
+    assert ph.lower <= upper_max and lower <= ph.upper_max
+
+def test_refine_tolerance(meshes):
+    VA, FA, VB, FB = meshes
+    ph = PompeiuHausdorff(VA, FA, VB, FB, 1e-8, 1000000.0, True, 64)
+    # a coarse-to-fine sweep continues from the previous refinement
+    sweep = PompeiuHausdorff(VA, FA, VB, FB, 1e-4, 1000000.0, True, 64)
+    assert sweep.upper_max - sweep.lower <= 1e-4*sweep.dA
+    for tol in [1e-6, 1e-8]:
+        assert sweep.refine(tol) == "tolerance"
+        assert sweep.tol == tol
+        assert sweep.upper_max - sweep.lower <= tol*sweep.dA
+    assert (sweep.lower, sweep.upper_max) == (ph.lower, ph.upper_max)
+    assert sweep.stats["iterations"] == ph.stats["iterations"]
+
+def test_checkpoint(tmp_path, meshes):
+    VA, FA, VB, FB = meshes
+    checkpoint = str(tmp_path / "run.phdc")
+    ph = PompeiuHausdorff(VA, FA, VB, FB, 1e-8, 1000000.0, True, 64, True)
+    # interrupted run, resumed from its last checkpoint
+    interrupted = PompeiuHausdorff(VA, FA, VB, FB, 1e-8, 1000000.0, True, 64, True, max_iterations=1000, checkpoint=checkpoint)
+    assert interrupted.exit_reason == "iteration_limit"
+    resumed = PompeiuHausdorff(resume=checkpoint, VA=VA, FA=FA, VB=VB, FB=FB)
+    assert resumed.exit_reason == "tolerance"
+    assert (resumed.lower, resumed.upper_max) == (ph.lower, ph.upper_max)
+    assert resumed.stats["iterations"] == ph.stats["iterations"]
+    # checkpoints are tied to their meshes
+    with pytest.raises(RuntimeError):
+        PompeiuHausdorff(resume=checkpoint, VA=VB, FA=FB, VB=VA, FB=FA)
+
+def test_checkpoint_max_factor(tmp_path, meshes):
+    VA, FA, VB, FB = meshes
+    checkpoint = str(tmp_path / "run.phdc")
+    # the storage grows past its initial size but not past max_factor
+    ph = PompeiuHausdorff(VA, FA, VB, FB, 1e-8, 3.0, True, 64, True)
+    interrupted = PompeiuHausdorff(VA, FA, VB, FB, 1e-8, 3.0, True, 64, True, max_iterations=40, checkpoint=checkpoint)
+    assert interrupted.exit_reason == "iteration_limit"
+    assert interrupted.VA_aug.shape[0] <= 3*VA.shape[0] and interrupted.FA_aug.shape[0] <= 3*FA.shape[0]
+    resumed = PompeiuHausdorff(resume=checkpoint, VA=VA, FA=FA, VB=VB, FB=FB)
+    assert resumed.exit_reason == ph.exit_reason
+    assert (resumed.lower, resumed.upper_max) == (ph.lower, ph.upper_max)
+
+def test_threshold(meshes):
+    VA, FA, VB, FB = meshes
+    target = PompeiuHausdorffTarget(VB, FB)
+    ph = PompeiuHausdorff(VA, FA, target, 1e-6, 1000000.0, True, 64)
+    # thresholds well below and above the distance are decided quickly
+    above = PompeiuHausdorff(VA, FA, target, 0, 1000000.0, True, 64, threshold=0.5*ph.lower)
+    assert above.exit_reason == "above_threshold"
+    assert 0.5*ph.lower < above.lower <= ph.upper_max
+    below = PompeiuHausdorff(VA, FA, target, 0, 1000000.0, True, 64, threshold=2*ph.upper_max)
+    assert below.exit_reason == "below_threshold"
+    assert ph.lower <= below.upper_max <= 2*ph.upper_max
+    assert below.stats["iterations"] < ph.stats["iterations"]
+    # the triangles dropped below the threshold come back without it
+    assert below.refine(1e-6) == "tolerance"
+    assert below.lower <= ph.upper_max and ph.lower <= below.upper_max
+    # a decision answered by the sampled pre-pass can still start over
+    decided = PompeiuHausdorff(VA, FA, target, 1e-6, 1000000.0, True, 64, threshold=0.5*ph.lower)
+    assert decided.exit_reason == "above_threshold"
+    assert decided.next_frame() == "tolerance"
+    assert decided.lower <= ph.upper_max and ph.lower <= decided.upper_max
+
+def test_frames(meshes):
+    VA, FA, VB, FB = meshes
+    ph = PompeiuHausdorff(VA, FA, VB, FB, 1e-8, 1000000.0, True, 64)
+    target = PompeiuHausdorffTarget(VB, FB, True)
+    shared = PompeiuHausdorff(VA, FA, target, 1e-8, 1000000.0, True, 64)
+    for k in range(1, 3):
+        VB_k = VB.copy()
+        VB_k[:, 0] += 0.002*k*np.sin(3*VB[:, 1])
+        fresh = PompeiuHausdorff(VA, FA, VB_k, FB, 1e-8, 1000000.0, True, 64)
+        # the next frame starts from the subdivision of the previous ones
+        assert ph.next_frame(VB_k) == "tolerance"
+        assert ph.stats["iterations"] < fresh.stats["iterations"]
+        target.update_vertices(VB_k)
+        assert shared.next_frame() == "tolerance"
+        for p in [ph, shared]:
+            assert p.lower <= fresh.upper_max + 1e-12
+            assert fresh.lower <= p.upper_max + 1e-12
+    # recycle does not keep the subdivision
+    recycled = PompeiuHausdorff(VA, FA, VB, FB, 1e-4, 1000000.0, True, 64, True)
+    with pytest.raises(RuntimeError):
+        recycled.next_frame(VB)
+
+def test_hints(meshes):
+    VA, FA, VB, FB = meshes
+    target = PompeiuHausdorffTarget(VB, FB)
+    ph = PompeiuHausdorff(VA, FA, target, 1e-8, 1000000.0, True, 64)
+    # the farthest point found is on A, at distance lower from B
+    sqrD, _, _ = igl.point_mesh_squared_distance(np.array([ph.lower_point]), VB, FB)
+    assert np.sqrt(sqrD[0]) == pytest.approx(ph.lower, rel=1e-12)
+    # fed back as a hint, it is the lower bound of the initial pass
+    hinted = PompeiuHausdorff(VA, FA, target, 1e-8, 1000000.0, True, 64, max_iterations=0, hint_points=np.array([ph.lower_point]))
+    assert hinted.lower == pytest.approx(ph.lower, rel=1e-12)
+    # locations on faces, and points far from A (moved onto A first)
+    hinted = PompeiuHausdorff(VA, FA, target, 1e-8, 1000000.0, True, 64, max_iterations=0, hint_faces=np.array([0, 1]), hint_barycentric=np.array([[1.0, 1.0, 1.0], [1.0, 0.0, 0.0]]), hint_points=np.array([[1e3, 1e3, 1e3]]))
+    assert hinted.lower <= ph.upper_max
+    with pytest.raises(RuntimeError):
+        PompeiuHausdorff(VA, FA, target, hint_faces=np.array([FA.shape[0]]), hint_barycentric=np.array([[1.0, 0.0, 0.0]]))
+
+def test_streaming(tmp_path, meshes):
+    VA, FA, VB, FB = meshes
+    tol = 1e-6
+    target = PompeiuHausdorffTarget(VB, FB)
+    lower, upper_max, dA, _, _ = target.distance_from(VA, FA, tol, 1000000.0, True, 64)
+    path_A = str(tmp_path / "A.phdm")
+    write_triangle_mesh_binary(path_A, VA, FA)
+    for chunk_faces in [100, 1000, FA.shape[0]]:
+        lower_s, upper_max_s, dA_s, _, _ = streaming_pompeiu_hausdorff(path_A, target, chunk_faces, tol, 1000000.0, True, 64, True)
+        assert dA_s == dA
+        assert lower_s <= upper_max and lower <= upper_max_s
+        assert upper_max_s-lower_s <= tol*dA
+    with pytest.raises(RuntimeError):
+        streaming_pompeiu_hausdorff(f"{this_dir}/../meshes/107100.obj", target)
+
+def test_sharded(meshes):
+    VA, FA, VB, FB = meshes
+    tol = 1e-6
+    target = PompeiuHausdorffTarget(VB, FB)
+    lower, upper_max, dA, _, _ = target.distance_from(VA, FA, tol, 1000000.0, True, 64)
+    for processes, shards in [(1, 1), (2, 8), (3, 0)]:
+        lower_s, upper_max_s, dA_s, _, _ = sharded_pompeiu_hausdorff(VA, FA, target, processes, shards, tol, 1000000.0, True, 64, True)
+        assert dA_s == dA
+        assert lower_s <= upper_max and lower <= upper_max_s
+        assert upper_max_s-lower_s <= tol*dA
+    # errors in the workers are raised by the parent
+    with pytest.raises(RuntimeError):
+        sharded_pompeiu_hausdorff(VA, FA, target, 2, 4, 1e-8, 1.01, True, 64)
@@ -0,0 +1,116 @@
+// Checks that the refinement loop of PompeiuHausdorff does not allocate heap
+// memory per iteration. Every call to malloc (which Eigen and operator new go
+// through) is counted, and the stop callback (called once per iteration)
+// records the iterations in which the count changed. The only allocations
+// left are the geometric growths of the augmented mesh and of the queue, so
+// their number must stay logarithmic in the number of iterations.
+//
+// Usage: test_allocations A.obj B.obj
+//
+// Linux (glibc) only: malloc is interposed and forwarded to __libc_malloc.
+
+#include "../src/PompeiuHausdorff.h"
+#include "../src/read_triangle_mesh_fast.h"
+
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+static std::atomic<long> number_of_allocations(0);
+
+extern "C"
+{
+    void * __libc_malloc(size_t size);
+    void * __libc_calloc(size_t n, size_t size);
+    void * __libc_realloc(void * p, size_t size);
+    void * __libc_memalign(size_t alignment, size_t size);
+
+    void * malloc(size_t size)
+    {
+        number_of_allocations++;
+        return __libc_malloc(size);
+    }
+    void * calloc(size_t n, size_t size)
+    {
+        number_of_allocations++;
+        return __libc_calloc(n,size);
+    }
+    void * realloc(void * p, size_t size)
+    {
+        number_of_allocations++;
+        return __libc_realloc(p,size);
+    }
+    void * memalign(size_t alignment, size_t size)
+    {
+        number_of_allocations++;
+        return __libc_memalign(alignment,size);
+    }
+    void * aligned_alloc(size_t alignment, size_t size)
+    {
+        number_of_allocations++;
+        return __libc_memalign(alignment,size);
+    }
+    int posix_memalign(void ** p, size_t alignment, size_t size)
+    {
+        number_of_allocations++;
+        *p = __libc_memalign(alignment,size);
+        return *p ? 0 : 12 /* ENOMEM */;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc!=3){
+        std::cout << "Usage: test_allocations A.obj B.obj" << std::endl;
+        return 1;
+    }
+    Eigen::Matrix<double,Eigen::Dynamic,3,Eigen::RowMajor> VA, VB;
+    Eigen::Matrix<int,Eigen::Dynamic,3,Eigen::RowMajor> FA, FB;
+    if (!read_triangle_mesh_fast(argv[1],VA,FA) || !read_triangle_mesh_fast(argv[2],VB,FB)){
+        std::cout << "Error loading meshes" << std::endl;
+        return 1;
+    }
+
+    // refine one triangle per iteration (no worker threads) with a zero
+    // tolerance, and stop after a fixed number of iterations, with and without
+    // recycled storage, lazy bounds and an adaptive cascade
+    const int iterations = 20000;
+    const int max_iterations_with_allocations = 3*(int)std::ceil(std::log2((double)iterations));
+    for (int mode = 0; mode<8; mode++){
+        PompeiuHausdorffOptions options;
+        options.recycle = mode&1;
+        options.lazy = mode&2;
+        options.adaptive_cascade = mode&4;
+        int number_of_iterations = 0;
+        int iterations_with_allocations = 0;
+        long allocations_before = 0;
+        PompeiuHausdorffBudget budget;
+        budget.stop = [&](double, double)
+        {
+            const long allocations = number_of_allocations;
+            if (number_of_iterations>0 && allocations!=allocations_before){
+                iterations_with_allocations++;
+            }
+            allocations_before = allocations;
+            return ++number_of_iterations > iterations;
+        };
+        PompeiuHausdorff ph(VA,FA,VB,FB,0,1000000,true,options,budget);
+
+        std::cout << "recycle=" << options.recycle << std::endl;
+        std::cout << "lazy=" << options.lazy << std::endl;
+        std::cout << "adaptive_cascade=" << options.adaptive_cascade << std::endl;
+        std::cout << "iterations=" << number_of_iterations-1 << std::endl;
+        std::cout << "iterations_with_allocations=" << iterations_with_allocations << std::endl;
+        if (number_of_iterations<=iterations){
+            std::cout << "FAILED: refinement ended before " << iterations << " iterations" << std::endl;
+            return 1;
+        }
+        if (iterations_with_allocations>max_iterations_with_allocations){
+            std::cout << "FAILED: more than " << max_iterations_with_allocations << " iterations allocated memory" << std::endl;
+            return 1;
+        }
+    }
+    std::cout << "PASSED" << std::endl;
+    return 0;
+}
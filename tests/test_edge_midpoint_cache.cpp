@@ -0,0 +1,33 @@
+// Checks that EdgeMidpointCache evicts the oldest entry of a full set. The
+// cache has a single set of 4 ways, so every edge collides: after inserting
+// 5 edges, the first one must be missing and the 4 others found.
+//
+// Usage: test_edge_midpoint_cache
+
+#include "../src/edge_midpoint_cache.h"
+
+#include <iostream>
+
+int main()
+{
+    EdgeMidpointCache cache(4);
+    if (cache.capacity()!=4){
+        std::cout << "FAILED: capacity " << cache.capacity() << " instead of 4" << std::endl;
+        return 1;
+    }
+    // edge (0,e) has midpoint 10+e, with all vertex rows of generation 0
+    const std::vector<uint32_t> generation(16,0);
+    for (int e = 1; e<=5; e++){
+        cache.insert(0,e,10+e,generation);
+    }
+    for (int e = 1; e<=5; e++){
+        int m = -1;
+        const bool found = cache.take(e,0,generation,m);
+        if (found!=(e>1) || (found && m!=10+e)){
+            std::cout << "FAILED: edge (0," << e << ") " << (found ? "found" : "missing") << std::endl;
+            return 1;
+        }
+    }
+    std::cout << "PASSED" << std::endl;
+    return 0;
+}